@@ -0,0 +1,653 @@
+#include "./includes/backup.h"
+#include "./includes/logger.h"
+#include "./includes/metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr uint32_t kRegionMagic = 0x3147524D;   // "MRG1"
+constexpr uint32_t kFileMagic   = 0x3146534D;   // "MSF1"
+
+constexpr size_t kSector      = 4096;
+constexpr size_t kHeaderBytes = 2 * kSector;    // расположения + метки времени
+constexpr size_t kSlots       = 1024;
+
+/* Куски обычных файлов: граница там, где старшие 16 бит gear-хеша
+   нулевые, — в среднем раз в 64 КБ, но не раньше min и не позже max */
+constexpr size_t kMinPiece = 16 * 1024;
+constexpr size_t kMaxPiece = 256 * 1024;
+constexpr size_t kReadBuf  = 1024 * 1024;
+
+const std::array<uint64_t, 256>& gear() {
+    static const auto table = [] {
+        std::array<uint64_t, 256> t{};
+        uint64_t x = 0;
+        for (auto& v : t) {   // splitmix64: таблица одна и та же при каждом запуске
+            uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            v = z ^ (z >> 31);
+        }
+        return t;
+    }();
+    return table;
+}
+
+size_t cut_point(const unsigned char* p, size_t n) {
+    if (n <= kMinPiece) return n;
+    const size_t end = (std::min)(n, kMaxPiece);
+    const auto& g = gear();
+    uint64_t h = 0;
+    for (size_t i = kMinPiece; i < end; ++i) {
+        h = (h << 1) + g[p[i]];
+        if ((h >> 48) == 0) return i + 1;
+    }
+    return end;
+}
+
+uint32_t be32(const unsigned char* p) {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+}
+
+void put_be32(char* p, uint32_t v) {
+    p[0] = static_cast<char>(v >> 24);
+    p[1] = static_cast<char>(v >> 16);
+    p[2] = static_cast<char>(v >> 8);
+    p[3] = static_cast<char>(v);
+}
+
+void put_le(std::string& out, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out += static_cast<char>(v >> (8 * i));
+}
+
+uint32_t get_le(const unsigned char* p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= uint32_t(p[i]) << (8 * i);
+    return v;
+}
+
+int64_t mtime_of(const fs::path& p, std::error_code& ec) {
+    return fs::last_write_time(p, ec).time_since_epoch().count();
+}
+
+/* Имя снимка — время UTC: сортировка по имени = по времени */
+std::string stamp_now() {
+    std::time_t t = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y%m%d-%H%M%S", &tm);
+    return buf;
+}
+
+bool is_region(const fs::path& p) {
+    return p.extension() == ".mca";
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------ */
+/*                              Настройки                             */
+/* ------------------------------------------------------------------ */
+BackupOptions BackupOptions::from_json(const json& backup) {
+    BackupOptions o;
+    if (!backup.is_object()) return o;
+    o.mode    = backup.value("mode",    o.mode);
+    o.dir     = backup.value("dir",     o.dir);
+    o.threads = backup.value("threads", o.threads);
+    o.keep    = backup.value("keep",    o.keep);
+    if (o.mode != "dedup" && o.mode != "clone") {
+        LOG_WARNING("server.backup.mode: неизвестный режим '" + o.mode + "', используется dedup", "CONFIG");
+        o.mode = "dedup";
+    }
+    return o;
+}
+
+json BackupStats::to_json() const {
+    return {
+        {"name",          name},
+        {"method",        method},
+        {"files",         files},
+        {"files_skipped", files_skipped},
+        {"chunks",        chunks},
+        {"chunks_new",    chunks_new},
+        {"bytes_read",    bytes_read},
+        {"bytes_written", bytes_written},
+        {"bytes_cloned",  bytes_cloned},
+        {"ms",            ms}
+    };
+}
+
+json RestoreStats::to_json() const {
+    return {
+        {"name",     name},
+        {"kind",     kind},
+        {"files",    files},
+        {"chunks",   chunks},
+        {"removed",  removed},
+        {"bytes",    bytes},
+        {"ms",       ms},
+        {"previous", previous}
+    };
+}
+
+WorldBackup::WorldBackup(fs::path root, BackupOptions opt)
+    : root_(std::move(root)), opt_(std::move(opt)) {}
+
+fs::path WorldBackup::object_path(const Sha256::Digest& h) const {
+    return object_path(Sha256::hex(h));
+}
+
+fs::path WorldBackup::object_path(const std::string& hex) const {
+    return root_ / "objects" / hex.substr(0, 2) / hex;
+}
+
+fs::path WorldBackup::manifest_path(const std::string& name) const {
+    return root_ / "snapshots" / (name + ".json");
+}
+
+/* Та же секунда (или часы ушли назад) — суффикс -02, -03... */
+std::string WorldBackup::next_name(const std::vector<std::string>& names) {
+    std::string name = stamp_now();
+    if (!names.empty() && name <= names.back()) {
+        const std::string& last = names.back();
+        const int n = last.size() > 16 ? std::atoi(last.c_str() + 16) + 1 : 2;
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "-%02d", n);
+        name = last.substr(0, 15) + suffix;
+    }
+    return name;
+}
+
+std::vector<std::string> WorldBackup::snapshots() const {
+    std::vector<std::string> out;
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(root_ / "snapshots", ec)) {
+        if (e.path().extension() == ".json") out.push_back(e.path().stem().string());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+/* ------------------------------------------------------------------ */
+/*                               Рецепты                              */
+/* ------------------------------------------------------------------ */
+/*  Little-endian: magic, count, затем куски
+      .mca:   slot u16, location u32, mtime u32, length u32, sha256
+      прочее: length u32, sha256
+    Порядок кусков фиксирован (по слоту / по смещению), поэтому
+    одинаковый файл всегда даёт одинаковый хеш рецепта.              */
+std::string WorldBackup::encode(const Recipe& r) {
+    std::string out;
+    out.reserve(8 + r.pieces.size() * (r.region ? 46 : 36));
+    put_le(out, r.region ? kRegionMagic : kFileMagic, 4);
+    put_le(out, static_cast<uint32_t>(r.pieces.size()), 4);
+    for (const auto& p : r.pieces) {
+        if (r.region) {
+            put_le(out, p.slot, 2);
+            put_le(out, p.location, 4);
+            put_le(out, p.mtime, 4);
+        }
+        put_le(out, p.length, 4);
+        out.append(reinterpret_cast<const char*>(p.hash.data()), p.hash.size());
+    }
+    return out;
+}
+
+bool WorldBackup::decode(const std::string& blob, Recipe& r) {
+    auto p = reinterpret_cast<const unsigned char*>(blob.data());
+    if (blob.size() < 8) return false;
+    const uint32_t magic = get_le(p, 4);
+    if (magic != kRegionMagic && magic != kFileMagic) return false;
+
+    r.region = magic == kRegionMagic;
+    const size_t count = get_le(p + 4, 4);
+    const size_t rec   = r.region ? 46 : 36;
+    if (blob.size() != 8 + count * rec) return false;
+
+    r.pieces.assign(count, Piece{});
+    p += 8;
+    for (auto& piece : r.pieces) {
+        if (r.region) {
+            piece.slot     = static_cast<uint16_t>(get_le(p, 2));
+            piece.location = get_le(p + 2, 4);
+            piece.mtime    = get_le(p + 6, 4);
+            p += 10;
+        }
+        piece.length = get_le(p, 4);
+        std::copy(p + 4, p + 36, piece.hash.begin());
+        p += 36;
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/*                            Хранилище                               */
+/* ------------------------------------------------------------------ */
+bool WorldBackup::put(const Sha256::Digest& h, const char* data, size_t n) {
+    const fs::path path = object_path(h);
+    std::error_code ec;
+    if (fs::exists(path, ec)) return false;
+
+    // Свой .tmp на поток: один и тот же кусок могут принести два файла
+    fs::path tmp = path;
+    tmp += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(data, static_cast<std::streamsize>(n));
+        if (!out) throw std::runtime_error("запись в хранилище не удалась: " + tmp.string());
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        if (!fs::exists(path)) throw std::runtime_error("не удалось сохранить объект " + path.string());
+        return false;   // успел другой поток
+    }
+    return true;
+}
+
+bool WorldBackup::load(const std::string& hex, std::string& out) const {
+    std::ifstream in(object_path(hex), std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+bool WorldBackup::fetch(const std::string& hex, std::string& out) const {
+    return load(hex, out) && Sha256::hex(Sha256::hash(out)) == hex;
+}
+
+/* ------------------------------------------------------------------ */
+/*                        Файл региона: по чанкам                     */
+/* ------------------------------------------------------------------ */
+void WorldBackup::backup_region(std::ifstream& in, uint64_t size, const Recipe* prev,
+                                Recipe& out, BackupStats& st) {
+    unsigned char header[kHeaderBytes];
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header)))
+        throw std::runtime_error("не читается заголовок региона");
+    st.bytes_read += sizeof(header);
+
+    std::array<const Piece*, kSlots> old{};
+    if (prev) for (const auto& p : prev->pieces) if (p.slot < kSlots) old[p.slot] = &p;
+
+    // Читаем в порядке секторов — последовательно по диску
+    std::vector<uint16_t> order;
+    for (uint16_t s = 0; s < kSlots; ++s) if (be32(header + s * 4)) order.push_back(s);
+    std::sort(order.begin(), order.end(), [&](uint16_t a, uint16_t b) {
+        return be32(header + a * 4) < be32(header + b * 4);
+    });
+
+    out.region = true;
+    std::string buf;
+    for (uint16_t slot : order) {
+        Piece piece;
+        piece.slot     = slot;
+        piece.location = be32(header + slot * 4);
+        piece.mtime    = be32(header + kSector + slot * 4);
+
+        const Piece* o = old[slot];
+        if (o && o->location == piece.location && o->mtime == piece.mtime) {
+            out.pieces.push_back(*o);
+            continue;
+        }
+
+        const uint64_t off  = uint64_t(piece.location >> 8) * kSector;
+        const uint64_t span = uint64_t(piece.location & 0xFF) * kSector;
+        if (off < kHeaderBytes || off + 5 > size) {
+            LOG_WARNING("Чанк " + std::to_string(slot) + " указывает за пределы файла — пропущен", "BACKUP");
+            continue;
+        }
+
+        buf.resize(static_cast<size_t>(std::min<uint64_t>(span, size - off)));
+        in.seekg(static_cast<std::streamoff>(off));
+        if (!in.read(buf.data(), static_cast<std::streamsize>(buf.size())))
+            throw std::runtime_error("ошибка чтения чанка " + std::to_string(slot));
+        st.bytes_read += buf.size();
+
+        const uint32_t len = be32(reinterpret_cast<const unsigned char*>(buf.data()));
+        if (len == 0 || uint64_t(len) + 4 > buf.size()) {
+            LOG_WARNING("Чанк " + std::to_string(slot) + " с битой длиной — пропущен", "BACKUP");
+            continue;
+        }
+
+        piece.length = len + 4;   // [длина][сжатие][данные]
+        piece.hash   = Sha256().update(buf.data(), piece.length).finish();
+        ++st.chunks;
+        if (put(piece.hash, buf.data(), piece.length)) {
+            ++st.chunks_new;
+            st.bytes_written += piece.length;
+        }
+        out.pieces.push_back(piece);
+    }
+
+    std::sort(out.pieces.begin(), out.pieces.end(),
+              [](const Piece& a, const Piece& b) { return a.slot < b.slot; });
+}
+
+/* ------------------------------------------------------------------ */
+/*                   Прочие файлы: куски по содержимому               */
+/* ------------------------------------------------------------------ */
+void WorldBackup::backup_stream(std::ifstream& in, Recipe& out, BackupStats& st) {
+    out.region = false;
+    std::string buf;
+    size_t pos = 0;
+    bool eof = false;
+
+    while (!eof || pos < buf.size()) {
+        // Держим в буфере хотя бы один максимальный кусок
+        if (!eof && buf.size() - pos < kMaxPiece) {
+            buf.erase(0, pos);
+            pos = 0;
+            const size_t have = buf.size();
+            buf.resize(have + kReadBuf);
+            in.read(buf.data() + have, kReadBuf);
+            const size_t got = static_cast<size_t>(in.gcount());
+            buf.resize(have + got);
+            st.bytes_read += got;
+            if (in.bad()) throw std::runtime_error("ошибка чтения");
+            if (got < kReadBuf) eof = true;
+            continue;
+        }
+
+        const auto* p = reinterpret_cast<const unsigned char*>(buf.data()) + pos;
+        const size_t n = cut_point(p, buf.size() - pos);
+
+        Piece piece;
+        piece.length = static_cast<uint32_t>(n);
+        piece.hash   = Sha256().update(p, n).finish();
+        ++st.chunks;
+        if (put(piece.hash, buf.data() + pos, n)) {
+            ++st.chunks_new;
+            st.bytes_written += n;
+        }
+        out.pieces.push_back(piece);
+        pos += n;
+    }
+}
+
+/* ---------- Один файл мира → строка манифеста ---------- */
+json WorldBackup::backup_file(const fs::path& abs, const std::string& rel,
+                              const Prev* prev, bool full, BackupStats& st) {
+    std::error_code ec;
+    const uint64_t size  = fs::file_size(abs, ec);
+    const int64_t  mtime = ec ? 0 : mtime_of(abs, ec);
+    if (ec) throw std::runtime_error(rel + ": " + ec.message());
+
+    ++st.files;
+    if (!full && prev && prev->size == size && prev->mtime == mtime) {
+        ++st.files_skipped;
+        return { {"path", rel}, {"size", size}, {"mtime", mtime}, {"recipe", prev->recipe} };
+    }
+
+    std::ifstream in(abs, std::ios::binary);
+    if (!in) throw std::runtime_error(rel + ": не открывается");
+
+    Recipe recipe;
+    try {
+        if (is_region(abs) && size >= kHeaderBytes) {
+            Recipe old;
+            std::string blob;
+            const bool have_old = !full && prev && load(prev->recipe, blob) && decode(blob, old) && old.region;
+            backup_region(in, size, have_old ? &old : nullptr, recipe, st);
+        } else {
+            backup_stream(in, recipe, st);
+        }
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(rel + ": " + e.what());
+    }
+
+    const std::string blob = encode(recipe);
+    const auto h = Sha256::hash(blob);
+    put(h, blob.data(), blob.size());
+    return { {"path", rel}, {"size", size}, {"mtime", mtime}, {"recipe", Sha256::hex(h)} };
+}
+
+/* ------------------------------------------------------------------ */
+/*                            Восстановление                          */
+/* ------------------------------------------------------------------ */
+/*  Регион собирается с теми же расположениями и метками времени, что
+    были в файле: заголовок, затем чанки по своим секторам, дыры — нули.
+    Байт в байт совпадает всё, кроме мусора в неиспользуемых секторах.  */
+void WorldBackup::restore_file(const json& entry, const fs::path& dst, RestoreStats& st) const {
+    const std::string rel  = entry.at("path").get<std::string>();
+    const uint64_t    size = entry.at("size").get<uint64_t>();
+
+    std::string blob;
+    Recipe recipe;
+    if (!fetch(entry.at("recipe").get<std::string>(), blob) || !decode(blob, recipe))
+        throw std::runtime_error(rel + ": рецепт отсутствует или повреждён");
+
+    std::ofstream out(dst, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error(rel + ": не создаётся " + dst.string());
+
+    uint64_t written = 0;
+    auto write_piece = [&](const Piece& p) {
+        if (!fetch(Sha256::hex(p.hash), blob) || blob.size() != p.length)
+            throw std::runtime_error(rel + ": объект " + Sha256::hex(p.hash) + " отсутствует или повреждён");
+        out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+        ++st.chunks;
+        written += blob.size();
+    };
+
+    if (recipe.region) {
+        std::string header(kHeaderBytes, '\0');
+        for (const auto& p : recipe.pieces) {
+            put_be32(&header[p.slot * 4], p.location);
+            put_be32(&header[kSector + p.slot * 4], p.mtime);
+        }
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+        std::vector<const Piece*> order;
+        for (const auto& p : recipe.pieces) order.push_back(&p);
+        std::sort(order.begin(), order.end(), [](const Piece* a, const Piece* b) { return a->location < b->location; });
+        for (const Piece* p : order) {
+            out.seekp(static_cast<std::streamoff>(uint64_t(p->location >> 8) * kSector));
+            write_piece(*p);
+        }
+    } else {
+        for (const auto& p : recipe.pieces) write_piece(p);
+        if (written != size) throw std::runtime_error(rel + ": размер не сходится с манифестом");
+    }
+
+    out.close();
+    if (!out) throw std::runtime_error(rel + ": ошибка записи");
+    fs::resize_file(dst, size);   // хвост последнего сектора региона
+    fs::last_write_time(dst, fs::file_time_type(fs::file_time_type::duration(entry.at("mtime").get<int64_t>())));
+
+    ++st.files;
+    st.bytes += written;
+}
+
+/* ------------------------------------------------------------------ */
+/*                                Снимок                              */
+/* ------------------------------------------------------------------ */
+BackupStats WorldBackup::snapshot(const fs::path& world_dir, bool full) {
+    const auto t0 = std::chrono::steady_clock::now();
+    std::error_code ec;
+    if (!fs::is_directory(world_dir, ec)) throw std::runtime_error("нет каталога мира: " + world_dir.string());
+
+    static const char* hex = "0123456789abcdef";
+    for (int i = 0; i < 256; ++i) {
+        fs::create_directories(root_ / "objects" / std::string{hex[i >> 4], hex[i & 15]}, ec);
+    }
+    fs::create_directories(root_ / "snapshots", ec);
+    if (ec) throw std::runtime_error("хранилище недоступно: " + root_.string() + " (" + ec.message() + ")");
+
+    // Прошлый снимок — откуда брать размеры, mtime и рецепты
+    std::unordered_map<std::string, Prev> prev;
+    if (const auto names = snapshots(); !names.empty()) {
+        try {
+            std::ifstream f(manifest_path(names.back()));
+            const json manifest = json::parse(f);
+            for (const auto& e : manifest.at("files")) {
+                prev[e.at("path").get<std::string>()] =
+                    Prev{ e.at("size").get<uint64_t>(), e.at("mtime").get<int64_t>(), e.at("recipe").get<std::string>() };
+            }
+        } catch (const std::exception& e) {
+            LOG_WARNING("Прошлый манифест не читается, снимок будет полным: " + std::string(e.what()), "BACKUP");
+            prev.clear();
+        }
+    }
+
+    // Файлы мира; крупные первыми — потоки заканчивают примерно вместе
+    struct Item { fs::path abs; std::string rel; uint64_t size; };
+    std::vector<Item> items;
+    for (auto it = fs::recursive_directory_iterator(world_dir, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file(ec) || it->path().filename() == "session.lock") continue;
+        items.push_back({ it->path(), fs::relative(it->path(), world_dir, ec).generic_string(), it->file_size(ec) });
+    }
+    if (ec) throw std::runtime_error("обход мира: " + ec.message());
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.size > b.size; });
+
+    unsigned threads = opt_.threads ? opt_.threads : (std::max)(1u, std::thread::hardware_concurrency() / 2);
+    threads = static_cast<unsigned>(std::clamp<size_t>(threads, 1, std::max<size_t>(items.size(), 1)));
+
+    std::vector<json> entries(items.size());
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex mx;
+    std::string error;
+    BackupStats total;
+
+    auto worker = [&] {
+        BackupStats st;
+        for (size_t i; !failed && (i = next++) < items.size(); ) {
+            const auto it = prev.find(items[i].rel);
+            try {
+                entries[i] = backup_file(items[i].abs, items[i].rel,
+                                         it != prev.end() ? &it->second : nullptr, full, st);
+            } catch (const std::exception& e) {
+                std::lock_guard lg(mx);
+                if (!failed.exchange(true)) error = e.what();
+            }
+        }
+        std::lock_guard lg(mx);
+        total.files         += st.files;
+        total.files_skipped += st.files_skipped;
+        total.chunks        += st.chunks;
+        total.chunks_new    += st.chunks_new;
+        total.bytes_read    += st.bytes_read;
+        total.bytes_written += st.bytes_written;
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    if (failed) throw std::runtime_error(error);
+
+    // Манифест — последним: без него снимка нет, а объекты просто лишние
+    std::sort(entries.begin(), entries.end(),
+              [](const json& a, const json& b) { return a["path"] < b["path"]; });
+
+    total.name   = next_name(snapshots());
+    total.method = "dedup";
+    total.ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+
+    const json manifest = {
+        {"format",  1},
+        {"name",    total.name},
+        {"created", static_cast<int64_t>(std::time(nullptr))},
+        {"world",   world_dir.filename().string()},
+        {"full",    full},
+        {"stats",   total.to_json()},
+        {"files",   entries}
+    };
+    const fs::path path = manifest_path(total.name);
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out << manifest.dump();
+        if (!out) throw std::runtime_error("манифест не записан: " + tmp.string());
+    }
+    fs::rename(tmp, path);
+
+    static auto& snaps   = Metrics::instance().counter("backup.snapshots");
+    static auto& written = Metrics::instance().counter("backup.bytes_written");
+    static auto& dur     = Metrics::instance().histogram("backup.duration_us");
+    ++snaps;
+    written += total.bytes_written;
+    dur.record(static_cast<uint64_t>(total.ms) * 1000);
+
+    LOG_INFO("Снимок " + total.name + ": файлов " + std::to_string(total.files) +
+             " (без изменений " + std::to_string(total.files_skipped) + "), чанков прочитано " +
+             std::to_string(total.chunks) + ", новых " + std::to_string(total.chunks_new) +
+             ", записано " + std::to_string(total.bytes_written / 1024) + " КБ за " +
+             std::to_string(total.ms) + " мс", "BACKUP");
+
+    try {
+        enforce_retention();
+    } catch (const std::exception& e) {
+        LOG_WARNING("Чистка старых снимков не удалась: " + std::string(e.what()), "BACKUP");
+    }
+    return total;
+}
+
+/* ---------- keep: старые манифесты и объекты, на которые никто не ссылается ---------- */
+/*  Вызывается только из snapshot(), а снимки одного инстанса не идут
+    параллельно (флаг в MinecraftServerManager), поэтому всё, чего нет
+    в живых манифестах, включая .tmp, — мусор.                          */
+void WorldBackup::enforce_retention() {
+    if (opt_.keep == 0) return;
+    auto names = snapshots();
+    if (names.size() <= opt_.keep) return;
+
+    const size_t drop = names.size() - opt_.keep;
+    for (size_t i = 0; i < drop; ++i) fs::remove(manifest_path(names[i]));
+    names.erase(names.begin(), names.begin() + drop);
+
+    std::unordered_set<std::string> live;
+    std::string blob;
+    for (const auto& name : names) {
+        std::ifstream f(manifest_path(name));
+        const json manifest = json::parse(f);
+        for (const auto& e : manifest.at("files")) {
+            const auto recipe = e.at("recipe").get<std::string>();
+            if (!live.insert(recipe).second) continue;   // рецепт уже разобран
+
+            Recipe r;
+            if (!load(recipe, blob) || !decode(blob, r))
+                throw std::runtime_error("снимок " + name + " ссылается на битый рецепт " + recipe);
+            for (const auto& p : r.pieces) live.insert(Sha256::hex(p.hash));
+        }
+    }
+
+    size_t removed = 0;
+    uint64_t freed = 0;
+    std::error_code ec;
+    for (const auto& dir : fs::directory_iterator(root_ / "objects", ec)) {
+        for (const auto& obj : fs::directory_iterator(dir.path(), ec)) {
+            if (live.count(obj.path().filename().string())) continue;
+            const uint64_t size = obj.file_size(ec);
+            if (fs::remove(obj.path(), ec)) {
+                ++removed;
+                freed += size;
+            }
+        }
+    }
+    LOG_INFO("Удалено снимков: " + std::to_string(drop) + ", объектов: " + std::to_string(removed) +
+             " (" + std::to_string(freed / (1024 * 1024)) + " МБ)", "BACKUP");
+}
@@ -0,0 +1,341 @@
+#include "./includes/binlog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace binlog {
+
+namespace {
+
+constexpr uint64_t kFlushBytes = 64 * 1024;
+constexpr auto     kFlushEvery = std::chrono::seconds(1);
+
+/* Индекс незакрытых сегментов между запросами: путь → прочитанное */
+struct Partial {
+    uint64_t                data_end = 0;
+    std::vector<IndexEntry> index;
+    int64_t                 first_ts = 0, last_ts = 0;
+};
+std::mutex                     g_partial_mx;
+std::map<std::string, Partial> g_partial;
+
+}
+
+const char* level_name(uint8_t level) {
+    static const char* names[] = { "DEBUG", "INFO", "WARN", "ERROR", "CRIT" };
+    return level < 5 ? names[level] : "?";
+}
+
+int parse_level(const std::string& s) {
+    if (s == "DEBUG")                   return 0;
+    if (s == "INFO")                    return 1;
+    if (s == "WARN" || s == "WARNING")  return 2;
+    if (s == "ERROR" || s == "ERR")     return 3;
+    if (s == "CRIT" || s == "CRITICAL") return 4;
+    return -1;
+}
+
+nlohmann::json Record::to_json() const {
+    const std::time_t secs = static_cast<std::time_t>(ts_us / 1000000);
+    std::ostringstream ts;
+    ts << std::put_time(std::localtime(&secs), "%Y-%m-%d %H:%M:%S")
+       << '.' << std::setw(3) << std::setfill('0') << (ts_us / 1000) % 1000;
+
+    return {
+        {"ts",     ts.str()},
+        {"ts_us",  ts_us},
+        {"level",  level_name(level)},
+        {"module", module},
+        {"thread", thread},
+        {"msg",    message}
+    };
+}
+
+/* ------------------------------------------------------------------ */
+/*                               Writer                               */
+/* ------------------------------------------------------------------ */
+Writer::Writer(std::string dir, uint64_t segment_bytes, uint32_t index_every,
+               size_t keep_segments, int max_age_days)
+    : dir_(std::move(dir)),
+      segment_bytes_(segment_bytes ? segment_bytes : 64ull << 20),
+      index_every_(index_every ? index_every : 256),
+      keep_segments_(keep_segments),
+      max_age_days_(max_age_days)
+{}
+
+Writer::~Writer() {
+    try { close(); } catch (...) {}
+}
+
+/* Под мьютексом Logger: раз на сегмент, и в лог отсюда писать нельзя */
+void Writer::enforce_retention() {
+    if (!keep_segments_ && !max_age_days_) return;
+
+    struct Seg { fs::path path; fs::file_time_type mtime; };
+    std::vector<Seg> segs;
+    std::error_code ec;
+    for (const auto& f : fs::directory_iterator(dir_, ec)) {
+        if (f.path().extension() == ".mslog" && f.is_regular_file(ec)) segs.push_back({ f.path(), f.last_write_time(ec) });
+    }
+    std::sort(segs.begin(), segs.end(), [](const Seg& a, const Seg& b) { return a.mtime > b.mtime; });
+
+    const auto cutoff = fs::file_time_type::clock::now() - std::chrono::hours(24) * max_age_days_;
+    for (size_t i = 0; i < segs.size(); ++i) {
+        const bool too_many = keep_segments_ && i >= keep_segments_;
+        const bool too_old  = max_age_days_ && segs[i].mtime < cutoff;
+        if (too_many || too_old) fs::remove(segs[i].path, ec);   // занят читателем — в следующий раз
+    }
+}
+
+void Writer::open_next() {
+    fs::create_directories(dir_);
+    enforce_retention();
+
+    const std::time_t now = std::time(nullptr);
+    std::ostringstream name;
+    name << std::put_time(std::localtime(&now), "%Y%m%d-%H%M%S")
+         << '-' << std::setw(3) << std::setfill('0') << seq_++ << ".mslog";
+
+    path_ = (fs::path(dir_) / name.str()).string();
+    filebuf_.resize(kFlushBytes);
+    out_.rdbuf()->pubsetbuf(filebuf_.data(), static_cast<std::streamsize>(filebuf_.size()));
+    out_.open(path_, std::ios::binary | std::ios::trunc);
+    out_.write(kMagic, sizeof(kMagic));
+    offset_   = sizeof(kMagic);
+    first_ts_ = last_ts_ = 0;
+    index_.clear();
+}
+
+void Writer::append(int64_t ts_us, uint8_t level, uint32_t thread,
+                    const std::string& module, const std::string& message)
+{
+    if (!out_.is_open()) open_next();
+    if (!out_) return;
+
+    const uint16_t mod_len = static_cast<uint16_t>(std::min<size_t>(module.size(), 0xffff));
+    const uint32_t len = static_cast<uint32_t>(8 + 1 + 4 + 2 + mod_len + message.size());
+
+    buf_.resize(4 + len);
+    char* p = buf_.data();
+    auto put = [&p](const void* v, size_t n) { std::memcpy(p, v, n); p += n; };
+    put(&len, 4);
+    put(&ts_us, 8);
+    put(&level, 1);
+    put(&thread, 4);
+    put(&mod_len, 2);
+    put(module.data(), mod_len);
+    put(message.data(), message.size());
+
+    if (index_.empty() || index_.back().count >= index_every_) {
+        index_.push_back(IndexEntry{ ts_us, offset_, 0, 0, {} });
+    }
+    index_.back().count++;
+    index_.back().level_mask |= static_cast<uint8_t>(1u << level);
+    if (!first_ts_) first_ts_ = ts_us;
+    last_ts_ = ts_us;
+
+    out_.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+    offset_ += buf_.size();
+    unflushed_ += buf_.size();
+    const auto now = std::chrono::steady_clock::now();
+    if (unflushed_ >= kFlushBytes || now - flushed_at_ >= kFlushEvery) flush();
+
+    if (offset_ >= segment_bytes_) close();
+}
+
+void Writer::flush() {
+    if (!out_.is_open() || !unflushed_) return;
+    out_.flush();
+    unflushed_  = 0;
+    flushed_at_ = std::chrono::steady_clock::now();
+}
+
+void Writer::close() {
+    if (!out_.is_open()) return;
+
+    Trailer t{};
+    t.index_offset = offset_;
+    t.entries      = static_cast<uint32_t>(index_.size());
+    t.magic        = kTrailerMagic;
+    t.first_ts     = first_ts_;
+    t.last_ts      = last_ts_;
+
+    out_.write(reinterpret_cast<const char*>(index_.data()),
+               static_cast<std::streamsize>(index_.size() * sizeof(IndexEntry)));
+    out_.write(reinterpret_cast<const char*>(&t), sizeof(t));
+    out_.close();
+    index_.clear();
+    unflushed_ = 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*                               Reader                               */
+/* ------------------------------------------------------------------ */
+Reader::Reader(const std::string& path) : path_(path), in_(path, std::ios::binary) {
+    if (!in_) return;
+
+    in_.seekg(0, std::ios::end);
+    size_ = static_cast<uint64_t>(in_.tellg());
+    char magic[sizeof(kMagic)] = {};
+    in_.seekg(0);
+    in_.read(magic, sizeof(magic));
+    if (!in_ || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) return;
+
+    Trailer t{};
+    if (size_ >= sizeof(kMagic) + sizeof(Trailer)) {
+        in_.seekg(static_cast<std::streamoff>(size_ - sizeof(Trailer)));
+        in_.read(reinterpret_cast<char*>(&t), sizeof(t));
+    }
+
+    if (in_ && t.magic == kTrailerMagic &&
+        t.index_offset + uint64_t(t.entries) * sizeof(IndexEntry) + sizeof(Trailer) == size_)
+    {
+        index_.resize(t.entries);
+        in_.seekg(static_cast<std::streamoff>(t.index_offset));
+        in_.read(reinterpret_cast<char*>(index_.data()),
+                 static_cast<std::streamsize>(index_.size() * sizeof(IndexEntry)));
+        data_end_ = t.index_offset;
+        first_ts_ = t.first_ts;
+        last_ts_  = t.last_ts;
+        std::lock_guard lg(g_partial_mx);
+        g_partial.erase(path_);   // сегмент закрыт — кеш живого индекса не нужен
+    } else {
+        in_.clear();
+        rebuild_index();
+    }
+    in_.clear();
+    ok_ = true;
+}
+
+bool Reader::read_record(uint64_t& offset, Record& r) {
+    uint32_t len = 0;
+    if (offset + 4 > data_end_) return false;
+    in_.seekg(static_cast<std::streamoff>(offset));
+    in_.read(reinterpret_cast<char*>(&len), 4);
+    if (!in_ || len < 15 || offset + 4 + len > data_end_) return false;
+
+    uint16_t mod_len = 0;
+    in_.read(reinterpret_cast<char*>(&r.ts_us), 8);
+    in_.read(reinterpret_cast<char*>(&r.level), 1);
+    in_.read(reinterpret_cast<char*>(&r.thread), 4);
+    in_.read(reinterpret_cast<char*>(&mod_len), 2);
+    if (!in_ || 15u + mod_len > len) return false;
+
+    r.module.resize(mod_len);
+    r.message.resize(len - 15 - mod_len);
+    in_.read(r.module.data(), mod_len);
+    in_.read(r.message.data(), static_cast<std::streamsize>(r.message.size()));
+    if (!in_) return false;
+
+    offset += 4 + len;
+    return true;
+}
+
+/* Живой или оборванный сегмент: индекс по ходу, до последней целой записи.
+   Прочитанное в прошлый раз берётся из кеша — читается только хвост */
+void Reader::rebuild_index() {
+    constexpr uint32_t every = 256;
+    data_end_ = size_;
+
+    std::lock_guard lg(g_partial_mx);
+    uint64_t off = sizeof(kMagic);
+    if (auto it = g_partial.find(path_); it != g_partial.end() && it->second.data_end <= size_) {
+        off       = it->second.data_end;
+        index_    = it->second.index;
+        first_ts_ = it->second.first_ts;
+        last_ts_  = it->second.last_ts;
+    }
+
+    Record r;
+    uint64_t start = off;
+    while (read_record(off, r)) {
+        if (index_.empty() || index_.back().count >= every) {
+            index_.push_back(IndexEntry{ r.ts_us, start, 0, 0, {} });
+        }
+        index_.back().count++;
+        index_.back().level_mask |= static_cast<uint8_t>(1u << r.level);
+        if (!first_ts_) first_ts_ = r.ts_us;
+        last_ts_ = r.ts_us;
+        start = off;
+    }
+    data_end_ = start;
+    in_.clear();
+
+    Partial& p = g_partial[path_];
+    p.data_end = data_end_;
+    p.index    = index_;
+    p.first_ts = first_ts_;
+    p.last_ts  = last_ts_;
+}
+
+void Reader::scan(const Query& q, const std::function<bool(const Record&)>& fn) {
+    if (index_.empty()) return;
+
+    // Последний блок, начавшийся не позже from — с него и читаем
+    auto it = std::upper_bound(index_.begin(), index_.end(), q.from_us,
+                               [](int64_t ts, const IndexEntry& e) { return ts < e.first_ts; });
+    if (it != index_.begin()) --it;
+
+    Record r;
+    for (; it != index_.end(); ++it) {
+        if (it->first_ts > q.to_us) return;
+        if (!(it->level_mask & q.level_mask)) continue;
+
+        uint64_t off = it->offset;
+        for (uint32_t i = 0; i < it->count; ++i) {
+            if (!read_record(off, r)) return;
+            if (r.ts_us < q.from_us) continue;
+            if (r.ts_us > q.to_us)   return;
+            if (!(q.level_mask & (1u << r.level))) continue;
+            if (!q.module.empty() && r.module.compare(0, q.module.size(), q.module) != 0) continue;
+            if (!q.contains.empty() && r.message.find(q.contains) == std::string::npos) continue;
+            if (!fn(r)) return;
+        }
+    }
+}
+
+nlohmann::json query_dir(const std::string& dir, const Query& q) {
+    std::vector<fs::path> segments;
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(dir, ec)) {
+        if (e.path().extension() == ".mslog") segments.push_back(e.path());
+    }
+    std::sort(segments.begin(), segments.end());   // имя начинается со времени открытия
+
+    {
+        // Кеш сегментов, удалённых ротацией
+        std::lock_guard lg(g_partial_mx);
+        for (auto it = g_partial.begin(); it != g_partial.end(); ) {
+            const bool listed = std::any_of(segments.begin(), segments.end(),
+                                            [&](const fs::path& p) { return p.string() == it->first; });
+            it = listed ? std::next(it) : g_partial.erase(it);
+        }
+    }
+
+    nlohmann::json records = nlohmann::json::array();
+    bool truncated = false;
+
+    for (const auto& path : segments) {
+        Reader reader(path.string());
+        if (!reader.ok() || reader.last_ts() < q.from_us || reader.first_ts() > q.to_us) continue;
+
+        reader.scan(q, [&](const Record& r) {
+            if (records.size() >= q.limit) { truncated = true; return false; }
+            records.push_back(r.to_json());
+            return true;
+        });
+        if (truncated) break;
+    }
+    return { {"records", records}, {"truncated", truncated} };
+}
+
+}
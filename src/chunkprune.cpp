@@ -0,0 +1,542 @@
+#include "./includes/chunkprune.h"
+#include "./includes/regionfile.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifdef MSHOST_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr const char* kTmpSuffix = ".prune-tmp";
+constexpr const char* kOldSuffix = ".prune-old";
+constexpr int kMaxDepth = 512;   // вложенность NBT, дальше — битые данные
+
+/* ---------- Распакованный поток чанка: окно 16 КБ, без буфера на весь чанк ---------- */
+class Inflow {
+public:
+    Inflow(int compression, const unsigned char* data, size_t size) {
+        if (compression == 3) {   // без сжатия — окно и есть данные
+            win_ = data;
+            len_ = size;
+            ok_  = true;
+            return;
+        }
+#ifdef MSHOST_HAVE_ZLIB
+        if (compression == 1 || compression == 2) {   // gzip | zlib
+            zs_.next_in  = const_cast<Bytef*>(data);
+            zs_.avail_in = static_cast<uInt>(size);
+            ok_ = zinit_ = inflateInit2(&zs_, 15 + 32) == Z_OK;   // +32 — распознать оба
+            win_ = buf_;
+        }
+#endif
+    }
+    ~Inflow() {
+#ifdef MSHOST_HAVE_ZLIB
+        if (zinit_) inflateEnd(&zs_);
+#endif
+    }
+    Inflow(const Inflow&) = delete;
+    Inflow& operator=(const Inflow&) = delete;
+
+    bool ok() const { return ok_; }
+
+    bool read(void* dst, size_t n) {
+        auto* out = static_cast<unsigned char*>(dst);
+        while (n) {
+            if (pos_ == len_ && !fill()) return false;
+            const size_t k = (std::min)(n, len_ - pos_);
+            std::memcpy(out, win_ + pos_, k);
+            out += k;
+            pos_ += k;
+            n -= k;
+        }
+        return true;
+    }
+
+    bool skip(uint64_t n) {
+        while (n) {
+            if (pos_ == len_ && !fill()) return false;
+            const size_t k = static_cast<size_t>(std::min<uint64_t>(n, len_ - pos_));
+            pos_ += k;
+            n -= k;
+        }
+        return true;
+    }
+
+private:
+    bool fill() {
+#ifdef MSHOST_HAVE_ZLIB
+        if (!zinit_ || ended_) return false;
+        zs_.next_out  = buf_;
+        zs_.avail_out = sizeof(buf_);
+        const int r = inflate(&zs_, Z_NO_FLUSH);
+        if (r != Z_OK && r != Z_STREAM_END) return false;
+        ended_ = r == Z_STREAM_END;
+        pos_ = 0;
+        len_ = sizeof(buf_) - zs_.avail_out;
+        return len_ > 0 || fill();
+#else
+        return false;
+#endif
+    }
+
+    const unsigned char* win_ = nullptr;
+    size_t pos_ = 0, len_ = 0;
+    bool   ok_ = false;
+#ifdef MSHOST_HAVE_ZLIB
+    z_stream      zs_{};
+    bool          zinit_ = false, ended_ = false;
+    unsigned char buf_[16 * 1024];
+#endif
+};
+
+/* ---------- NBT: только пропуск полезной нагрузки и поиск одного поля ---------- */
+class NbtScan {
+public:
+    explicit NbtScan(Inflow& in) : in_(in) {}
+
+    /* Корень — именованный компаунд; в форматах до 1.18 всё лежит в Level */
+    bool inhabited_time(int64_t& out) {
+        uint8_t type;
+        uint16_t name_len;
+        if (!u8(type) || type != 10 || !be16(name_len) || !in_.skip(name_len)) return false;
+        return find(out, true);
+    }
+
+private:
+    bool find(int64_t& out, bool level_ok) {
+        for (;;) {
+            uint8_t type;
+            uint16_t name_len;
+            if (!u8(type) || type == 0 || !be16(name_len)) return false;
+
+            char name[16];
+            const bool wanted = (type == 4 || (type == 10 && level_ok)) && name_len < sizeof(name);
+            if (wanted) {
+                if (!in_.read(name, name_len)) return false;
+                name[name_len] = 0;
+                if (type == 4 && std::strcmp(name, "InhabitedTime") == 0) return be64(out);
+                if (type == 10 && std::strcmp(name, "Level") == 0) return find(out, false);
+            } else if (!in_.skip(name_len)) {
+                return false;
+            }
+            if (!skip_payload(type, 1)) return false;
+        }
+    }
+
+    static uint64_t fixed_size(uint8_t type) {
+        switch (type) {
+            case 1:         return 1;
+            case 2:         return 2;
+            case 3: case 5: return 4;
+            case 4: case 6: return 8;
+            default:        return 0;
+        }
+    }
+
+    bool skip_payload(uint8_t type, int depth) {
+        if (depth > kMaxDepth) return false;
+        if (const uint64_t n = fixed_size(type)) return in_.skip(n);
+
+        int32_t  count;
+        uint16_t len;
+        switch (type) {
+            case 7:  return be32(count) && count >= 0 && in_.skip(uint64_t(count));
+            case 11: return be32(count) && count >= 0 && in_.skip(uint64_t(count) * 4);
+            case 12: return be32(count) && count >= 0 && in_.skip(uint64_t(count) * 8);
+            case 8:  return be16(len) && in_.skip(len);
+            case 9: {
+                uint8_t elem;
+                if (!u8(elem) || !be32(count) || count < 0) return false;
+                if (count == 0) return true;
+                if (const uint64_t n = fixed_size(elem)) return in_.skip(n * uint64_t(count));
+                for (int32_t i = 0; i < count; ++i)
+                    if (!skip_payload(elem, depth + 1)) return false;
+                return true;
+            }
+            case 10:
+                for (;;) {
+                    uint8_t t;
+                    if (!u8(t)) return false;
+                    if (t == 0) return true;
+                    if (!be16(len) || !in_.skip(len) || !skip_payload(t, depth + 1)) return false;
+                }
+            default:
+                return false;
+        }
+    }
+
+    bool u8(uint8_t& v) { return in_.read(&v, 1); }
+    bool be16(uint16_t& v) {
+        unsigned char b[2];
+        if (!in_.read(b, 2)) return false;
+        v = uint16_t(b[0] << 8 | b[1]);
+        return true;
+    }
+    bool be32(int32_t& v) {
+        unsigned char b[4];
+        if (!in_.read(b, 4)) return false;
+        v = static_cast<int32_t>(MappedRegion::be32(b));
+        return true;
+    }
+    bool be64(int64_t& v) {
+        unsigned char b[8];
+        if (!in_.read(b, 8)) return false;
+        v = static_cast<int64_t>(uint64_t(MappedRegion::be32(b)) << 32 | MappedRegion::be32(b + 4));
+        return true;
+    }
+
+    Inflow& in_;
+};
+
+/* "2025-06-01" → unix-время полуночи UTC */
+int64_t parse_date(const std::string& s) {
+    int y = 0;
+    unsigned m = 0, d = 0;
+    char tail = 0;
+    if (std::sscanf(s.c_str(), "%d-%u-%u%c", &y, &m, &d, &tail) != 3 || m < 1 || m > 12 || d < 1 || d > 31)
+        throw std::invalid_argument("before: ожидается YYYY-MM-DD или unix-время");
+    // days_from_civil (H. Hinnant)
+    y -= m <= 2;
+    const int      era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t(era) * 146097 + int64_t(doe) - 719468) * 86400;
+}
+
+struct Group {
+    std::string dimension;
+    int rx = 0, rz = 0;
+    fs::path region;
+    std::vector<fs::path> companions;   // entities/, poi/ с тем же именем
+};
+
+void put_be32(unsigned char* p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+void add(PruneStats& to, const PruneStats& from) {
+    to.regions           += from.regions;
+    to.regions_rewritten += from.regions_rewritten;
+    to.regions_removed   += from.regions_removed;
+    to.errors            += from.errors;
+    to.chunks            += from.chunks;
+    to.chunks_dropped    += from.chunks_dropped;
+    to.undecodable       += from.undecodable;
+    to.broken            += from.broken;
+    to.bytes_before      += from.bytes_before;
+    to.bytes_after       += from.bytes_after;
+}
+
+/* Подготовленная замена файла: tmp готов, сам файл ещё не тронут */
+struct Staged {
+    fs::path path, tmp;
+    bool remove = false;              // чанков не осталось — файл удаляется
+    std::vector<fs::path> mcc;        // внешние чанки удалённых слотов
+};
+
+/* Записать рядом с файлом копию без слотов drop и без пустых секторов.
+   false — менять нечего (или dry_run); статистика считается в любом случае */
+bool stage(const fs::path& path, const std::bitset<MappedRegion::kSlots>& drop, int rx, int rz,
+           bool dry_run, PruneStats& st, Staged& out) {
+    struct Keep { int slot; uint64_t offset, bytes; };
+    std::vector<Keep> keep;
+    std::vector<fs::path> mcc;
+    bool changed = false;
+    const fs::path tmp = fs::path(path).concat(kTmpSuffix);
+
+    {
+        MappedRegion m(path);
+        st.bytes_before += m.size();
+        if (!m.has_header()) {
+            st.bytes_after += m.size();
+            return false;
+        }
+
+        for (int slot = 0; slot < MappedRegion::kSlots; ++slot) {
+            if (!m.location(slot)) continue;
+            ++st.chunks;
+            const uint64_t off = m.offset(slot), span = uint64_t(m.sectors(slot)) * MappedRegion::kSector;
+            if (drop[slot]) {
+                ++st.chunks_dropped;
+                changed = true;
+                if (off + 5 <= m.size() && (m.data()[off + 4] & 0x80)) {   // чанк во внешнем .mcc
+                    mcc.push_back(path.parent_path() / ("c." + std::to_string(rx * 32 + slot % 32) + "." +
+                                                        std::to_string(rz * 32 + slot / 32) + ".mcc"));
+                }
+                continue;
+            }
+            uint32_t len = 0;
+            if (m.chunk(slot, len)) {
+                keep.push_back({ slot, off, uint64_t(len) + 4 });
+            } else if (off >= MappedRegion::kHeaderBytes && off + span <= m.size()) {
+                keep.push_back({ slot, off, span });   // непонятный, но в границах — переносим как есть
+            } else {
+                ++st.broken;                            // ссылается за конец файла
+                changed = true;
+            }
+        }
+
+        std::sort(keep.begin(), keep.end(), [](const Keep& a, const Keep& b) { return a.offset < b.offset; });
+
+        std::vector<unsigned char> header(MappedRegion::kHeaderBytes, 0);
+        uint64_t sector = MappedRegion::kHeaderBytes / MappedRegion::kSector;
+        for (const auto& k : keep) {
+            const uint64_t n = (k.bytes + MappedRegion::kSector - 1) / MappedRegion::kSector;
+            if (sector * MappedRegion::kSector != k.offset || n != m.sectors(k.slot)) changed = true;
+            put_be32(header.data() + k.slot * 4, static_cast<uint32_t>(sector << 8 | n));
+            put_be32(header.data() + MappedRegion::kSector + k.slot * 4, m.timestamp(k.slot));
+            sector += n;
+        }
+        const uint64_t new_size = keep.empty() ? 0 : sector * MappedRegion::kSector;
+        if (new_size != m.size()) changed = true;
+        if (!changed) {
+            st.bytes_after += m.size();
+            return false;
+        }
+        st.bytes_after += new_size;
+        if (keep.empty()) ++st.regions_removed;
+        else              ++st.regions_rewritten;
+        if (!dry_run && !keep.empty()) {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+            static const char zeros[MappedRegion::kSector] = {};
+            for (const auto& k : keep) {
+                out.write(reinterpret_cast<const char*>(m.data() + k.offset), static_cast<std::streamsize>(k.bytes));
+                if (const uint64_t pad = k.bytes % MappedRegion::kSector)
+                    out.write(zeros, static_cast<std::streamsize>(MappedRegion::kSector - pad));
+            }
+            out.close();
+            if (!out) {
+                std::error_code ec;
+                fs::remove(tmp, ec);
+                throw std::runtime_error("не записан " + tmp.string());
+            }
+        }
+    }
+    if (dry_run) return false;
+
+    out = { path, tmp, keep.empty(), std::move(mcc) };
+    return true;
+}
+
+void discard(const std::vector<Staged>& staged) {
+    std::error_code ec;
+    for (const auto& s : staged) fs::remove(s.tmp, ec);
+}
+
+/* Подменить файлы группы разом: регион и его entities/poi не должны
+   разойтись. Старые отодвигаются в .prune-old, новые встают на место;
+   на любой ошибке старые возвращаются. Отображения к этому моменту
+   закрыты — на Windows поверх отображённого файла не переименовать. */
+void commit(const std::vector<Staged>& staged) {
+    auto old = [](const fs::path& p) { return fs::path(p).concat(kOldSuffix); };
+    size_t aside = 0;
+    try {
+        for (; aside < staged.size(); ++aside) fs::rename(staged[aside].path, old(staged[aside].path));
+        for (const auto& s : staged)
+            if (!s.remove) fs::rename(s.tmp, s.path);
+    } catch (...) {
+        std::error_code ec;
+        for (size_t i = 0; i < aside; ++i) fs::rename(old(staged[i].path), staged[i].path, ec);
+        discard(staged);
+        throw;
+    }
+    std::error_code ec;
+    for (const auto& s : staged) {
+        fs::remove(old(s.path), ec);
+        for (const auto& f : s.mcc) fs::remove(f, ec);
+    }
+}
+
+
+} // namespace
+
+PruneOptions PruneOptions::from_json(const json& j) {
+    PruneOptions o;
+    try {
+        if (!j.is_object()) throw std::invalid_argument("ожидается объект");
+        o.inhabited_below = j.value("inhabited_below", o.inhabited_below);
+        o.radius          = j.value("radius", o.radius);
+        o.dry_run         = j.value("dry_run", o.dry_run);
+        o.threads         = j.value("threads", o.threads);
+        o.dimensions      = j.value("dimensions", o.dimensions);
+        if (j.contains("center")) {
+            const auto& c = j.at("center");
+            if (!c.is_array() || c.size() != 2) throw std::invalid_argument("center: ожидается [x, z]");
+            o.center_x = c[0].get<int64_t>();
+            o.center_z = c[1].get<int64_t>();
+        }
+        if (j.contains("before")) {
+            const auto& b = j.at("before");
+            o.before = b.is_string() ? parse_date(b.get<std::string>()) : b.get<int64_t>();
+        }
+    } catch (const json::exception& e) {
+        throw std::invalid_argument(e.what());
+    }
+    if (o.inhabited_below < 0 && o.radius < 0 && o.before <= 0)
+        throw std::invalid_argument("не задано ни одного условия: inhabited_below, radius, before");
+    return o;
+}
+
+json PruneStats::to_json() const {
+    return {
+        {"regions",           regions},
+        {"regions_rewritten", regions_rewritten},
+        {"regions_removed",   regions_removed},
+        {"errors",            errors},
+        {"chunks",            chunks},
+        {"chunks_dropped",    chunks_dropped},
+        {"undecodable",       undecodable},
+        {"broken",            broken},
+        {"bytes_before",      bytes_before},
+        {"bytes_after",       bytes_after},
+        {"ms",                ms},
+        {"dry_run",           dry_run}
+    };
+}
+
+ChunkPruner::ChunkPruner(PruneOptions opt) : opt_(std::move(opt)) {}
+
+bool ChunkPruner::inhabited_time(int compression, const unsigned char* data, size_t size, int64_t& ticks) {
+    if (compression & 0x80) return false;   // внешний .mcc не разбираем
+    Inflow in(compression, data, size);
+    return in.ok() && NbtScan(in).inhabited_time(ticks);
+}
+
+PruneStats ChunkPruner::prune(const fs::path& world_dir) const {
+    const auto t0 = std::chrono::steady_clock::now();
+    std::error_code ec;
+    if (!fs::is_directory(world_dir, ec)) throw std::runtime_error("нет каталога мира: " + world_dir.string());
+
+    /* Группы: регион + одноимённые файлы entities/ и poi/ того же измерения */
+    std::map<std::pair<std::string, std::string>, Group> by_key;
+    for (auto it = fs::recursive_directory_iterator(world_dir, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        int rx, rz;
+        if (!it->is_regular_file(ec) || !MappedRegion::coords(it->path(), rx, rz)) continue;
+        std::string dimension, kind;
+        MappedRegion::classify(fs::relative(it->path().parent_path(), world_dir, ec), dimension, kind);
+        if (!opt_.dimensions.empty() &&
+            std::find(opt_.dimensions.begin(), opt_.dimensions.end(), dimension) == opt_.dimensions.end())
+            continue;
+
+        Group& g = by_key[{ it->path().parent_path().parent_path().string(), it->path().filename().string() }];
+        g.dimension = dimension;
+        g.rx = rx;
+        g.rz = rz;
+        if (kind == "region")                         g.region = it->path();
+        else if (kind == "entities" || kind == "poi") g.companions.push_back(it->path());
+    }
+    std::vector<Group> groups;
+    for (auto& [key, g] : by_key)
+        if (!g.region.empty()) groups.push_back(std::move(g));   // без региона решать не по чему
+
+    // Крупные первыми — потоки заканчивают примерно вместе
+    std::vector<std::pair<uintmax_t, size_t>> order;
+    for (size_t i = 0; i < groups.size(); ++i) order.push_back({ fs::file_size(groups[i].region, ec), i });
+    std::sort(order.begin(), order.end(), std::greater<>());
+
+    unsigned threads = opt_.threads ? opt_.threads : (std::max)(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::clamp<size_t>(threads, 1, std::max<size_t>(groups.size(), 1)));
+
+    const int64_t r2 = opt_.radius * opt_.radius;
+    PruneStats total;
+    total.dry_run = opt_.dry_run;
+    std::atomic<size_t> next{0};
+    std::mutex mx;
+
+    auto decide = [&](const Group& g, PruneStats& st) {
+        std::bitset<MappedRegion::kSlots> drop;
+        MappedRegion m(g.region);
+        if (!m.has_header()) return drop;
+        for (int slot = 0; slot < MappedRegion::kSlots; ++slot) {
+            if (!m.location(slot)) continue;
+            bool hit = true;
+            if (opt_.radius >= 0) {
+                const int64_t dx = int64_t(g.rx * 32 + slot % 32) * 16 + 8 - opt_.center_x;
+                const int64_t dz = int64_t(g.rz * 32 + slot / 32) * 16 + 8 - opt_.center_z;
+                hit = dx * dx + dz * dz > r2;
+            }
+            if (hit && opt_.before > 0) hit = int64_t(m.timestamp(slot)) < opt_.before;
+            if (hit && opt_.inhabited_below >= 0) {
+                uint32_t len = 0;
+                int64_t ticks = 0;
+                const unsigned char* c = m.chunk(slot, len);
+                if (c && inhabited_time(c[4], c + 5, len - 1, ticks)) {
+                    hit = ticks < opt_.inhabited_below;
+                } else {
+                    hit = false;
+                    ++st.undecodable;
+                }
+            }
+            drop[slot] = hit;
+        }
+        return drop;
+    };
+
+    auto worker = [&] {
+        PruneStats st;
+        for (size_t i; (i = next++) < order.size(); ) {
+            const Group& g = groups[order[i].second];
+            try {
+                const auto drop = decide(g, st);
+                std::vector<Staged> staged;
+                PruneStats own, side;   // в st — только после commit; у entities/poi считаем лишь байты
+                try {
+                    Staged one;
+                    if (stage(g.region, drop, g.rx, g.rz, opt_.dry_run, own, one)) staged.push_back(std::move(one));
+                    for (const auto& f : g.companions)
+                        if (stage(f, drop, g.rx, g.rz, opt_.dry_run, side, one)) staged.push_back(std::move(one));
+                } catch (...) {
+                    discard(staged);
+                    throw;
+                }
+                commit(staged);
+                own.bytes_before += side.bytes_before;
+                own.bytes_after  += side.bytes_after;
+                ++own.regions;
+                add(st, own);
+            } catch (const std::exception& e) {
+                ++st.errors;
+                LOG_WARNING(std::string("Регион пропущен: ") + e.what(), "WORLD");
+            }
+        }
+        std::lock_guard lg(mx);
+        add(total, st);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    total.ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    LOG_INFO(std::string(opt_.dry_run ? "Пробный проход: " : "Мир прорежен: ") + "чанков удалено " +
+             std::to_string(total.chunks_dropped) + " из " + std::to_string(total.chunks) + ", " +
+             std::to_string(total.bytes_before / (1024 * 1024)) + " → " +
+             std::to_string(total.bytes_after / (1024 * 1024)) + " МБ за " + std::to_string(total.ms) + " мс", "WORLD");
+    if (total.undecodable)
+        LOG_WARNING("Не разобрано чанков (оставлены): " + std::to_string(total.undecodable), "WORLD");
+    return total;
+}
@@ -0,0 +1,364 @@
+#include "./includes/clonebackup.h"
+#include "./includes/logger.h"
+#include "./includes/metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+CloneBackup::CloneBackup(fs::path root, BackupOptions opt)
+    : root_(std::move(root)), opt_(std::move(opt)) {}
+
+std::vector<std::string> CloneBackup::snapshots() const {
+    std::vector<std::string> out;
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(root_ / "clones", ec)) {
+        if (e.path().extension() == ".json") out.push_back(e.path().stem().string());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+/* ------------------------------------------------------------------ */
+/*                      Клонирование / копирование                    */
+/* ------------------------------------------------------------------ */
+#ifdef _WIN32
+
+bool CloneBackup::clone_supported(const fs::path& src_dir, const fs::path& dst_dir) {
+    wchar_t src_vol[MAX_PATH], dst_vol[MAX_PATH];
+    if (!GetVolumePathNameW(src_dir.wstring().c_str(), src_vol, MAX_PATH) ||
+        !GetVolumePathNameW(dst_dir.wstring().c_str(), dst_vol, MAX_PATH)) return false;
+    if (_wcsicmp(src_vol, dst_vol) != 0) return false;   // клон — только в пределах тома
+
+    DWORD flags = 0;
+    if (!GetVolumeInformationW(src_vol, nullptr, 0, nullptr, nullptr, &flags, nullptr, 0)) return false;
+    return (flags & FILE_SUPPORTS_BLOCK_REFCOUNTING) != 0;
+}
+
+/*  Как в примере Microsoft для ReFS: целевой файл той же разреженности
+    и длины, диапазоны кратны кластеру, хвост округляется вверх (за EOF
+    ничего не попадёт). Не вышло (например, у источника integrity
+    streams, а у копии нет) — удаляем и копируем.                       */
+bool CloneBackup::clone_file(const fs::path& src, const fs::path& dst, uint64_t size) {
+    HANDLE in = CreateFileW(src.wstring().c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (in == INVALID_HANDLE_VALUE) return false;
+    HANDLE out = CreateFileW(dst.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+                             nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (out == INVALID_HANDLE_VALUE) {
+        CloseHandle(in);
+        return false;
+    }
+
+    bool ok = true;
+    DWORD ret = 0;
+    BY_HANDLE_FILE_INFORMATION info{};
+    FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity{};
+    ok = GetFileInformationByHandle(in, &info) &&
+         DeviceIoControl(in, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0,
+                         &integrity, sizeof(integrity), &ret, nullptr);
+
+    if (ok && (info.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE))
+        ok = DeviceIoControl(out, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &ret, nullptr);
+
+    FILE_END_OF_FILE_INFO eof{};
+    eof.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+    if (ok) ok = SetFileInformationByHandle(out, FileEndOfFileInfo, &eof, sizeof(eof));
+
+    const uint64_t cluster = integrity.ClusterSizeInBytes ? integrity.ClusterSizeInBytes : 4096;
+    const uint64_t total   = (size + cluster - 1) / cluster * cluster;
+    constexpr uint64_t kStep = 1ull << 30;   // ByteCount — меньше 4 ГБ за вызов
+    for (uint64_t off = 0; ok && off < total; off += kStep) {
+        DUPLICATE_EXTENTS_DATA d{};
+        d.FileHandle                = in;
+        d.SourceFileOffset.QuadPart = static_cast<LONGLONG>(off);
+        d.TargetFileOffset.QuadPart = static_cast<LONGLONG>(off);
+        d.ByteCount.QuadPart        = static_cast<LONGLONG>((std::min)(kStep, total - off));
+        ok = DeviceIoControl(out, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &d, sizeof(d), nullptr, 0, &ret, nullptr);
+    }
+
+    if (ok) SetFileTime(out, nullptr, nullptr, &info.ftLastWriteTime);   // mtime как у оригинала
+    CloseHandle(out);
+    CloseHandle(in);
+
+    if (!ok) {
+        std::error_code ec;
+        fs::remove(dst, ec);
+    }
+    return ok;
+}
+
+void CloneBackup::copy_file(const fs::path& src, const fs::path& dst) {
+    // Сам CopyFileW на новых сборках Windows тоже клонирует, если может
+    if (!CopyFileW(src.wstring().c_str(), dst.wstring().c_str(), FALSE))
+        throw std::runtime_error("CopyFileW " + src.string() + ": ошибка " + std::to_string(GetLastError()));
+}
+
+#else
+
+bool CloneBackup::clone_supported(const fs::path& src_dir, const fs::path& dst_dir) {
+#ifdef FICLONE
+    struct stat a{}, b{};
+    // Сам FICLONE проверит файловую систему; здесь — только один том
+    return stat(src_dir.c_str(), &a) == 0 && stat(dst_dir.c_str(), &b) == 0 && a.st_dev == b.st_dev;
+#else
+    (void)src_dir; (void)dst_dir;
+    return false;
+#endif
+}
+
+bool CloneBackup::clone_file(const fs::path& src, const fs::path& dst, uint64_t) {
+#ifdef FICLONE
+    const int in = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    const int out = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+    const bool ok = ioctl(out, FICLONE, in) == 0;
+    close(out);
+    close(in);
+    if (!ok) {
+        std::error_code ec;
+        fs::remove(dst, ec);
+    }
+    return ok;
+#else
+    (void)src; (void)dst;
+    return false;
+#endif
+}
+
+void CloneBackup::copy_file(const fs::path& src, const fs::path& dst) {
+#ifdef __linux__
+    // copy_file_range: копирует ядро, без буфера в процессе (а NFS/XFS — ещё и на сервере)
+    const int in = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    const int out = in < 0 ? -1 : open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool fallback = false;
+    if (in >= 0 && out >= 0) {
+        for (;;) {
+            const ssize_t n = copy_file_range(in, nullptr, out, nullptr, 1 << 30, 0);
+            if (n > 0) continue;
+            if (n < 0) fallback = errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP;
+            if (n < 0 && !fallback) {
+                const std::string err = std::strerror(errno);
+                close(out);
+                close(in);
+                throw std::runtime_error("copy_file_range " + src.string() + ": " + err);
+            }
+            break;
+        }
+    }
+    if (out >= 0) close(out);
+    if (in >= 0) close(in);
+    if (in >= 0 && out >= 0 && !fallback) return;
+#endif
+    fs::copy_file(src, dst, fs::copy_options::overwrite_existing);
+}
+
+#endif
+
+/* ------------------------------------------------------------------ */
+/*                            Восстановление                          */
+/* ------------------------------------------------------------------ */
+void CloneBackup::restore_file(const std::string& name, const json& entry, const fs::path& dst, RestoreStats& st) const {
+    const std::string rel  = entry.at("path").get<std::string>();
+    const uint64_t    size = entry.at("size").get<uint64_t>();
+    const fs::path    src  = root_ / "clones" / name / fs::path(rel);
+
+    std::error_code ec;
+    if (fs::file_size(src, ec) != size || ec)
+        throw std::runtime_error(rel + ": файл снимка отсутствует или изменён");
+
+    if (!clone_file(src, dst, size)) copy_file(src, dst);
+    if (fs::file_size(dst, ec) != size || ec) throw std::runtime_error(rel + ": размер не сходится с манифестом");
+    fs::last_write_time(dst, fs::file_time_type(fs::file_time_type::duration(entry.at("mtime").get<int64_t>())), ec);
+
+    ++st.files;
+    st.bytes += size;
+}
+
+/* ------------------------------------------------------------------ */
+/*                                Снимок                              */
+/* ------------------------------------------------------------------ */
+BackupStats CloneBackup::snapshot(const fs::path& world_dir) {
+    const auto t0 = std::chrono::steady_clock::now();
+    std::error_code ec;
+    if (!fs::is_directory(world_dir, ec)) throw std::runtime_error("нет каталога мира: " + world_dir.string());
+
+    const fs::path clones = root_ / "clones";
+    fs::create_directories(clones, ec);
+    if (ec) throw std::runtime_error("хранилище недоступно: " + clones.string() + " (" + ec.message() + ")");
+
+    // Остатки прерванных снимков
+    for (const auto& e : fs::directory_iterator(clones, ec)) {
+        if (e.path().extension() == ".part") fs::remove_all(e.path(), ec);
+    }
+
+    BackupStats total;
+    total.name = WorldBackup::next_name(snapshots());
+    const fs::path staging = clones / (total.name + ".part");
+    fs::create_directories(staging);
+
+    const bool try_clone = clone_supported(world_dir, staging);
+    if (!try_clone) {
+        LOG_INFO("Клонирование блоков недоступно (нужны ReFS/Dev Drive и хранилище на том же томе) — копирование", "BACKUP");
+    }
+
+    struct Item { fs::path abs; std::string rel; uint64_t size; int64_t mtime; };
+    std::vector<Item> items;
+    std::set<fs::path> dirs;
+    for (auto it = fs::recursive_directory_iterator(world_dir, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        std::error_code fec;
+        const fs::path rel = fs::relative(it->path(), world_dir, fec);
+        if (it->is_directory(fec)) {
+            dirs.insert(rel);
+            continue;
+        }
+        if (!it->is_regular_file(fec) || it->path().filename() == "session.lock") continue;
+        items.push_back({ it->path(), rel.generic_string(), it->file_size(fec),
+                          it->last_write_time(fec).time_since_epoch().count() });
+    }
+    if (ec) {
+        fs::remove_all(staging, ec);
+        throw std::runtime_error("обход мира: " + ec.message());
+    }
+    for (const auto& d : dirs) fs::create_directories(staging / d);   // дерево — до потоков
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.size > b.size; });
+
+    unsigned threads = opt_.threads ? opt_.threads : (std::max)(1u, std::thread::hardware_concurrency() / 2);
+    threads = static_cast<unsigned>(std::clamp<size_t>(threads, 1, std::max<size_t>(items.size(), 1)));
+
+    std::vector<char> cloned(items.size(), 0);
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex mx;
+    std::string error;
+
+    auto worker = [&] {
+        for (size_t i; !failed && (i = next++) < items.size(); ) {
+            const fs::path dst = staging / fs::path(items[i].rel);
+            try {
+                if (try_clone && clone_file(items[i].abs, dst, items[i].size)) {
+                    cloned[i] = 1;
+                } else {
+                    copy_file(items[i].abs, dst);
+                }
+            } catch (const std::exception& e) {
+                std::lock_guard lg(mx);
+                if (!failed.exchange(true)) error = items[i].rel + ": " + e.what();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    if (failed) {
+        fs::remove_all(staging, ec);
+        throw std::runtime_error(error);
+    }
+
+    json files = json::array();
+    size_t n_cloned = 0;
+    std::vector<size_t> order(items.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return items[a].rel < items[b].rel; });
+    for (size_t i : order) {
+        const auto& it = items[i];
+        files.push_back({ {"path", it.rel}, {"size", it.size}, {"mtime", it.mtime},
+                          {"method", cloned[i] ? "clone" : "copy"} });
+        ++total.files;
+        if (cloned[i]) {
+            ++n_cloned;
+            total.bytes_cloned += it.size;
+        } else {
+            total.bytes_read    += it.size;
+            total.bytes_written += it.size;
+        }
+    }
+    total.method = n_cloned == items.size() && !items.empty() ? "clone"
+                 : n_cloned == 0                              ? "copy"
+                                                              : "clone+copy";
+
+    // Каталог готов — переименовываем, манифест последним
+    fs::rename(staging, clones / total.name);
+    total.ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+
+    const json manifest = {
+        {"format",  1},
+        {"name",    total.name},
+        {"created", static_cast<int64_t>(std::time(nullptr))},
+        {"world",   world_dir.filename().string()},
+        {"stats",   total.to_json()},
+        {"files",   files}
+    };
+    const fs::path path = clones / (total.name + ".json");
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out << manifest.dump();
+        if (!out) throw std::runtime_error("манифест не записан: " + tmp.string());
+    }
+    fs::rename(tmp, path);
+
+    static auto& snaps  = Metrics::instance().counter("backup.snapshots");
+    static auto& copied = Metrics::instance().counter("backup.bytes_written");
+    static auto& dur    = Metrics::instance().histogram("backup.duration_us");
+    ++snaps;
+    copied += total.bytes_written;
+    dur.record(static_cast<uint64_t>(total.ms) * 1000);
+
+    LOG_INFO("Снимок " + total.name + " (" + total.method + "): файлов " + std::to_string(total.files) +
+             ", склонировано " + std::to_string(total.bytes_cloned / (1024 * 1024)) + " МБ, скопировано " +
+             std::to_string(total.bytes_written / (1024 * 1024)) + " МБ за " + std::to_string(total.ms) + " мс",
+             "BACKUP");
+
+    try {
+        enforce_retention();
+    } catch (const std::exception& e) {
+        LOG_WARNING("Чистка старых снимков не удалась: " + std::string(e.what()), "BACKUP");
+    }
+    return total;
+}
+
+/* ---------- keep: удаляем самые старые каталоги с манифестами ---------- */
+void CloneBackup::enforce_retention() {
+    if (opt_.keep == 0) return;
+    const auto names = snapshots();
+    if (names.size() <= opt_.keep) return;
+
+    const size_t drop = names.size() - opt_.keep;
+    for (size_t i = 0; i < drop; ++i) {
+        fs::remove(root_ / "clones" / (names[i] + ".json"));   // сначала манифест: без него снимка нет
+        fs::remove_all(root_ / "clones" / names[i]);
+    }
+    LOG_INFO("Удалено снимков: " + std::to_string(drop), "BACKUP");
+}
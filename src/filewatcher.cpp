@@ -0,0 +1,226 @@
+#include "./includes/filewatcher.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+int FileWatcher::watch(const std::string& file, ChangeFn on_change, int debounce_ms) {
+    const fs::path path = fs::absolute(file);
+
+    auto w = std::make_shared<Watch>();
+    w->name        = path.filename().wstring();
+    w->path        = path;
+    w->on_change   = std::move(on_change);
+    w->debounce_ms = debounce_ms;
+
+    std::error_code ec;
+    w->mtime = fs::last_write_time(path, ec);
+    w->size  = fs::file_size(path, ec);
+
+    const std::wstring dir = path.parent_path().wstring();
+
+    std::lock_guard lg(mx_);
+    w->id = next_id_++;
+
+    auto it = std::find_if(dirs_.begin(), dirs_.end(),
+                           [&](const auto& d) { return _wcsicmp(d->path.c_str(), dir.c_str()) == 0; });
+    if (it == dirs_.end()) {
+        dirs_.push_back(std::make_unique<Dir>());
+        dirs_.back()->path = dir;
+        it = std::prev(dirs_.end());
+    }
+    (*it)->watches.push_back(w);
+
+    stop_ = false;
+    if (!wake_) wake_ = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+    if (!thread_.joinable()) thread_ = std::thread(&FileWatcher::loop, this);
+    SetEvent(wake_);
+
+    LOG_INFO("Слежу за " + path.string(), "WATCH");
+    return w->id;
+}
+
+void FileWatcher::unwatch(int id) {
+    // Колбэки идут под dispatch_mx_; из самого колбэка блокировка уже взята
+    std::unique_lock<std::mutex> dg(dispatch_mx_, std::defer_lock);
+    if (std::this_thread::get_id() != thread_.get_id()) dg.lock();
+
+    std::lock_guard lg(mx_);
+    for (auto& d : dirs_) {
+        d->watches.erase(std::remove_if(d->watches.begin(), d->watches.end(),
+                                        [id](const auto& w) { return w->id == id; }),
+                         d->watches.end());
+    }
+    if (wake_) SetEvent(wake_);   // пустой каталог закроет сам цикл
+}
+
+void FileWatcher::shutdown() {
+    {
+        std::lock_guard lg(mx_);
+        stop_ = true;
+        if (wake_) SetEvent(wake_);
+    }
+    if (thread_.joinable() && std::this_thread::get_id() != thread_.get_id()) thread_.join();
+}
+
+/* ---------- Поставить асинхронное чтение изменений каталога ---------- */
+bool FileWatcher::arm(Dir& d) {
+    if (d.handle == INVALID_HANDLE_VALUE) {
+        d.handle = CreateFileW(d.path.c_str(), FILE_LIST_DIRECTORY,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               nullptr, OPEN_EXISTING,
+                               FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (d.handle == INVALID_HANDLE_VALUE) return false;
+        d.event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    }
+
+    ResetEvent(d.event);
+    ZeroMemory(&d.ov, sizeof(d.ov));
+    d.ov.hEvent = d.event;
+
+    d.armed = ReadDirectoryChangesW(d.handle, d.buf, sizeof(d.buf), FALSE,
+                                    FILE_NOTIFY_CHANGE_FILE_NAME |
+                                    FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                    FILE_NOTIFY_CHANGE_SIZE,
+                                    nullptr, &d.ov, nullptr) != FALSE;
+    return d.armed;
+}
+
+void FileWatcher::close_dir(Dir& d) {
+    if (d.handle != INVALID_HANDLE_VALUE) {
+        if (d.armed) {
+            DWORD bytes = 0;
+            CancelIoEx(d.handle, &d.ov);
+            GetOverlappedResult(d.handle, &d.ov, &bytes, TRUE);   // буфер свободен только после этого
+        }
+        CloseHandle(d.handle);
+        d.handle = INVALID_HANDLE_VALUE;
+    }
+    if (d.event) CloseHandle(d.event);
+    d.event = nullptr;
+    d.armed = false;
+}
+
+/* ---------- Разбор пачки событий: отмечаем, какие файлы трогали ---------- */
+void FileWatcher::collect(Dir& d, DWORD bytes) {
+    const auto now = Clock::now();
+    auto touch = [now](Watch& w) {
+        w.pending = true;
+        w.due     = now + std::chrono::milliseconds(w.debounce_ms);
+    };
+
+    if (bytes == 0) {                 // буфер переполнился — считаем, что менялось всё
+        for (auto& w : d.watches) touch(*w);
+        return;
+    }
+
+    const char* p = d.buf;
+    for (;;) {
+        auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+        if (info->Action == FILE_ACTION_ADDED ||
+            info->Action == FILE_ACTION_MODIFIED ||
+            info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+        {
+            const std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+            for (auto& w : d.watches) {
+                if (_wcsicmp(w->name.c_str(), name.c_str()) == 0) touch(*w);
+            }
+        }
+        if (!info->NextEntryOffset) break;
+        p += info->NextEntryOffset;
+    }
+}
+
+/* ---------- Колбэки для файлов, которые успокоились ---------- */
+void FileWatcher::fire_due() {
+    std::lock_guard dg(dispatch_mx_);
+
+    std::vector<std::shared_ptr<Watch>> due;
+    {
+        std::lock_guard lg(mx_);
+        const auto now = Clock::now();
+        for (auto& d : dirs_) {
+            for (auto& w : d->watches) {
+                if (w->pending && w->due <= now) {
+                    w->pending = false;
+                    due.push_back(w);
+                }
+            }
+        }
+    }
+
+    for (auto& w : due) {
+        std::error_code ec;
+        auto mtime = fs::last_write_time(w->path, ec);
+        if (ec) continue;             // файл ещё не вернули на место — дождёмся его rename
+        auto size = fs::file_size(w->path, ec);
+        if (mtime == w->mtime && size == w->size) continue;
+        w->mtime = mtime;
+        w->size  = size;
+
+        LOG_INFO("Изменён " + w->path.string(), "WATCH");
+        try {
+            w->on_change();
+        } catch (const std::exception& ex) {
+            LOG_ERR(std::string("[watch] Exception: ") + ex.what(), "WATCH");
+        } catch (...) {
+            LOG_ERR("[watch] Unknown exception.", "WATCH");
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*                               LOOP                                 */
+/* ------------------------------------------------------------------ */
+void FileWatcher::loop() {
+    for (;;) {
+        std::vector<HANDLE> events;
+        std::vector<Dir*>   order;
+        DWORD timeout = INFINITE;
+        {
+            std::lock_guard lg(mx_);
+            if (stop_) {
+                for (auto& d : dirs_) close_dir(*d);
+                dirs_.clear();
+                return;
+            }
+
+            const auto now = Clock::now();
+            for (auto it = dirs_.begin(); it != dirs_.end();) {
+                Dir& d = **it;
+                if (d.watches.empty()) {
+                    close_dir(d);
+                    it = dirs_.erase(it);
+                    continue;
+                }
+                if (!d.armed && !arm(d)) {
+                    LOG_ERR("ReadDirectoryChangesW: ошибка " + std::to_string(GetLastError()), "WATCH");
+                    timeout = (std::min)(timeout, DWORD(5000));   // каталог могли переименовать — повторим позже
+                } else if (events.size() < MAXIMUM_WAIT_OBJECTS - 1) {
+                    events.push_back(d.event);
+                    order.push_back(&d);
+                }
+
+                for (auto& w : d.watches) {
+                    if (!w->pending) continue;
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(w->due - now).count();
+                    timeout = (std::min)(timeout, static_cast<DWORD>(std::max<long long>(left, 0)));
+                }
+                ++it;
+            }
+            events.push_back(wake_);
+        }
+
+        DWORD rc = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, timeout);
+        if (rc >= WAIT_OBJECT_0 && rc < WAIT_OBJECT_0 + order.size()) {
+            std::lock_guard lg(mx_);
+            Dir& d = *order[rc - WAIT_OBJECT_0];
+            DWORD bytes = 0;
+            if (GetOverlappedResult(d.handle, &d.ov, &bytes, FALSE)) collect(d, bytes);
+            d.armed = false;          // перепоставим на следующем круге
+        }
+
+        fire_due();
+    }
+}
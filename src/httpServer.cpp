@@ -10,11 +10,27 @@
 #include <codecvt>
 #include <limits>
 #include <ws2tcpip.h>
+#ifdef _WIN32
+#include <sddl.h>
+#else
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#endif
 
+#include "./includes/filewatcher.h"
+#include "./includes/metrics.h"
 #include "./includes/logger.h"
+#include "./includes/logsearch.h"
+#include "./includes/scheduler.h"
 
 using json = nlohmann::json;
 
+namespace {
+    // Начало текущего запроса в потоке пула (pre-routing → logger)
+    thread_local std::chrono::steady_clock::time_point t_request_start;
+}
+
 std::string status_to_string(ServerStatus status) {
     switch (status) {
         case ServerStatus::Stopped: return "Остановлен";
@@ -25,29 +41,227 @@ std::string status_to_string(ServerStatus status) {
     }
 }
 
-HttpServer::HttpServer(MinecraftServerManager& manager, 
+/* Игроки инстанса: список онлайн или ?name=<ник или uuid> */
+static void reply_players(const MinecraftServerManager& mc, const httplib::Request& req, httplib::Response& res) {
+    if (!req.has_param("name")) {
+        res.set_content(mc.players().dump(), "application/json");
+        return;
+    }
+    const json p = mc.player(req.get_param_value("name"));
+    if (p.is_null()) {
+        res.status = 404;
+        res.set_content(json{{"error", "unknown player"}}.dump(), "application/json");
+        return;
+    }
+    res.set_content(p.dump(), "application/json");
+}
+
+/* "1760292000" (unix-секунды) или локальное "YYYY-MM-DD HH:MM[:SS]" / с 'T' → мкс */
+static int64_t parse_time_param(const std::string& v) {
+    if (!v.empty() && std::all_of(v.begin(), v.end(), ::isdigit)) {
+        return std::stoll(v) * 1000000;
+    }
+    std::string s = v;
+    std::replace(s.begin(), s.end(), 'T', ' ');
+
+    std::tm tm{};
+    std::istringstream in(s);
+    in >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+    if (in.fail()) {
+        tm = {};
+        in.clear();
+        in.str(s);
+        in >> std::get_time(&tm, "%Y-%m-%d %H:%M");
+        if (in.fail()) throw std::invalid_argument("время \"" + v + "\"");
+    }
+    tm.tm_isdst = -1;
+    return static_cast<int64_t>(std::mktime(&tm)) * 1000000;
+}
+
+HttpServer::HttpServer(ServerRegistry& servers, 
     int port, 
     std::atomic<bool>& running, 
     const std::string& tokens_file,
     const std::string& logs_path,
     const std::string& modpack_path,
     const std::string& web_root,
-    int upload_limit)
-    : manager_(manager), 
+    int upload_limit,
+    const std::string& session_secret,
+    int session_ttl_s,
+    bool allow_raw_token)
+    : servers_(servers),
+      manager_(servers.primary()), 
       port_(port), 
       running_(running), 
       tokens_file_(tokens_file),
       logs_path_(logs_path),
       modpack_path_(modpack_path),
       web_root_(web_root),
-      upload_limit_(upload_limit * 1024 * 1024)
+      upload_limit_(upload_limit * 1024 * 1024),
+      sessions_(session_secret, session_ttl_s),
+      allow_raw_token_(allow_raw_token)
 {
     load_tokens();
+    tokens_watch_ = FileWatcher::instance().watch(tokens_file_, [this] { load_tokens(); });
+}
+
+HttpServer::~HttpServer() {
+    FileWatcher::instance().unwatch(tokens_watch_);
+}
+
+void HttpServer::configure(const json& web) {
+    if (web.contains("pool")) pool_opt_ = WorkerPool::Options::from_json(web["pool"]);
+
+    if (web.contains("http")) {
+        const auto& h = web["http"];
+        http_opt_.keep_alive_max_count = h.value("keep_alive_max_count", http_opt_.keep_alive_max_count);
+        http_opt_.keep_alive_timeout_s = h.value("keep_alive_timeout_s", http_opt_.keep_alive_timeout_s);
+        http_opt_.read_timeout_s       = h.value("read_timeout_s",       http_opt_.read_timeout_s);
+        http_opt_.write_timeout_s      = h.value("write_timeout_s",      http_opt_.write_timeout_s);
+        http_opt_.idle_interval_ms     = h.value("idle_interval_ms",     http_opt_.idle_interval_ms);
+        http_opt_.payload_max_kb       = h.value("payload_max_kb",       http_opt_.payload_max_kb);
+        http_opt_.tcp_nodelay          = h.value("tcp_nodelay",          http_opt_.tcp_nodelay);
+        http_opt_.reuse_port           = h.value("reuse_port",           http_opt_.reuse_port);
+    }
+
+    if (web.contains("unix_socket")) {
+        const auto& u = web["unix_socket"];
+        if (u.value("enabled", true)) unix_opt_.path = u.value("path", "");
+        unix_opt_.sddl = u.value("sddl", unix_opt_.sddl);
+        if (u.contains("mode")) {
+            // "0660" или 660 — цифры в любом случае восьмеричные, как у chmod
+            const auto& m = u["mode"];
+            try {
+                const std::string digits = m.is_number_integer() ? std::to_string(m.get<long long>())
+                                                                 : m.get<std::string>();
+                size_t used = 0;
+                const int mode = std::stoi(digits, &used, 8);
+                if (used != digits.size() || mode < 0 || mode > 0777) throw std::invalid_argument(digits);
+                unix_opt_.mode = mode;
+            } catch (const std::exception&) {
+                LOG_WARNING("web.unix_socket.mode: ожидаются восьмеричные права вроде \"0660\", получено " +
+                            m.dump() + " — оставлено 0660", "WEB");
+                unix_opt_.mode = 0660;
+            }
+        }
+    }
+}
+
+/* ---------- AF_UNIX: Caddy ходит через unix//, TCP-порт не открыт ---------- */
+bool HttpServer::listen_unix() {
+    std::error_code ec;
+    std::filesystem::remove(unix_opt_.path, ec);   // сокет прошлого запуска мешает bind
+
+    svr.set_address_family(AF_UNIX);
+
+    /* bind сразу и слушает: права должны быть у файла с момента создания.
+       Порт для AF_UNIX не используется, но 0 httplib понимает как «любой»
+       и ищет его через getsockname — bind тогда всегда «не удаётся» */
+    constexpr int kUnixPort = 80;
+#ifdef _WIN32
+    prepare_socket_dir();
+    const bool bound = svr.bind_to_port(unix_opt_.path, kUnixPort);
+#else
+    const mode_t old_mask = umask(static_cast<mode_t>(~unix_opt_.mode & 0777));
+    const bool bound = svr.bind_to_port(unix_opt_.path, kUnixPort);
+    umask(old_mask);
+#endif
+    if (!bound) {
+        LOG_ERR("Не удалось открыть unix-сокет " + unix_opt_.path +
+                " (нужна Windows 10 1803+ и afunix.h при сборке)", "WEB");
+        return false;
+    }
+    restrict_socket_file();
+
+    LOG_INFO("HTTP сервер слушает unix-сокет: " + unix_opt_.path, "WEB");
+    bool ok = svr.listen_after_bind();
+    std::filesystem::remove(unix_opt_.path, ec);
+    return ok;
+}
+
+#ifdef _WIN32
+/* Файл сокета наследует DACL каталога. Каталог, которого ещё нет,
+   создаём с тем же sddl, но с наследованием на файлы (OI) — тогда сокет
+   закрыт уже при bind. В существующем каталоге DACL ставится после bind */
+void HttpServer::prepare_socket_dir() {
+    const std::filesystem::path dir = std::filesystem::path(unix_opt_.path).parent_path();
+    std::error_code ec;
+    if (dir.empty() || std::filesystem::exists(dir, ec)) return;
+    std::filesystem::create_directories(dir.parent_path(), ec);
+
+    std::string sddl = unix_opt_.sddl;
+    for (size_t p = 0; (p = sddl.find("(A;;", p)) != std::string::npos; p += 6) sddl.replace(p, 4, "(A;OI;");
+
+    PSECURITY_DESCRIPTOR sd = nullptr;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorA(sddl.c_str(), SDDL_REVISION_1, &sd, nullptr)) {
+        LOG_WARNING("sddl unix-сокета не разобран: ошибка " + std::to_string(GetLastError()), "WEB");
+        return;
+    }
+    SECURITY_ATTRIBUTES sa{ sizeof(sa), sd, FALSE };
+    if (!CreateDirectoryA(dir.string().c_str(), &sa)) {
+        LOG_WARNING("Каталог unix-сокета не создан: ошибка " + std::to_string(GetLastError()), "WEB");
+    }
+    LocalFree(sd);
+}
+#endif
+
+void HttpServer::restrict_socket_file() {
+#ifdef _WIN32
+    // Сокет — файл NTFS: права задаются DACL (по умолчанию SYSTEM, администраторы, владелец)
+    PSECURITY_DESCRIPTOR sd = nullptr;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorA(unix_opt_.sddl.c_str(), SDDL_REVISION_1, &sd, nullptr) ||
+        !SetFileSecurityA(unix_opt_.path.c_str(), DACL_SECURITY_INFORMATION | PROTECTED_DACL_SECURITY_INFORMATION, sd))
+    {
+        LOG_WARNING("Права на unix-сокет не выставлены: ошибка " + std::to_string(GetLastError()), "WEB");
+    }
+    if (sd) LocalFree(sd);
+#else
+    if (chmod(unix_opt_.path.c_str(), static_cast<mode_t>(unix_opt_.mode)) != 0) {
+        LOG_WARNING("Права на unix-сокет не выставлены: " + std::string(std::strerror(errno)), "WEB");
+    }
+#endif
+}
+
+void HttpServer::apply_http_tuning() {
+    const auto& h = http_opt_;
+    svr.set_keep_alive_max_count(h.keep_alive_max_count);
+    svr.set_keep_alive_timeout(h.keep_alive_timeout_s);
+    svr.set_read_timeout(h.read_timeout_s, 0);
+    svr.set_write_timeout(h.write_timeout_s, 0);
+    if (h.idle_interval_ms > 0) svr.set_idle_interval(0, h.idle_interval_ms * 1000);
+    svr.set_payload_max_length(h.payload_max_kb * 1024);
+    svr.set_tcp_nodelay(h.tcp_nodelay);
+
+    // SO_REUSEPORT на Windows нет, а SO_REUSEADDR (умолчание httplib)
+    // позволяет чужому процессу занять тот же порт
+    svr.set_socket_options([reuse = h.reuse_port](socket_t sock) {
+        int on = 1;
+#ifdef _WIN32
+        setsockopt(sock, SOL_SOCKET, reuse ? SO_REUSEADDR : SO_EXCLUSIVEADDRUSE,
+                   reinterpret_cast<const char*>(&on), sizeof(on));
+#else
+        setsockopt(sock, SOL_SOCKET, reuse ? SO_REUSEPORT : SO_REUSEADDR, &on, sizeof(on));
+#endif
+    });
+
+    LOG_INFO("HTTP: keep-alive " + std::to_string(h.keep_alive_max_count) + " запросов / " +
+             std::to_string(h.keep_alive_timeout_s) + " с, nodelay " + (h.tcp_nodelay ? "вкл" : "выкл"), "WEB");
+}
+
+void HttpServer::set_tokens_file(const std::string& tokens_file) {
+    {
+        std::lock_guard lg(reload_mx_);
+        if (tokens_file == tokens_file_) return;
+        tokens_file_ = tokens_file;
+    }
+    FileWatcher::instance().unwatch(tokens_watch_);
+    tokens_watch_ = FileWatcher::instance().watch(tokens_file, [this] { load_tokens(); });
+    load_tokens();
 }
 
 void HttpServer::load_tokens() {
-    std::lock_guard lg(tokens_mx_);
-    std::unordered_set<std::string> fresh;
+    std::lock_guard lg(reload_mx_);
+    auto fresh = std::make_shared<TokenSet>();
     std::ifstream f(tokens_file_);
     if (!f) {
         LOG_ERR("Не смог открыть " + tokens_file_, "WEB");
@@ -57,26 +271,74 @@ void HttpServer::load_tokens() {
     while (std::getline(f, line)) {
         line.erase(0, line.find_first_not_of(" \t\r\n"));
         line.erase(line.find_last_not_of(" \t\r\n") + 1);
-        if (!line.empty() && line[0] != '#') fresh.insert(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        // "<токен>" или "<токен> read|control"; без права — control, как раньше
+        Scope scope = Scope::Control;
+        size_t sp = line.find_first_of(" \t");
+        if (sp != std::string::npos) {
+            std::string name = line.substr(line.find_first_not_of(" \t", sp));
+            line.erase(sp);
+            scope = parse_scope(name);
+            if (scope == Scope::None) {
+                LOG_WARNING("Неизвестное право \"" + name + "\" у токена, пропущен", "WEB");
+                continue;
+            }
+        }
+        fresh->push_back({ Sha256::hash(line), scope });
     }
-    tokens_.swap(fresh);
-    LOG_INFO("Токены перечитаны, всего: " + std::to_string(tokens_.size()), "WEB");
+    const size_t count = fresh->size();
+    std::atomic_store(&tokens_, std::shared_ptr<const TokenSet>(std::move(fresh)));
+    LOG_INFO("Токены перечитаны, всего: " + std::to_string(count), "WEB");
 }
 
-bool HttpServer::check_token(const std::string& t) {
-    std::lock_guard lg(tokens_mx_);
-    return tokens_.count(t) > 0;
+/* Сверяем хеш со всеми записями без раннего выхода: время ответа
+   не зависит ни от содержимого токена, ни от того, какой из них совпал */
+Scope HttpServer::check_token(const std::string& t) {
+    if (t.empty()) return Scope::None;
+    const auto snapshot = std::atomic_load(&tokens_);
+    const auto digest   = Sha256::hash(t);
+
+    uint8_t found = 0;
+    for (const auto& e : *snapshot) {
+        uint8_t match = Sha256::equal(e.hash, digest) ? 0xff : 0;
+        found |= match & static_cast<uint8_t>(e.scope);
+    }
+    return (found & static_cast<uint8_t>(Scope::Control)) ? Scope::Control : static_cast<Scope>(found);
+}
+
+/* Сессия (Authorization: Bearer / X-Session-Token / ?session=) проверяется
+   одной HMAC без обращения к общим данным; долгий токен — по снимку */
+Scope HttpServer::authorize(const httplib::Request& req) {
+    std::string session = req.get_header_value("Authorization");
+    if (session.rfind("Bearer ", 0) == 0) session.erase(0, 7);
+    else session.clear();
+    if (session.empty()) session = req.get_header_value("X-Session-Token");
+    if (session.empty()) {
+        auto it = req.params.find("session");
+        if (it != req.params.end()) session = it->second;
+    }
+    if (!session.empty()) return sessions_.verify(session);
+
+    if (!allow_raw_token_) return Scope::None;
+
+    auto token = req.get_header_value("X-API-Token");
+    if (token.empty()) {
+        auto it = req.params.find("token");
+        if (it != req.params.end()) token = it->second;
+    }
+    return check_token(token);
 }
 
 json HttpServer::get_status_json() {
-    ServerStatus status = manager_.get_status();
+    return get_status_json(manager_);
+}
 
-    return json{
-        {"status", status_to_string(status)},
-        {"ip", "91.223.70.49"},
-        {"port", 25566},
-        {"version", "Forge 1.20.1"}
-    };
+json HttpServer::get_status_json(const MinecraftServerManager& mc) {
+    json out = mc.display_info();
+    out["status"] = status_to_string(mc.get_status());
+    out["id"]     = mc.id();
+    return out;
 }
 // ────────────────────────────────────────────────────────────────
 //  sanitize_utf8  —   пропускает только корректные UTF‑8 байты
@@ -153,20 +415,29 @@ void HttpServer::run() {
 
         LOG_INFO("[" + client_ip + "] " + req.method + " " + req.path, "WEB");
 
-        if (req.path.rfind("/api/", 0) == 0) {
-            auto token = req.get_header_value("X-API-Token");
+        t_request_start = std::chrono::steady_clock::now();
+        if (pool_ && !pool_->admit(WorkerPool::lane_of(req.path))) {
+            res.status = 503;
+            res.set_header("Retry-After", "1");
+            res.set_content("Service Unavailable", "text/plain");
+            return httplib::Server::HandlerResponse::Handled;
+        }
 
-            if (token.empty()) {
-                auto it = req.params.find("token");
-                if (it != req.params.end()) {
-                    token = it->second;
-                }
-            }
-            if (!check_token(token)) {
+        // /api/login сам проверяет долгий токен и выдаёт сессию
+        if (req.path.rfind("/api/", 0) == 0 && req.path != "/api/login") {
+            const Scope have = authorize(req);
+            const Scope need = (req.method == "GET" || req.method == "HEAD") ? Scope::Read : Scope::Control;
+
+            if (have == Scope::None) {
                 res.status = 401;
                 res.set_content("Unauthorized", "text/plain");
                 return httplib::Server::HandlerResponse::Handled;
             }
+            if (!scope_allows(have, need)) {
+                res.status = 403;
+                res.set_content("Forbidden: нужно право control", "text/plain");
+                return httplib::Server::HandlerResponse::Handled;
+            }
         }
 
         std::string proto = req.get_header_value("X-Forwarded-Proto");
@@ -183,11 +454,111 @@ void HttpServer::run() {
     });
 
     // Эндпоинты API
+    /* Обмен долгого токена на короткую подписанную сессию.
+       Тело (необязательно): {"token": "...", "scope": "read"} — права можно только сузить */
+    svr.Post("/api/login", [this](const httplib::Request& req, httplib::Response& res) {
+        json body = json::parse(req.body, nullptr, false);
+        if (body.is_discarded()) body = json::object();
+
+        std::string token = req.get_header_value("X-API-Token");
+        if (token.empty() && body.is_object()) token = body.value("token", "");
+
+        const Scope granted = check_token(token);
+        if (granted == Scope::None) {
+            res.status = 401;
+            res.set_content("Unauthorized", "text/plain");
+            return;
+        }
+
+        Scope scope = granted;
+        if (body.is_object() && body.contains("scope")) {
+            scope = parse_scope(body.value("scope", ""));
+            if (scope == Scope::None || !scope_allows(granted, scope)) {
+                res.status = 403;
+                res.set_content("Forbidden: такого права у токена нет", "text/plain");
+                return;
+            }
+        }
+
+        int64_t expires_at = 0;
+        json out{
+            {"session",    sessions_.issue(scope, expires_at)},
+            {"scope",      scope_name(scope)},
+            {"expires_at", expires_at},
+            {"expires_in", sessions_.ttl_s()}
+        };
+        res.set_content(out.dump(), "application/json");
+    });
+
     svr.Get("/api/status", [this](const httplib::Request&, httplib::Response& res) {
         json response = get_status_json();
         res.set_content(response.dump(), "application/json");
     });
 
+    /* Полнотекстовый поиск по текущему server.log и архиву сессий:
+       ?q=слово "точная фраза"&from=...&to=...&limit=100&cursor=<next прошлой страницы>
+       Сначала свежие строки; все слова и фразы обязательны.             */
+    svr.Get("/api/logs/search", [](const httplib::Request& req, httplib::Response& res) {
+        if (!LogSearch::instance().enabled()) {
+            res.status = 404;
+            res.set_content("Поиск по логам выключен (logging.search)", "text/plain");
+            return;
+        }
+        try {
+            int64_t from_us = INT64_MIN, to_us = INT64_MAX;
+            size_t  limit   = 100;
+            if (req.has_param("from"))  from_us = parse_time_param(req.get_param_value("from"));
+            if (req.has_param("to"))    to_us   = parse_time_param(req.get_param_value("to"));
+            if (req.has_param("limit")) limit   = std::clamp<size_t>(std::stoul(req.get_param_value("limit")), 1, 1000);
+
+            const json out = LogSearch::instance().search(req.get_param_value("q"), from_us, to_us, limit,
+                                                          req.get_param_value("cursor"));
+            res.set_content(out.dump(-1, ' ', false, json::error_handler_t::replace), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(std::string("Неверный параметр: ") + e.what(), "text/plain");
+        }
+    });
+
+    /* Выборка из структурированного лога:
+       ?from=2026-10-12 21:00&to=2026-10-12 21:05&level=WARN,ERROR&module=MC_OUT&q=текст&limit=500
+       from/to — локальное время "YYYY-MM-DD HH:MM[:SS]" или unix-секунды */
+    svr.Get("/api/logs/query", [](const httplib::Request& req, httplib::Response& res) {
+        const std::string dir = Logger::instance().structuredDir();
+        if (dir.empty()) {
+            res.status = 404;
+            res.set_content("Структурированный лог выключен (logging.structured)", "text/plain");
+            return;
+        }
+
+        binlog::Query q;
+        try {
+            if (req.has_param("from")) q.from_us = parse_time_param(req.get_param_value("from"));
+            if (req.has_param("to"))   q.to_us   = parse_time_param(req.get_param_value("to"));
+            if (req.has_param("level")) {
+                q.level_mask = 0;
+                std::stringstream ss(req.get_param_value("level"));
+                std::string name;
+                while (std::getline(ss, name, ',')) {
+                    int lvl = binlog::parse_level(name);
+                    if (lvl < 0) throw std::invalid_argument("level: " + name);
+                    q.level_mask |= static_cast<uint8_t>(1u << lvl);
+                }
+            }
+            if (req.has_param("limit")) q.limit = std::min<size_t>(std::stoul(req.get_param_value("limit")), 10000);
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(std::string("Неверный параметр: ") + e.what(), "text/plain");
+            return;
+        }
+        q.module   = req.get_param_value("module");
+        q.contains = req.get_param_value("q");
+
+        Logger::instance().flushStructured();
+        res.set_content(binlog::query_dir(dir, q).dump(-1, ' ', false, json::error_handler_t::replace),
+                        "application/json");
+    });
+
     svr.Get("/api/logs", [this](const httplib::Request& req, httplib::Response& res) {
         std::ifstream log;
 
@@ -346,9 +717,49 @@ void HttpServer::run() {
         res.set_content(get_status_json().dump(), "application/json");
     });
 
+    svr.Post("/api/restart", [this](const httplib::Request&, httplib::Response& res) {
+        manager_.restart();
+        res.set_content(get_status_json().dump(), "application/json");
+    });
+
+    // Игроки основного инстанса; ?name=<ник или uuid> — один игрок с сессиями
+    svr.Get("/api/players", [this](const httplib::Request& req, httplib::Response& res) {
+        reply_players(manager_, req, res);
+    });
+
+    svr.Get("/api/metrics", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(Metrics::instance().to_json().dump(), "application/json");
+    });
+
+    // Планировщик: задачи с ближайшим сроком; POST — разовая задача
+    // {"delay_s": 600, "action": "restart", "server": "main"}
+    svr.Get("/api/schedule", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(Scheduler::instance().to_json().dump(), "application/json");
+    });
+
+    svr.Post("/api/schedule", [](const httplib::Request& req, httplib::Response& res) {
+        try {
+            res.set_content(Scheduler::instance().add_once(json::parse(req.body)).dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+        }
+    });
+
+    svr.Delete(R"(/api/schedule/([\w\-\.]+))", [](const httplib::Request& req, httplib::Response& res) {
+        if (!Scheduler::instance().cancel(req.matches[1])) {
+            res.status = 404;
+            res.set_content(json{{"error", "нет такой задачи"}}.dump(), "application/json");
+            return;
+        }
+        res.set_content(json{{"cancelled", std::string(req.matches[1])}}.dump(), "application/json");
+    });
+
+    register_instance_routes();
+
     svr.Post("/api/exit", [this](const httplib::Request&, httplib::Response& res) {
         std::wcout << L"Получен запрос на завершение работы через API" << std::endl;
-        manager_.stop();
+        servers_.stop_all();
         this->stop();
         running_ = false;
         #ifdef _WIN32
@@ -378,16 +789,35 @@ void HttpServer::run() {
     });
 
     // Фронтенд
+    // Время обслуживания по полосам; здесь же запрос отдаёт bulk-слот
+    svr.set_logger([this](const httplib::Request& req, const httplib::Response&) {
+        static auto& control_us = Metrics::instance().histogram("web.control_us");
+        static auto& bulk_us    = Metrics::instance().histogram("web.bulk_us");
+
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t_request_start).count();
+        (WorkerPool::lane_of(req.path) == WorkerPool::Lane::Bulk ? bulk_us : control_us).record(us);
+        if (pool_) pool_->release();
+    });
+
     svr.set_mount_point("/", web_root_);
     svr.Get("/", [](const httplib::Request&, httplib::Response& res) {
         res.set_redirect("/index.html");
     });
 
-    LOG_INFO("HTTP сервер запущен на порту: " + std::to_string(port_), "WEB");
     try {
-        svr.new_task_queue = [] { return new httplib::ThreadPool(4); };
-        if (!svr.listen("0.0.0.0", port_)) {
-            LOG_ERR("Не удалось запустить сервер!", "WEB");
+        apply_http_tuning();
+        svr.new_task_queue = [this] {
+            pool_ = new WorkerPool(pool_opt_);
+            return pool_;
+        };
+        if (!unix_opt_.path.empty()) {
+            if (!listen_unix()) LOG_ERR("Не удалось запустить сервер!", "WEB");
+        } else {
+            LOG_INFO("HTTP сервер запущен на порту: " + std::to_string(port_), "WEB");
+            if (!svr.listen("0.0.0.0", port_)) {
+                LOG_ERR("Не удалось запустить сервер!", "WEB");
+            }
         }
     } catch (const std::exception& ex) {
         LOG_ERR(std::string("Ошибка: ") + ex.what(), "WEB");
@@ -396,6 +826,153 @@ void HttpServer::run() {
 
 }
 
+// ────────────────────────────────────────────────────────────────
+//  /api/servers/<id>/...  —  маршруты конкретного инстанса
+// ────────────────────────────────────────────────────────────────
+void HttpServer::register_instance_routes() {
+    using Action = std::function<void(MinecraftServerManager&, const httplib::Request&, httplib::Response&)>;
+
+    auto with_server = [this](Action action) {
+        return [this, action](const httplib::Request& req, httplib::Response& res) {
+            MinecraftServerManager* mc = servers_.find(req.matches[1]);
+            if (!mc) {
+                res.status = 404;
+                res.set_content(json{{"error", "unknown server"}}.dump(), "application/json");
+                return;
+            }
+            action(*mc, req, res);
+        };
+    };
+
+    svr.Get("/api/servers", [this](const httplib::Request&, httplib::Response& res) {
+        json list = json::array();
+        for (const auto& mc : servers_.all()) list.push_back(get_status_json(*mc));
+        res.set_content(json{{"servers", list}}.dump(), "application/json");
+    });
+
+    svr.Get(R"(/api/servers/([\w\-]+)/status)", with_server([this](auto& mc, const auto&, auto& res) {
+        res.set_content(get_status_json(mc).dump(), "application/json");
+    }));
+
+    svr.Get(R"(/api/servers/([\w\-]+)/logs)", with_server([](auto& mc, const auto& req, auto& res) {
+        size_t n = 500;
+        if (req.has_param("lines")) n = std::strtoul(req.get_param_value("lines").c_str(), nullptr, 10);
+
+        std::string logs;
+        for (const auto& l : mc.recent_output(n)) logs += sanitize_utf8(l) + "\n";
+        res.set_content(json{{"logs", logs}}.dump(), "application/json");
+    }));
+
+    svr.Post(R"(/api/servers/([\w\-]+)/command)", with_server([this](auto& mc, const auto& req, auto& res) {
+        try {
+            auto body = json::parse(req.body);
+            mc.send_command(body["command"].template get<std::string>());
+            res.set_content(get_status_json(mc).dump(), "application/json");
+        } catch (...) {
+            res.status = 400;
+            res.set_content(json{{"error", "invalid request"}}.dump(), "application/json");
+        }
+    }));
+
+    svr.Post(R"(/api/servers/([\w\-]+)/start)", with_server([this](auto& mc, const auto&, auto& res) {
+        mc.start();
+        res.set_content(get_status_json(mc).dump(), "application/json");
+    }));
+
+    svr.Post(R"(/api/servers/([\w\-]+)/stop)", with_server([this](auto& mc, const auto&, auto& res) {
+        mc.stop();
+        res.set_content(get_status_json(mc).dump(), "application/json");
+    }));
+
+    svr.Post(R"(/api/servers/([\w\-]+)/restart)", with_server([this](auto& mc, const auto&, auto& res) {
+        mc.restart();
+        res.set_content(get_status_json(mc).dump(), "application/json");
+    }));
+
+    // Снимок мира; тело необязательно: {"full": true} — перечитать всё
+    svr.Post(R"(/api/servers/([\w\-]+)/backup)", with_server([](auto& mc, const auto& req, auto& res) {
+        bool full = false;
+        if (!req.body.empty()) {
+            try {
+                full = json::parse(req.body).value("full", false);
+            } catch (...) {
+                res.status = 400;
+                res.set_content(json{{"error", "invalid request"}}.dump(), "application/json");
+                return;
+            }
+        }
+        try {
+            res.set_content(mc.backup(full).dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 409;
+            res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+        }
+    }));
+
+    // Отчёт по регионам мира: ?top=20
+    svr.Get(R"(/api/servers/([\w\-]+)/world)", with_server([](auto& mc, const auto& req, auto& res) {
+        size_t top = 20;
+        if (req.has_param("top")) top = std::clamp<size_t>(std::strtoul(req.get_param_value("top").c_str(), nullptr, 10), 1, 1000);
+        try {
+            res.set_content(mc.world_report(top).dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 404;
+            res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+        }
+    }));
+
+    // {"inhabited_below": 1200, "radius": 5000, "center": [0, 0], "before": "2025-01-01",
+    //  "dimensions": ["minecraft:overworld"], "dry_run": true} — условия объединяются по И
+    svr.Post(R"(/api/servers/([\w\-]+)/world/prune)", with_server([](auto& mc, const auto& req, auto& res) {
+        PruneOptions opt;
+        try {
+            opt = PruneOptions::from_json(json::parse(req.body));
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+            return;
+        }
+        try {
+            res.set_content(mc.prune(opt).dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 409;
+            res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+        }
+    }));
+
+    svr.Get(R"(/api/servers/([\w\-]+)/players)", with_server([](auto& mc, const auto& req, auto& res) {
+        reply_players(mc, req, res);
+    }));
+
+    svr.Get(R"(/api/servers/([\w\-]+)/backups)", with_server([](auto& mc, const auto&, auto& res) {
+        res.set_content(json{{"backups", mc.backups()}}.dump(), "application/json");
+    }));
+
+    // {"name": "20261019-081943", "paths": ["DIM-1", "region/r.0.0.mca"]} — paths необязательны
+    svr.Post(R"(/api/servers/([\w\-]+)/restore)", with_server([](auto& mc, const auto& req, auto& res) {
+        std::string name;
+        std::vector<std::string> paths;
+        try {
+            auto body = json::parse(req.body);
+            name  = body.at("name").template get<std::string>();
+            paths = body.value("paths", std::vector<std::string>{});
+        } catch (...) {
+            res.status = 400;
+            res.set_content(json{{"error", "invalid request"}}.dump(), "application/json");
+            return;
+        }
+        try {
+            res.set_content(mc.restore(name, paths).dump(), "application/json");
+        } catch (const std::invalid_argument& e) {
+            res.status = 404;
+            res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 409;
+            res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+        }
+    }));
+}
+
 void HttpServer::stop() {
     LOG_WARNING("Остановка WEB сервера...", "WEB");
     svr.stop();
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "sha256.h"
+
+/* ===== Инкрементальный бэкап мира с дедупликацией =====
+   Хранилище инстанса (<dir>/<id>/):
+     objects/ab/<sha256>     — содержимое по хешу, общее для всех снимков
+     snapshots/<имя>.json    — манифест: путь → размер, mtime, рецепт
+
+   Единица дедупликации в .mca — чанк: слот таблицы расположения,
+   [длина][сжатие][данные] ровно как в файле. Остальные файлы (level.dat,
+   playerdata, data, .mcc) режутся по содержимому gear-хешем на
+   куски 16..256 КБ. Рецепт файла (список кусков) — тоже объект, поэтому
+   неизменённый файл в новом снимке стоит одну строку манифеста.
+
+   Что не читается вовсе:
+     файл с тем же размером и mtime, что в прошлом снимке;
+     чанк с той же меткой времени и тем же местом в файле, что в прошлом
+     рецепте (сервер пишет изменённый чанк в новые секторы).
+   full = true — перечитать и перехешировать всё.
+
+   Согласованность обеспечивает вызывающий (save-off / save-all flush);
+   здесь только чтение мира и запись в хранилище, пул потоков по файлам.
+
+   config.json, "server": { "backup": { "mode": "dedup", "dir": "../backups",
+                                         "threads": 0, "keep": 48 } }
+   mode "clone" — клонирование блоков, см. clonebackup.h.                 */
+struct BackupOptions {
+    std::string mode    = "dedup";   // "dedup" | "clone"
+    std::string dir     = "../backups";
+    unsigned    threads = 0;   // 0 — половина ядер
+    size_t      keep    = 0;   // сколько снимков хранить, 0 — все
+
+    static BackupOptions from_json(const nlohmann::json& backup);
+};
+
+struct BackupStats {
+    std::string name;             // имя снимка (манифеста)
+    std::string method;           // dedup / clone / copy / clone+copy
+    size_t   files          = 0;
+    size_t   files_skipped  = 0;  // не менялись с прошлого снимка
+    size_t   chunks         = 0;  // чанков/кусков в прочитанных файлах
+    size_t   chunks_new     = 0;  // из них записано в хранилище
+    uint64_t bytes_read     = 0;
+    uint64_t bytes_written  = 0;
+    uint64_t bytes_cloned   = 0;  // ссылки на те же кластеры, без чтения
+    int64_t  ms             = 0;
+
+    nlohmann::json to_json() const;
+};
+
+struct RestoreStats {
+    std::string name;             // снимок
+    std::string kind;             // dedup / clone
+    size_t   files     = 0;
+    size_t   chunks    = 0;       // объектов прочитано и сверено по SHA-256
+    size_t   removed   = 0;       // файлов, которых не было в снимке
+    uint64_t bytes     = 0;
+    int64_t  ms        = 0;
+    std::string previous;         // куда убран прежний мир / прежние файлы
+
+    nlohmann::json to_json() const;
+};
+
+class WorldBackup {
+public:
+    /* root — <dir>/<id> */
+    WorldBackup(std::filesystem::path root, BackupOptions opt);
+
+    /* Снимок world_dir. Бросает std::runtime_error — манифест тогда не пишется */
+    BackupStats snapshot(const std::filesystem::path& world_dir, bool full = false);
+
+    /* Снимки по возрастанию имени (= времени) */
+    std::vector<std::string> snapshots() const;
+
+    /* Имя нового снимка (время UTC), строго больше последнего из names */
+    static std::string next_name(const std::vector<std::string>& names);
+
+    /* Один файл манифеста → dst. Каждый объект сверяется с SHA-256 из
+       своего имени, размер — с манифестом. Бросает std::runtime_error */
+    void restore_file(const nlohmann::json& entry, const std::filesystem::path& dst, RestoreStats& st) const;
+
+    /* Формат рецептов — общий с восстановлением */
+    struct Piece {
+        Sha256::Digest hash{};
+        uint32_t length   = 0;   // байт в объекте
+        uint16_t slot     = 0;   // .mca: индекс в таблице расположения
+        uint32_t location = 0;   // .mca: (сектор << 8) | число секторов
+        uint32_t mtime    = 0;   // .mca: метка времени чанка
+    };
+    struct Recipe {
+        bool region = false;
+        std::vector<Piece> pieces;
+    };
+
+    static std::string encode(const Recipe& r);
+    static bool        decode(const std::string& blob, Recipe& r);
+
+    std::filesystem::path object_path(const Sha256::Digest& h) const;
+    std::filesystem::path object_path(const std::string& hex) const;
+    std::filesystem::path manifest_path(const std::string& name) const;
+
+private:
+    struct Prev {
+        uint64_t    size  = 0;
+        int64_t     mtime = 0;
+        std::string recipe;   // hex
+    };
+
+    nlohmann::json backup_file(const std::filesystem::path& abs, const std::string& rel,
+                               const Prev* prev, bool full, BackupStats& st);
+    void backup_region(std::ifstream& in, uint64_t size, const Recipe* prev, Recipe& out, BackupStats& st);
+    void backup_stream(std::ifstream& in, Recipe& out, BackupStats& st);
+
+    /* Запись объекта, если его ещё нет. true — записан */
+    bool put(const Sha256::Digest& h, const char* data, size_t n);
+    bool load(const std::string& hex, std::string& out) const;
+    bool fetch(const std::string& hex, std::string& out) const;   // load + сверка хеша
+
+    void enforce_retention();
+
+    std::filesystem::path root_;
+    BackupOptions opt_;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+/* ===== Структурированный лог (.mslog) =====
+   Сегмент:  "MSLOG\0\1\0"
+             запись*   u32 len | i64 ts_us | u8 level | u32 thread | u16 mod_len | module | message
+             индекс*   IndexEntry — одна на index_every записей
+             хвост     Trailer
+   Индекс разреженный: время первой записи блока, смещение и маска
+   уровней блока. Поиск по времени — бинарный по индексу, блоки без
+   нужных уровней пропускаются целиком. У незакрытого сегмента (живой
+   или после падения) хвоста нет — индекс строится проходом по файлу,
+   кешируется по пути и на следующем запросе дочитывается только
+   дописанное. Запись сбрасывается на диск пачками; Logger сбрасывает
+   буфер перед запросом. Перед новым сегментом старые удаляются: не
+   больше keep_segments закрытых и не старше max_age_days (0 — без
+   ограничения), как у текстовых логов.                               */
+namespace binlog {
+
+#pragma pack(push, 1)
+struct IndexEntry {
+    int64_t  first_ts;     // мкс от эпохи
+    uint64_t offset;       // начало блока в файле
+    uint32_t count;        // записей в блоке
+    uint8_t  level_mask;   // бит на LogLevel
+    uint8_t  pad[3];
+};
+
+struct Trailer {
+    uint64_t index_offset;
+    uint32_t entries;
+    uint32_t magic;        // 'MSIX'
+    int64_t  first_ts;
+    int64_t  last_ts;
+};
+#pragma pack(pop)
+
+constexpr char     kMagic[8]     = { 'M', 'S', 'L', 'O', 'G', 0, 1, 0 };
+constexpr uint32_t kTrailerMagic = 0x5849534d;   // "MSIX"
+
+struct Record {
+    int64_t     ts_us;
+    uint8_t     level;
+    uint32_t    thread;
+    std::string module;
+    std::string message;
+
+    nlohmann::json to_json() const;
+};
+
+const char* level_name(uint8_t level);
+int         parse_level(const std::string& s);   // -1 — не уровень
+
+/* ---------- Запись (вызывается под мьютексом Logger) ---------- */
+class Writer {
+public:
+    Writer(std::string dir, uint64_t segment_bytes, uint32_t index_every,
+           size_t keep_segments = 0, int max_age_days = 0);
+    ~Writer();
+
+    void append(int64_t ts_us, uint8_t level, uint32_t thread,
+                const std::string& module, const std::string& message);
+    void close();   // дописать индекс и хвост
+    void flush();   // сбросить буфер на диск (перед запросом к живому сегменту)
+
+private:
+    void open_next();
+    void enforce_retention();   // до открытия нового: живой сегмент не трогаем
+
+    std::string  dir_;
+    uint64_t     segment_bytes_;
+    uint32_t     index_every_;
+    size_t       keep_segments_;
+    int          max_age_days_;
+
+    std::ofstream out_;
+    std::string   path_;
+    uint64_t      offset_ = 0;
+    int64_t       first_ts_ = 0, last_ts_ = 0;
+    std::vector<IndexEntry> index_;
+    uint32_t      seq_ = 0;
+    std::vector<char> buf_;
+
+    /* Сброс пачками: не чаще раза в секунду или по 64 КБ */
+    std::vector<char> filebuf_;
+    uint64_t      unflushed_ = 0;
+    std::chrono::steady_clock::time_point flushed_at_{};
+};
+
+/* ---------- Чтение ---------- */
+struct Query {
+    int64_t     from_us    = INT64_MIN;
+    int64_t     to_us      = INT64_MAX;
+    uint8_t     level_mask = 0xff;
+    std::string module;          // префикс; пусто — любой
+    std::string contains;        // подстрока сообщения
+    size_t      limit      = 1000;
+};
+
+class Reader {
+public:
+    explicit Reader(const std::string& path);
+
+    bool ok() const { return ok_; }
+    int64_t first_ts() const { return first_ts_; }
+    int64_t last_ts()  const { return last_ts_; }
+
+    /* false из колбэка — остановиться */
+    void scan(const Query& q, const std::function<bool(const Record&)>& fn);
+
+private:
+    bool read_record(uint64_t& offset, Record& r);
+    void rebuild_index();
+
+    std::string path_;
+    std::ifstream in_;
+    uint64_t size_ = 0, data_end_ = 0;
+    std::vector<IndexEntry> index_;
+    int64_t first_ts_ = 0, last_ts_ = 0;
+    bool ok_ = false;
+};
+
+/* Запрос по всем сегментам каталога, в порядке времени */
+nlohmann::json query_dir(const std::string& dir, const Query& q);
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+/* ===== Прореживание мира: удаление чанков из .mca =====
+   Только на остановленном сервере. Регионы обрабатываются пулом потоков
+   по одному: решение принимается по region/r.x.z.mca, те же слоты
+   вычищаются из entities/ и poi/ этого измерения, чтобы при повторной
+   генерации чанка не всплыли его старые сущности.
+
+   Чанк удаляется, если подходит под ВСЕ заданные условия:
+     inhabited_below — InhabitedTime (тики, 20 в секунду) меньше порога;
+     radius          — центр чанка дальше radius блоков от center;
+     before          — метка времени в заголовке раньше (unix, секунды).
+   Хотя бы одно условие обязательно. InhabitedTime читается потоковым
+   разбором NBT прямо из распаковки zlib/gzip: дерево не строится,
+   поля кроме InhabitedTime пропускаются, разбор прекращается, как только
+   поле найдено. Чанк, который не удалось разобрать (LZ4, сборка без
+   zlib, битые данные), остаётся.
+
+   Оставшиеся чанки переписываются вплотную, в прежнем порядке по
+   смещению, каждый — в минимум секторов: свободные секторы и хвосты
+   пропадают. Новый файл пишется рядом (.prune-tmp) и заменяет старый
+   переименованием — прерванный проход оставляет целые регионы. Регион
+   без чанков удаляется, внешние .mcc удалённых чанков — тоже.
+   dry_run — только посчитать.                                          */
+struct PruneOptions {
+    int64_t  inhabited_below = -1;          // тики, -1 — не проверять
+    int64_t  radius          = -1;          // блоки, -1 — не проверять
+    int64_t  center_x = 0, center_z = 0;    // блоки
+    int64_t  before          = 0;           // unix-время, 0 — не проверять
+                                            // (в JSON можно "YYYY-MM-DD", UTC)
+    std::vector<std::string> dimensions;    // "minecraft:overworld", пусто — все
+    bool     dry_run = false;
+    unsigned threads = 0;                   // 0 — все ядра
+
+    /* {"inhabited_below", "radius", "center": [x, z], "before",
+        "dimensions", "dry_run"}; std::invalid_argument при ошибке */
+    static PruneOptions from_json(const nlohmann::json& j);
+};
+
+struct PruneStats {
+    size_t   regions = 0, regions_rewritten = 0, regions_removed = 0, errors = 0;
+    uint64_t chunks = 0, chunks_dropped = 0, undecodable = 0, broken = 0;
+    uint64_t bytes_before = 0, bytes_after = 0;
+    int64_t  ms = 0;
+    bool     dry_run = false;
+
+    nlohmann::json to_json() const;
+};
+
+class ChunkPruner {
+public:
+    explicit ChunkPruner(PruneOptions opt);
+
+    /* Бросает std::runtime_error, если мира нет */
+    PruneStats prune(const std::filesystem::path& world_dir) const;
+
+    /* Потоковый поиск InhabitedTime в сжатом чанке (байт сжатия + данные);
+       false — не нашли или не смогли распаковать */
+    static bool inhabited_time(int compression, const unsigned char* data, size_t size, int64_t& ticks);
+
+private:
+    PruneOptions opt_;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "backup.h"
+
+/* ===== Снимок мира клонированием блоков (server.backup.mode = "clone") =====
+   ReFS и Dev Drive умеют FSCTL_DUPLICATE_EXTENTS_TO_FILE: копия — это
+   новые ссылки на те же кластеры, данные не читаются и не пишутся,
+   место занимают только блоки, которые сервер перепишет потом. Регион
+   в сотни МБ клонируется за миллисекунды, поэтому окно save-off почти
+   не зависит от размера мира. На Linux то же делает ioctl(FICLONE)
+   (XFS, btrfs).
+
+   Если том не умеет (NTFS, хранилище на другом томе) или клон файла не
+   удался — параллельное копирование (CopyFileW / copy_file_range).
+
+   Хранилище инстанса (<dir>/<id>/):
+     clones/<имя>/          — дерево мира как есть
+     clones/<имя>.json      — манифест: путь, размер, mtime, способ
+   Недописанный снимок лежит в clones/<имя>.part/ и удаляется при
+   следующем запуске.                                                   */
+class CloneBackup {
+public:
+    /* root — <dir>/<id> */
+    CloneBackup(std::filesystem::path root, BackupOptions opt);
+
+    /* Снимок world_dir. Бросает std::runtime_error */
+    BackupStats snapshot(const std::filesystem::path& world_dir);
+
+    std::vector<std::string> snapshots() const;
+
+    /* Файл снимка name → dst (клоном, если можно). Сверяется размер:
+       контрольных сумм у клонов нет — их посчитать значило бы читать мир */
+    void restore_file(const std::string& name, const nlohmann::json& entry,
+                      const std::filesystem::path& dst, RestoreStats& st) const;
+
+    /* Один том и файловая система с клонированием блоков */
+    static bool clone_supported(const std::filesystem::path& src_dir, const std::filesystem::path& dst_dir);
+
+private:
+    /* false — не вышло, dst удалён, надо копировать */
+    static bool clone_file(const std::filesystem::path& src, const std::filesystem::path& dst, uint64_t size);
+    static void copy_file(const std::filesystem::path& src, const std::filesystem::path& dst);   // бросает
+
+    void enforce_retention();
+
+    std::filesystem::path root_;
+    BackupOptions opt_;
+};
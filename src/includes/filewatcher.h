@@ -0,0 +1,81 @@
+#pragma once
+
+#include <windows.h>
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* ===== Слежение за файлами конфигурации =====
+   Один поток на все подписки: ReadDirectoryChangesW по каталогам
+   файлов. Редакторы пишут по-разному (truncate+write, запись во
+   временный файл и rename поверх) — события копятся, и колбэк
+   вызывается один раз, когда файл debounce_ms не менялся.          */
+class FileWatcher {
+public:
+    using ChangeFn = std::function<void()>;
+
+    static FileWatcher& instance() {
+        static FileWatcher watcher;
+        return watcher;
+    }
+
+    /* Колбэк вызывается в потоке наблюдателя — долгую работу не делать */
+    int  watch(const std::string& file, ChangeFn on_change, int debounce_ms = 500);
+
+    /* После возврата колбэк этой подписки больше не вызывается */
+    void unwatch(int id);
+
+    void shutdown();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    FileWatcher() = default;
+    ~FileWatcher() { shutdown(); }
+
+    FileWatcher(const FileWatcher&)            = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    struct Watch {
+        int          id;
+        std::wstring name;          // имя файла без каталога
+        std::filesystem::path path;
+        ChangeFn     on_change;
+        int          debounce_ms;
+        bool         pending = false;
+        Clock::time_point due{};
+        std::filesystem::file_time_type mtime{};   // что видели при прошлом вызове
+        uintmax_t    size = 0;
+    };
+
+    struct Dir {
+        std::wstring path;
+        HANDLE       handle = INVALID_HANDLE_VALUE;
+        HANDLE       event  = nullptr;
+        OVERLAPPED   ov{};
+        bool         armed  = false;
+        std::vector<std::shared_ptr<Watch>> watches;
+        alignas(DWORD) char buf[16 * 1024];
+    };
+
+    void loop();
+    bool arm(Dir& d);
+    void close_dir(Dir& d);
+    void collect(Dir& d, DWORD bytes);   // разбор FILE_NOTIFY_INFORMATION
+    void fire_due();
+
+    std::mutex mx_;                      // dirs_, stop_
+    std::vector<std::unique_ptr<Dir>> dirs_;
+    bool   stop_{false};
+    int    next_id_{1};
+    HANDLE wake_{nullptr};
+
+    std::mutex dispatch_mx_;             // держится, пока идут колбэки
+    std::thread thread_;
+};
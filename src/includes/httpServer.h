@@ -1,45 +1,103 @@
 #pragma once
 
-#include "minecraftservermanager.h"
+#include "serverregistry.h"
 #include "httplib.h"
 #include "json.hpp"
+#include "sha256.h"
+#include "sessiontoken.h"
+#include "workerpool.h"
 #include <iostream>
 #include <atomic>
+#include <memory>
+#include <vector>
 
 class HttpServer {
 public:
-    HttpServer(MinecraftServerManager& manager, 
+    HttpServer(ServerRegistry& servers, 
               int port, 
               std::atomic<bool>& running, 
               const std::string& tokens_file,
               const std::string& logs_path,
               const std::string& modpack_path,
               const std::string& web_root,
-              int upload_limit);
+              int upload_limit,
+              const std::string& session_secret = "",
+              int session_ttl_s = 3600,
+              bool allow_raw_token = true);
 
     HttpServer(const HttpServer&) = delete;
     HttpServer& operator=(const HttpServer&) = delete;
     HttpServer(HttpServer&&) = delete;
     HttpServer& operator=(HttpServer&&) = delete;
+    ~HttpServer();
 
     void run();
     void stop();
     void load_tokens();
+    void set_tokens_file(const std::string& tokens_file);   // из перечитанного config.json
+
+    /* Необязательные блоки config.json "web" (pool, http, ...). До run(). */
+    void configure(const nlohmann::json& web);
 private:
     std::atomic<bool>& running_;
-    MinecraftServerManager& manager_;
+    ServerRegistry& servers_;
+    MinecraftServerManager& manager_;   // основной инстанс для старых /api/* маршрутов
     int port_;
     httplib::Server svr;
     nlohmann::json get_status_json();
+    nlohmann::json get_status_json(const MinecraftServerManager& mc);
+    void register_instance_routes();
     int upload_limit_;
 
-    std::unordered_set<std::string> tokens_;
+    /* Токены — неизменяемый снимок (RCU): читатели берут shared_ptr
+       через atomic_load без блокировок, load_tokens() собирает новый
+       набор в стороне и подменяет его atomic_store. Хранятся только
+       SHA-256 токенов. */
+    struct TokenEntry {
+        Sha256::Digest hash;
+        Scope          scope;
+    };
+    using TokenSet = std::vector<TokenEntry>;
+    std::shared_ptr<const TokenSet> tokens_ = std::make_shared<const TokenSet>();
     std::string        tokens_file_;
-    std::mutex         tokens_mx_;
+    std::mutex         reload_mx_;   // только между перезагрузками, не для чтения
+    int                tokens_watch_ = 0;   // подписка FileWatcher на tokens_file_
 
     std::string logs_path_;
     std::string modpack_path_;
     std::string web_root_;
 
-    bool check_token(const std::string&);
+    SessionTokens sessions_;             // короткие подписанные токены из /api/login
+    bool          allow_raw_token_;      // принимать долгий токен в каждом запросе
+
+    /* web.http: соединения между Caddy/панелью и mshost */
+    struct HttpTuning {
+        size_t keep_alive_max_count = 100;   // запросов на одно соединение
+        int    keep_alive_timeout_s = 5;     // простой keep-alive держит поток пула!
+        int    read_timeout_s       = 5;
+        int    write_timeout_s      = 5;
+        int    idle_interval_ms     = 0;     // 0 — без on_idle
+        size_t payload_max_kb       = 1024;  // тело запроса
+        bool   tcp_nodelay          = true;
+        bool   reuse_port           = false; // Windows: false — SO_EXCLUSIVEADDRUSE
+    } http_opt_;
+    void apply_http_tuning();
+
+    /* web.unix_socket: слушать AF_UNIX вместо TCP-порта */
+    struct UnixSocket {
+        std::string path;                 // пусто — обычный TCP
+        std::string sddl = "D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GA;;;OW)";   // Windows
+        int         mode = 0660;          // POSIX
+    } unix_opt_;
+    bool listen_unix();
+#ifdef _WIN32
+    void prepare_socket_dir();
+#endif
+    void restrict_socket_file();
+
+    WorkerPool::Options pool_opt_;
+    WorkerPool*         pool_ = nullptr;   // владеет httplib, живёт до конца listen()
+
+    Scope check_token(const std::string&);
+    Scope authorize(const httplib::Request& req);
 };
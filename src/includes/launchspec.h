@@ -0,0 +1,62 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+/* ===== Командная строка JVM =====
+   Собирает argv как вектор: java, jvm_args, @user_jvm_args, CDS-флаги,
+   @forge_args, nogui. @argfile-ы раскрываются один раз и кешируются до
+   изменения файла; classpath/module-path проверяются при раскрытии.
+   В CreateProcess уходит строка, экранированная по правилам
+   CommandLineToArgvW, — без повторного разбора и ручных кавычек.     */
+class LaunchSpec {
+public:
+    struct Options {
+        std::string java_path;
+        std::string server_dir;
+        std::vector<std::string> jvm_args;   // java.jvm_args
+        std::string user_jvm_args;           // server.user_jvm_args, обычно "@user_jvm_args.txt"
+        std::string forge_args;              // server.forge_args, обычно "@libraries/.../win_args.txt"
+
+        /* Class Data Sharing: первый запуск пишет архив, следующие его читают */
+        bool        cds_enabled = false;
+        std::string cds_archive = "mshost-cds.jsa";   // относительно server_dir
+    };
+
+    LaunchSpec() = default;
+    explicit LaunchSpec(Options opt) : opt_(std::move(opt)) {}
+
+    static Options options_from_json(const nlohmann::json& java, const nlohmann::json& server);
+
+    /* argv очередного запуска одной строкой для CreateProcess
+       (argfile-ы перечитываются, только если изменились) */
+    std::string command_line();
+
+    static std::string quote_arg(const std::string& arg);
+
+    /* Разбор содержимого @argfile по правилам java launcher */
+    static std::vector<std::string> parse_argfile(const std::string& text);
+
+private:
+    struct ArgFile {
+        std::filesystem::file_time_type mtime{};
+        uintmax_t                       size = 0;
+        std::vector<std::string>        args;
+    };
+
+    /* argv без CDS-флагов; main_at — где начинается main class.
+       expand_forge = false — forge_args остаются как есть (@argfile) */
+    std::vector<std::string> build(bool expand_forge, size_t& main_at);   // под mx_
+    void append_expanded(std::vector<std::string>& out, const std::string& arg);
+    const std::vector<std::string>* expand_argfile(const std::string& rel);
+    void validate_paths(const std::string& file, const std::vector<std::string>& args) const;
+    std::vector<std::string> cds_flags(const std::vector<std::string>& base) const;
+
+    Options opt_;
+    std::mutex mx_;
+    std::map<std::string, ArgFile> cache_;   // путь → раскрытые аргументы
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* ===== Кольцевой буфер последних строк консоли =====
+   /api/servers/<id>/logs отдаёт хвост отсюда, не перечитывая лог-файл. */
+class LineRing {
+public:
+    explicit LineRing(size_t capacity = 500) : lines_(capacity) {}
+
+    void push(std::string line) {
+        std::lock_guard lg(mx_);
+        lines_[head_] = std::move(line);
+        head_ = (head_ + 1) % lines_.size();
+        if (size_ < lines_.size()) ++size_;
+    }
+
+    // Последние n строк (по умолчанию — все), от старых к новым
+    std::vector<std::string> tail(size_t n = static_cast<size_t>(-1)) const {
+        std::lock_guard lg(mx_);
+        n = (std::min)(n, size_);
+        std::vector<std::string> out;
+        out.reserve(n);
+        size_t idx = (head_ + lines_.size() - n) % lines_.size();
+        for (size_t i = 0; i < n; ++i) {
+            out.push_back(lines_[idx]);
+            idx = (idx + 1) % lines_.size();
+        }
+        return out;
+    }
+
+    void clear() {
+        std::lock_guard lg(mx_);
+        head_ = size_ = 0;
+    }
+
+private:
+    mutable std::mutex mx_;
+    std::vector<std::string> lines_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
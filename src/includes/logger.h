@@ -8,16 +8,34 @@
 #include <chrono>
 #include <iomanip>
 #include <atomic>
+#include <thread>
 #include <sstream>
 #include <regex>
 #include <codecvt>
 #include <filesystem>
+#include <memory>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
 #include <windows.h>
+#include "binlog.h"
+#include "logrotate.h"
 
 namespace fs = std::filesystem;
 
 enum class LogLevel { DEBUG, INFO, WARNING, ERR, CRITICAL };
 
+// Нижний уровень, который вообще попадает в бинарник (0 — DEBUG … 4 — CRIT).
+// В релизной сборке DEBUG вырезается; переопределяется -DMSHOST_LOG_MIN_LEVEL=N
+#ifndef MSHOST_LOG_MIN_LEVEL
+#  ifdef NDEBUG
+#    define MSHOST_LOG_MIN_LEVEL 1
+#  else
+#    define MSHOST_LOG_MIN_LEVEL 0
+#  endif
+#endif
+
 class Logger {
 public:
     static Logger& instance() {
@@ -43,32 +61,127 @@ public:
             sessionDirName_ = oss.str();
         }
 
-        auto open_utf8 = [](const std::string& path, std::ofstream& f) {
-            if (path.empty()) return false;
-            f.open(path, std::ios::out | std::ios::app);
-    #ifdef _WIN32
-            if (f.is_open()) {
-                f.imbue(std::locale(std::locale(), new std::codecvt_utf8<char16_t>));
-            }
-    #endif
-            return f.is_open();
+        logSink_.name = filename;
+        webSink_.name = webFilename;
+        fileOutput_ = openSink(logSink_);
+        webOutput_  = openSink(webSink_);
+        consoleOutput_ = consoleOutput;
+    }
+
+    void setMinLevel(LogLevel level) {
+        minLevel_ = static_cast<int>(level);
+        updateFloor();
+    }
+
+    // ────────────────────────────────────────────────────────────────────
+    //  configure — уровни из config.json "logging":
+    //    "log_level": "INFO", "modules": { "RCON": "DEBUG", "WEB": "WARN" }
+    //  Модуль сравнивается целиком, затем часть до ':' (MC_OUT:<id> → MC_OUT).
+    //  Можно звать повторно при перечитывании конфига
+    // ────────────────────────────────────────────────────────────────────
+    void configure(const nlohmann::json& logging) {
+        if (!logging.is_object()) return;
+
+        auto parse = [](const nlohmann::json& v, const std::string& where) {
+            const int lvl = v.is_string() ? binlog::parse_level(v.get<std::string>()) : -1;
+            if (lvl < 0) throw std::invalid_argument(where + ": неизвестный уровень " + v.dump());
+            return lvl;
         };
 
-        fileOutput_ = open_utf8(filename, logFile_);
-        webOutput_  = open_utf8(webFilename, webFile_);
-        consoleOutput_ = consoleOutput;
+        // Сначала всё разобрать, потом применить — без половинчатых настроек
+        int global = minLevel_;
+        if (logging.contains("log_level")) global = parse(logging["log_level"], "logging.log_level");
+
+        auto levels = std::make_shared<ModuleLevels>();
+        if (logging.contains("modules") && logging["modules"].is_object()) {
+            for (const auto& [module, lvl] : logging["modules"].items()) {
+                levels->emplace_back(module, parse(lvl, "logging.modules." + module));
+            }
+        }
+
+        minLevel_ = global;
+        hasOverrides_ = !levels->empty();
+        std::atomic_store(&overrides_, std::shared_ptr<const ModuleLevels>(std::move(levels)));
+        if (updateFloor() < MSHOST_LOG_MIN_LEVEL) {
+            log(LogLevel::WARNING, "Запрошен уровень ниже собранного: записи ниже " +
+                std::string(binlog::level_name(MSHOST_LOG_MIN_LEVEL)) +
+                " вырезаны при компиляции (MSHOST_LOG_MIN_LEVEL)", "LOGGER");
+        }
+    }
+
+    // ────────────────────────────────────────────────────────────────────
+    //  enabled — пройдёт ли запись по уровню. Макросы LOG_* спрашивают
+    //  до того, как собирать строку сообщения
+    // ────────────────────────────────────────────────────────────────────
+    bool enabled(LogLevel level, std::string_view module) const {
+        const int lvl = static_cast<int>(level);
+        if (lvl < floor_.load(std::memory_order_relaxed)) return false;
+        if (!hasOverrides_.load(std::memory_order_relaxed)) {
+            return lvl >= minLevel_.load(std::memory_order_relaxed);
+        }
+        const auto levels = std::atomic_load(&overrides_);
+        const std::string_view base = module.substr(0, module.find(':'));
+        int partial = -1;
+        for (const auto& [name, threshold] : *levels) {
+            if (name == module) return lvl >= threshold;
+            if (name == base)   partial = threshold;
+        }
+        return lvl >= (partial >= 0 ? partial : minLevel_.load(std::memory_order_relaxed));
+    }
+
+    // ────────────────────────────────────────────────────────────────────
+    //  setRotation — резать server.log/web.log по размеру/времени,
+    //  закрытые сегменты сжимает и чистит фоновый LogRotator
+    // ────────────────────────────────────────────────────────────────────
+    void setRotation(const LogRotation& policy) {
+        fs::path session;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            rotation_ = policy;
+            session   = sessionDir();
+        }
+        // Вне mutex_: поток ротатора сам пишет в лог
+        rotator_.start(logsRoot(), session, policy);
+    }
+
+    // ────────────────────────────────────────────────────────────────────
+    //  setArchiveHook — сообщать о закрытых сегментах (индекс поиска).
+    //  Зовётся под mutex_: только поставить в очередь
+    // ────────────────────────────────────────────────────────────────────
+    void setArchiveHook(std::function<void(const fs::path&)> hook) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        archiveHook_ = std::move(hook);
     }
 
-    void setMinLevel(LogLevel level) { minLevel_ = level; }
+    // ────────────────────────────────────────────────────────────────────
+    //  enableStructured — параллельно писать двоичные сегменты .mslog
+    // ────────────────────────────────────────────────────────────────────
+    void enableStructured(const std::string& dir, uint64_t segmentBytes, uint32_t indexEvery,
+                          size_t keepSegments = 0, int maxAgeDays = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        binlog_ = std::make_unique<binlog::Writer>(dir, segmentBytes, indexEvery, keepSegments, maxAgeDays);
+        structuredDir_ = dir;
+    }
+
+    std::string structuredDir() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return structuredDir_;
+    }
+
+    /* Сбросить буфер .mslog — запрос к живому сегменту видит всё записанное */
+    void flushStructured() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (binlog_) binlog_->flush();
+    }
 
     // ────────────────────────────────────────────────────────────────────
     //  log — вывод строки
     // ────────────────────────────────────────────────────────────────────
     void log(LogLevel level, const std::string& message, const std::string& module = "") {
-        if (level < minLevel_) return;
+        if (!enabled(level, module)) return;
 
         std::string cleaned = message;
-        if (module == "MC_OUT") {
+        if (module.rfind("MC_OUT", 0) == 0) {   // MC_OUT и MC_OUT:<id>
             static const std::regex ts_re(R"(^\[\d{2}:\d{2}:\d{2}\]\s*)");
             cleaned = std::regex_replace(message, ts_re, "");
         }
@@ -91,6 +204,16 @@ public:
         std::string out = oss.str();
 
         std::lock_guard<std::mutex> guard(mutex_);
+        if (binlog_) {
+            const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                now.time_since_epoch()).count();
+    #ifdef _WIN32
+            const uint32_t tid = GetCurrentThreadId();
+    #else
+            const uint32_t tid = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    #endif
+            binlog_->append(us, static_cast<uint8_t>(level), tid, module, cleaned);
+        }
         if (consoleOutput_) {
     #ifdef _WIN32
             DWORD written;
@@ -101,47 +224,39 @@ public:
     #endif
         }
         bool isWeb = (module == "WEB" || module == "HTTP" || module == "API");
-        if (fileOutput_ && !isWeb)            logFile_ << out << std::endl; // server.log ← без веба
-        if (webOutput_ && isWeb)              webFile_ << out << std::endl; // web.log   ← только веб
+        if (fileOutput_ && !isWeb) writeSink(logSink_, out);   // server.log ← без веба
+        if (webOutput_ && isWeb)   writeSink(webSink_, out);   // web.log   ← только веб
     }
 
     // ────────────────────────────────────────────────────────────────────
-    //  finalize — вызывается в деструкторе: архивирует логи
+    //  finalize — вызывается в деструкторе: переносит логи в архив сессии.
+    //  Только rename + жёсткая ссылка latest_*: без копирования файлов
     // ────────────────────────────────────────────────────────────────────
     void finalize() {
+        rotator_.stop();   // не ждёт сжатия: недожатое доделает следующий запуск
+
         std::lock_guard<std::mutex> lock(mutex_);
         try {
             if (archived_) return; // защита от двойного вызова
             archived_ = true;
 
-            // Закрываем стримы, чтобы всё сбросить на диск
-            if (logFile_.is_open()) logFile_.close();
-            if (webFile_.is_open()) webFile_.close();
-
-            fs::path logsRoot = "../logs";
-            if (!fs::exists(logsRoot)) fs::create_directory(logsRoot);
+            if (binlog_) binlog_->close();
 
-            fs::path sessionDir = logsRoot / sessionDirName_;
-            if (!fs::exists(sessionDir)) fs::create_directory(sessionDir);
-
-            auto safe_copy_and_overwrite = [&](const char* src, const char* latest){
-                fs::path srcPath{src};
-                if(!fs::exists(srcPath)) return;
+            auto seal = [&](Sink& sink, const char* latest) {
+                if (sink.file.is_open()) sink.file.close();
+                fs::path dst = moveToSession(sink);
+                if (dst.empty()) return;
 
                 // удалить старый latest_*, если он есть (требование пользователя)
-                fs::path latestPath = logsRoot / latest;
+                fs::path latestPath = logsRoot() / latest;
                 std::error_code ec;
                 fs::remove(latestPath, ec);
-
-                // копируем в сессию и как latest
-                fs::copy_file(srcPath, sessionDir / srcPath.filename(), fs::copy_options::overwrite_existing, ec);
-                fs::copy_file(srcPath, latestPath,                       fs::copy_options::overwrite_existing, ec);
-
-                fs::remove(srcPath, ec); // удаляем из корня
+                fs::create_hard_link(dst, latestPath, ec);
+                if (ec) fs::copy_file(dst, latestPath, fs::copy_options::overwrite_existing, ec);
             };
 
-            if (fileOutput_) safe_copy_and_overwrite("server.log", "latest_server.log");
-            if (webOutput_ ) safe_copy_and_overwrite("web.log",    "latest_web.log");
+            if (fileOutput_) seal(logSink_, "latest_server.log");
+            if (webOutput_ ) seal(webSink_, "latest_web.log");
         } catch (const std::exception& e) {
             // Если архивирование сломалось — просто вывесим это в консоль
             std::cerr << "[LOGGER] finalize error: " << e.what() << std::endl;
@@ -152,29 +267,131 @@ public:
 
 private:
     Logger() : consoleOutput_(true), fileOutput_(false), webOutput_(false),
-               minLevel_(LogLevel::INFO), archived_(false) {}
+               archived_(false) {}
 
     Logger(const Logger&)            = delete;
     Logger& operator=(const Logger&) = delete;
 
-    std::ofstream logFile_;   // server.log
-    std::ofstream webFile_;   // web.log
+    // Текущий файл лога и его сегментация
+    struct Sink {
+        std::string   name;         // server.log / web.log в рабочем каталоге
+        std::ofstream file;
+        uint64_t      bytes = 0;
+        std::chrono::steady_clock::time_point opened;
+        unsigned      seq = 0;      // сколько сегментов уже ушло в архив
+    };
+
+    static fs::path logsRoot() { return "../logs"; }
+    fs::path sessionDir() const { return logsRoot() / sessionDirName_; }
+
+    static bool openSink(Sink& sink) {
+        if (sink.name.empty()) return false;
+        sink.file.open(sink.name, std::ios::out | std::ios::app);
+    #ifdef _WIN32
+        if (sink.file.is_open()) {
+            sink.file.imbue(std::locale(std::locale(), new std::codecvt_utf8<char16_t>));
+        }
+    #endif
+        std::error_code ec;
+        const auto size = fs::file_size(sink.name, ec);
+        sink.bytes  = ec ? 0 : size;
+        sink.opened = std::chrono::steady_clock::now();
+        return sink.file.is_open();
+    }
+
+    void writeSink(Sink& sink, const std::string& line) {
+        sink.file << line << std::endl;
+        sink.bytes += line.size() + 1;
+
+        if (!rotation_.rotates()) return;
+        const bool bySize = rotation_.max_bytes && sink.bytes >= rotation_.max_bytes;
+        const bool byTime = rotation_.interval_h &&
+            std::chrono::steady_clock::now() - sink.opened >= std::chrono::hours(rotation_.interval_h);
+        if (!bySize && !byTime) return;
+
+        sink.file.close();
+        fs::path dst = moveToSession(sink);
+        openSink(sink);
+        if (dst.empty()) return;
+        rotator_.submit(dst);
+        if (archiveHook_) archiveHook_(dst);
+    }
+
+    /* server.log → ../logs/<сессия>/server.log, после ротаций — server.NNN.log.
+       Обычно это rename в пределах тома; на другой том — копия. */
+    fs::path moveToSession(Sink& sink) {
+        fs::path src{sink.name};
+        std::error_code ec;
+        if (!fs::exists(src, ec)) return {};
+
+        fs::create_directories(sessionDir(), ec);
+        fs::path dst = sessionDir() / src.filename();
+        if (rotation_.rotates() || sink.seq > 0) {
+            std::ostringstream n;
+            n << src.stem().string() << '.' << std::setw(3) << std::setfill('0') << ++sink.seq
+              << src.extension().string();
+            dst = sessionDir() / n.str();
+        }
+
+        fs::rename(src, dst, ec);
+        if (ec) {
+            ec.clear();
+            fs::copy_file(src, dst, fs::copy_options::overwrite_existing, ec);
+            if (ec) return {};
+            fs::remove(src, ec);
+        }
+        return dst;
+    }
+
+    Sink logSink_;
+    Sink webSink_;
 
     std::mutex mutex_;
     bool consoleOutput_;
     bool fileOutput_;
     bool webOutput_;
     bool archived_;
-    LogLevel minLevel_;
+
+    // Уровни: floor_ — самый низкий из общего и модульных, отсекает
+    // большинство вызовов одной атомарной загрузкой
+    using ModuleLevels = std::vector<std::pair<std::string, int>>;
+    std::atomic<int>  minLevel_{ static_cast<int>(LogLevel::INFO) };
+    std::atomic<int>  floor_{ static_cast<int>(LogLevel::INFO) };
+    std::atomic<bool> hasOverrides_{ false };
+    std::shared_ptr<const ModuleLevels> overrides_ = std::make_shared<ModuleLevels>();
+
+    int updateFloor() {   // возвращает запрошенный минимум, до порога сборки
+        int f = minLevel_;
+        for (const auto& [name, lvl] : *std::atomic_load(&overrides_)) f = (std::min)(f, lvl);
+        floor_ = (std::max)(f, MSHOST_LOG_MIN_LEVEL);
+        return f;
+    }
 
     std::string sessionDirName_; // YYYY‑MM‑DD_HH‑MM‑SS
+
+    std::unique_ptr<binlog::Writer> binlog_;   // .mslog, если включён logging.structured
+    std::string structuredDir_;
+
+    LogRotation rotation_;   // logging.rotation
+    LogRotator  rotator_;
+    std::function<void(const fs::path&)> archiveHook_;
 };
 
 // ── Макросы ─────────────────────────────────────────────────────────────
-#define LOG_DEBUG(msg, module)    Logger::instance().log(LogLevel::DEBUG,    msg, module)
-#define LOG_INFO(msg, module)     Logger::instance().log(LogLevel::INFO,     msg, module)
-#define LOG_WARNING(msg, module)  Logger::instance().log(LogLevel::WARNING,  msg, module)
-#define LOG_ERR(msg, module)      Logger::instance().log(LogLevel::ERR,      msg, module)
-#define LOG_CRITICAL(msg, module) Logger::instance().log(LogLevel::CRITICAL, msg, module)
+// Сообщение собирается, только если уровень проходит. Уровни ниже
+// MSHOST_LOG_MIN_LEVEL отсекаются константой — компилятор выкидывает
+// вызов вместе с аргументами
+#define LOG_AT(level, msg, module)                                              \
+    do {                                                                        \
+        if (static_cast<int>(level) >= MSHOST_LOG_MIN_LEVEL &&                  \
+            Logger::instance().enabled(level, module))                          \
+            Logger::instance().log(level, msg, module);                         \
+    } while (0)
+
+#define LOG_DEBUG(msg, module)    LOG_AT(LogLevel::DEBUG,    msg, module)
+#define LOG_INFO(msg, module)     LOG_AT(LogLevel::INFO,     msg, module)
+#define LOG_WARNING(msg, module)  LOG_AT(LogLevel::WARNING,  msg, module)
+#define LOG_ERR(msg, module)      LOG_AT(LogLevel::ERR,      msg, module)
+#define LOG_CRITICAL(msg, module) LOG_AT(LogLevel::CRITICAL, msg, module)
 
 #endif // LOGGER_H
\ No newline at end of file
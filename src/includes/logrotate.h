@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* ===== Ротация логов: политика из config.json "logging.rotation" =====
+     "max_mb": 64          — новый сегмент по размеру (0 — не резать)
+     "interval_h": 24      — и/или по времени
+     "compress": true      — закрытые сегменты → .gz (если собрано с zlib)
+     "keep_segments": 200  — сколько сегментов хранить во всех сессиях
+     "max_age_days": 30    — и не старше                               */
+struct LogRotation {
+    uint64_t max_bytes     = 0;
+    int      interval_h    = 0;
+    bool     compress      = true;
+    size_t   keep_segments = 0;   // 0 — без ограничения
+    int      max_age_days  = 0;   // 0 — без ограничения
+
+    bool rotates() const { return max_bytes > 0 || interval_h > 0; }
+};
+
+/* Фоновая работа над закрытыми сегментами: сжатие и чистка по
+   сроку/количеству. Поток с фоновым приоритетом (и IO-приоритетом),
+   на остановке не ждёт — недожатые сегменты дожмутся при следующем
+   запуске. Логгер его не вызывает под своим мьютексом ничего, кроме
+   submit(), а сам он пишет в лог только вне своего мьютекса.        */
+class LogRotator {
+public:
+    LogRotator() = default;
+    ~LogRotator() { stop(); }
+
+    /* logs_root — ../logs; current_session — каталог, который не трогать */
+    void start(const std::filesystem::path& logs_root,
+               const std::filesystem::path& current_session,
+               const LogRotation& policy);
+    void submit(const std::filesystem::path& segment);
+    void stop();
+
+    static bool compression_available();
+
+private:
+    void loop();
+    bool compress(const std::filesystem::path& src);   // false — прервано или ошибка
+    void sweep_uncompressed();
+    void enforce_retention();
+
+    std::filesystem::path root_, current_;
+    LogRotation policy_;
+
+    std::mutex mx_;
+    std::condition_variable cv_;
+    std::deque<std::filesystem::path> queue_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "json.hpp"
+
+/* ===== Полнотекстовый поиск по архиву логов (/api/logs/search) =====
+   Индекс — инвертированный по словам: слово (ASCII в нижнем регистре,
+   байты UTF-8 как есть) → номера строк, дельты в varint. Для строки
+   хранится только смещение в сегменте и время — сам текст читается из
+   файла при проверке кандидата (несколько сегментов в LRU-кэше).
+
+   Индексируются закрытые сегменты server*.log[.gz] в ../logs/<сессия>/:
+   при старте — весь архив в фоне, дальше — по хуку ротации Logger.
+   Сегменты, удалённые чисткой архива, выбрасываются из индекса
+   (номера строк сжимаются, файлы заново не читаются).
+   Текущий server.log не индексируется и просматривается с конца окнами
+   по kLiveWindow байт: без ротации он растёт без предела, а запрос
+   читает не больше окна и возвращает курсор на остаток.               */
+class LogSearch {
+public:
+    static LogSearch& instance() {
+        static LogSearch search;
+        return search;
+    }
+
+    void start(const std::filesystem::path& logs_root,
+               const std::filesystem::path& live_file,
+               size_t cache_segments);
+    void shutdown();
+    bool enabled() const { return started_; }
+
+    /* Сегмент закрыт (вызывается под мьютексом Logger — только очередь) */
+    void submit(const std::filesystem::path& segment);
+
+    /* q: слова и "фразы", все обязательны; from/to в мкс; cursor — из
+       поля next прошлой страницы. Кидает std::invalid_argument.       */
+    nlohmann::json search(const std::string& q, int64_t from_us, int64_t to_us,
+                          size_t limit, const std::string& cursor);
+
+private:
+    LogSearch() = default;
+    ~LogSearch() { shutdown(); }
+
+    LogSearch(const LogSearch&)            = delete;
+    LogSearch& operator=(const LogSearch&) = delete;
+
+    struct Postings {
+        std::vector<uint8_t> data;   // varint-дельты номеров строк
+        uint32_t last  = 0;
+        uint32_t count = 0;
+
+        void add(uint32_t line);
+        void decode(std::vector<uint32_t>& out) const;
+    };
+
+    struct Segment {
+        std::filesystem::path path;   // без .gz: сжатие переименовывает файл позже
+        std::string session;
+        uint32_t    first_line = 0;
+        uint32_t    lines      = 0;
+    };
+
+    void loop();
+    void index_segment(const std::filesystem::path& path);
+    void drop_missing();   // выбросить удалённые сегменты (поток индексатора)
+    std::shared_ptr<const std::string> load(uint32_t seg);
+
+    std::filesystem::path root_, live_;
+    size_t cache_limit_ = 4;
+    std::atomic<bool> started_{false};
+
+    // Очередь индексатора
+    std::mutex q_mx_;
+    std::condition_variable q_cv_;
+    std::deque<std::filesystem::path> queue_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> indexing_{false};
+    std::thread thread_;
+
+    // Индекс: пишет только индексатор, читают запросы
+    mutable std::shared_mutex mx_;
+    std::unordered_map<std::string, Postings> postings_;
+    std::vector<Segment>  segments_;
+    std::vector<uint32_t> line_off_;   // смещение строки в сегменте
+    std::vector<int64_t>  line_ts_;    // unix-секунды, 0 — неизвестно
+    std::unordered_set<std::string> indexed_;
+
+    // Кэш прочитанных сегментов; ключ — путь: номера сдвигает drop_missing
+    std::mutex cache_mx_;
+    std::list<std::pair<std::string, std::shared_ptr<const std::string>>> cache_;
+};
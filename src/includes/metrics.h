@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "json.hpp"
+
+/* ===== Гистограмма длительностей =====
+   Корзины по степеням двойки в микросекундах: запись — два атомарных
+   инкремента, без блокировок. Перцентили — верхняя граница корзины.  */
+class Histogram {
+public:
+    static constexpr size_t kBuckets = 32;   // до 2^31 мкс ≈ 36 минут
+
+    void record(uint64_t us) {
+        size_t b = 0;
+        while (b + 1 < kBuckets && (uint64_t(1) << b) < us) ++b;
+        buckets_[b].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    uint64_t percentile(double p) const {
+        const uint64_t total = count_.load(std::memory_order_relaxed);
+        if (!total) return 0;
+        const uint64_t rank = static_cast<uint64_t>(p * total + 0.5);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            seen += buckets_[b].load(std::memory_order_relaxed);
+            if (seen >= rank) return uint64_t(1) << b;
+        }
+        return uint64_t(1) << (kBuckets - 1);
+    }
+
+    nlohmann::json to_json() const {
+        const uint64_t total = count_.load(std::memory_order_relaxed);
+        return {
+            {"count",   total},
+            {"mean_us", total ? sum_.load(std::memory_order_relaxed) / total : 0},
+            {"p50_us",  percentile(0.50)},
+            {"p90_us",  percentile(0.90)},
+            {"p99_us",  percentile(0.99)}
+        };
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets]{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+};
+
+/* ===== Общий реестр метрик =====
+   Счётчики, шкалы и гистограммы создаются при первом обращении и живут до конца процесса,
+   поэтому ссылку можно закешировать (static auto& c = ...counter("x")). */
+class Metrics {
+public:
+    static Metrics& instance() {
+        static Metrics inst;
+        return inst;
+    }
+
+    std::atomic<uint64_t>& counter(const std::string& name) {
+        std::lock_guard lg(mx_);
+        auto& slot = counters_[name];
+        if (!slot) slot = std::make_unique<std::atomic<uint64_t>>(0);
+        return *slot;
+    }
+
+    std::atomic<int64_t>& gauge(const std::string& name) {
+        std::lock_guard lg(mx_);
+        auto& slot = gauges_[name];
+        if (!slot) slot = std::make_unique<std::atomic<int64_t>>(0);
+        return *slot;
+    }
+
+    Histogram& histogram(const std::string& name) {
+        std::lock_guard lg(mx_);
+        auto& slot = histograms_[name];
+        if (!slot) slot = std::make_unique<Histogram>();
+        return *slot;
+    }
+
+    nlohmann::json to_json() const {
+        std::lock_guard lg(mx_);
+        nlohmann::json out = { {"counters",   nlohmann::json::object()},
+                               {"gauges",     nlohmann::json::object()},
+                               {"histograms", nlohmann::json::object()} };
+        for (const auto& [name, c] : counters_)   out["counters"][name]   = c->load();
+        for (const auto& [name, g] : gauges_)     out["gauges"][name]     = g->load();
+        for (const auto& [name, h] : histograms_) out["histograms"][name] = h->to_json();
+        return out;
+    }
+
+private:
+    Metrics() = default;
+    Metrics(const Metrics&)            = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    mutable std::mutex mx_;
+    std::map<std::string, std::unique_ptr<std::atomic<uint64_t>>> counters_;
+    std::map<std::string, std::unique_ptr<std::atomic<int64_t>>>  gauges_;
+    std::map<std::string, std::unique_ptr<Histogram>>              histograms_;
+};
@@ -12,9 +12,19 @@
 #include <string>
 #include <ostream>  
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <fstream>
 #include <sstream>
+#include <optional>
 #include "json.hpp"
+#include "linering.h"
+#include "launchspec.h"
+#include "processlimits.h"
+#include "backup.h"
+#include "chunkprune.h"
+#include "players.h"
 //#include "rcon_client.h"
 using json = nlohmann::json;
 
@@ -46,27 +56,85 @@ inline std::wostream& operator<<(std::wostream& os, ServerStatus s) {
 
 class MinecraftServerManager {
 public:
-    MinecraftServerManager(const json& config_data);
+    MinecraftServerManager(const json& config_data, std::string id = "main");
     ~MinecraftServerManager();
 
+    MinecraftServerManager(const MinecraftServerManager&)            = delete;
+    MinecraftServerManager& operator=(const MinecraftServerManager&) = delete;
+
     void start();
     void stop();
+    void restart();   // с тёплым резервом, если включён fast_restart
+
+    /* Новый конфиг инстанса — вступает в силу при следующем запуске */
+    void reload_config(const json& config_data);
 
     bool         is_running() const;   // true, когда сервер «готов»
     ServerStatus get_status()  const;  // Текущий статус
 
     void send_command(const std::string& command);  // Передать консольную команду
 
+    /* Снимок мира без остановки: save-off → save-all flush → снимок → save-on.
+       Бросает std::runtime_error (уже идёт, мир грузится, ошибка чтения/записи) */
+    json backup(bool full = false);
+
+    /* Снимки инстанса обоих видов, по возрастанию времени */
+    json backups() const;
+
+    /* Мир (или paths внутри него) из снимка name; только на остановленном
+       сервере. std::invalid_argument — нет снимка / путей, иначе runtime_error */
+    json restore(const std::string& name, const std::vector<std::string>& paths = {});
+
+    /* Размеры и возраст мира по заголовкам регионов (regionscan.h) */
+    json world_report(size_t top = 20) const;
+
+    /* Удаление чанков по условиям (chunkprune.h), только на остановленном сервере */
+    json prune(const PruneOptions& opt);
+
+    /* Игроки по событиям консоли (players.h): онлайн и поиск по нику/uuid */
+    json players() const { return players_.online(); }
+    json player(const std::string& key) const { return players_.find(key); }
+
+    const std::string& id() const { return id_; }
+    json display_info() const;                       // ip/port/version для панели
+    std::vector<std::string> recent_output(size_t n = 500) const { return console_.tail(n); }
+
 private:
     /* Конфиги */
     struct Config {
         std::string java_path;
-        std::vector<std::string> jvm_args_vec;  // Исходные аргументы
-        std::string jvm_args;           // Преобразованная строка аргументов
         std::string server_dir;
-        std::string forge_args;
-        std::string user_jvm_args;
-        std::string full_command;
+
+        /* Поэтапная остановка: отсчёт → save-all flush → stop → kill */
+        struct ShutdownConfig {
+            int countdown_s           = 0;      // 0 — без объявления в чате
+            int save_timeout_ms       = 30000;  // ждём "Saved the game"
+            int stop_timeout_ms       = 40000;  // ждём выхода процесса после "stop"
+            int force_kill_timeout_ms = 5000;   // ждём после TerminateProcess
+        } shutdown;
+
+        /* Быстрый перезапуск: следующая JVM грузится заранее и ждёт на шлюзе */
+        struct FastRestartConfig {
+            bool enabled               = false;
+            std::string gate_pattern   = "Launching target";  // ModLauncher, до Main и session.lock
+            int standby_timeout_ms     = 600000;  // сколько резерв может идти до шлюза
+            int lock_timeout_ms        = 10000;   // ждём освобождения session.lock
+        } fast_restart;
+
+        std::string level_name = "world";   // level-name из server.properties
+
+        LaunchPolicy launch;                 // ядра / NUMA / приоритеты / Job Object
+
+        BackupOptions backup;                // хранилище снимков мира
+
+        PlayerTrackerOptions players;        // файл индекса игроков
+
+        /* Что панель показывает игрокам */
+        struct Display {
+            std::string ip      = "91.223.70.49";
+            int         port    = 25566;
+            std::string version = "Forge 1.20.1";
+        } display;
 
         /* RCON конфигурация
         struct RCONConfig {
@@ -97,19 +165,54 @@ private:
         }
     } config_;
 
+    std::optional<LaunchSpec> launch_spec_;   // argv JVM, кеш @argfile-ов, CDS
+
     void load_config(json config_data);
+    void apply_pending_config();
+
+    mutable std::mutex  config_mx_;        // pending_config_, замена config_
+    std::optional<json> pending_config_;
 
     /* RCON методы
     void setup_rcon();
     void rcon_connection_worker();
     void check_server_ready_via_rcon();*/
 
-    /* Внутренние потоки */
-    void read_output();            // Чтение stdout сервера
-    void monitor_process_exit();   // Ожидание смерти процесса
+    /* Колбэки общего цикла ProcessHub */
+    void handle_line(const std::string& line);   // строка stdout сервера
+    void handle_exit();                          // процесс умер, пайп вычитан
+
+    /* Этапы остановки */
+    void announce_countdown();             // "say" с обратным отсчётом
+    bool flush_world();                    // save-all flush + ожидание подтверждения
+    bool wait_exit(int timeout_ms);        // ожидание выхода процесса
+    bool write_stdin(const std::string& line);
+
+    /* Процесс */
+    bool spawn_process(HANDLE& stdinPipe, HANDLE& readPipe, PROCESS_INFORMATION& pi, HANDLE& job);
+    void reset_primary();          // отписка от хаба + закрытие старых хендлов
+    bool attach_primary(std::string pending = {});  // подписка procInfo_ на хаб; false — процесс убит
+
+    /* Тёплый резерв */
+    bool launch_standby();
+    void standby_line(const std::string& line);   // вывод резерва до шлюза
+    void promote_standby();
+    void discard_standby();
+    bool wait_session_lock_released(int timeout_ms);
+    static bool suspend_process(HANDLE process);
+    static bool resume_process(HANDLE process);
 
     /* Вспомогалки */
     static std::string get_last_error_message(DWORD error_code);
+    void close_process_handles();
+
+    /* Идентификация инстанса */
+    const std::string      id_;
+    const std::string      mod_;       // "MC" / "MC:<id>"
+    const std::string      out_mod_;   // "MC_OUT" / "MC_OUT:<id>"
+    std::atomic<uint64_t>& lines_metric_;
+    LineRing               console_;   // хвост вывода для API
+    PlayerTracker          players_;   // входы/выходы игроков из вывода
 
     /* Состояние */
     std::atomic<bool>      running_{false};
@@ -117,17 +220,33 @@ private:
     std::atomic<ServerStatus> status_{ServerStatus::Stopped};
     std::atomic<bool>      rcon_enabled_{false};
     std::atomic<bool>      rcon_connecting_{false};
+    std::atomic<bool>      backup_busy_{false};   // один снимок/восстановление/прореживание за раз
+
+    /* События из вывода сервера / монитора процесса */
+    std::mutex              events_mx_;
+    std::condition_variable events_cv_;
+    bool                    save_confirmed_{false};  // под events_mx_
+    bool                    exited_{false};          // под events_mx_
+    bool                    standby_exited_{false};  // под events_mx_
 
     /* IPC-хендлы */
     HANDLE stdinPipe_ {nullptr};
     HANDLE readPipe_  {nullptr};
     PROCESS_INFORMATION procInfo_{};
+    HANDLE job_ {nullptr};   // Job Object инстанса (лимиты CPU/памяти)
 
-    /* Потоки */
-    std::thread output_thread_;
-    std::thread process_monitor_thread_;
+    /* Подписки в ProcessHub (0 — нет) */
+    int hub_id_{0};
     std::thread rcon_thread_;
 
+    /* Тёплый резерв */
+    HANDLE standbyStdin_ {nullptr};
+    HANDLE standbyRead_  {nullptr};
+    PROCESS_INFORMATION standbyInfo_{};
+    HANDLE standbyJob_ {nullptr};   // свой Job: лимит памяти не суммирует кучи двух JVM
+    int               standby_hub_id_{0};
+    std::atomic<bool> standby_gated_{false};
+
     /* RCON 
     RCONClient rcon_;*/
 };
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "json.hpp"
+
+/* ===== Игроки инстанса по событиям консоли =====
+   Из вывода сервера разбираются строки
+     "UUID of player <ник> is <uuid>"
+     "<ник>[/<ip>:<порт>] logged in with entity id ..."
+     "<ник> joined the game" / "<ник> left the game"
+   Чат ("<ник> текст") под эти шаблоны не попадает: ник — одно слово из
+   [A-Za-z0-9_.], сообщение целиком совпадает с шаблоном.
+
+   Индекс в памяти: ник (без регистра) → игрок, uuid → ник, множество
+   онлайн. Все запросы — O(1) по хеш-таблицам, кроме списка онлайн
+   (O(онлайн)). У игрока — uuid, последний ip, первое/последнее
+   появление, суммарное время, число сессий и последние history сессий.
+
+   Контрольная точка — компактный двоичный файл <dir>/<id>.dat,
+   пишется рядом и переименовывается. Запись — не чаще checkpoint_s на
+   событии, а также при остановке сервера и при выходе. Сессии, открытые
+   на момент последней точки, при загрузке закрываются её временем.
+
+   config.json, "server": { "players": { "dir": "players",
+                                          "checkpoint_s": 60, "history": 20 } } */
+struct PlayerTrackerOptions {
+    std::string dir          = "players";
+    int         checkpoint_s = 60;
+    size_t      history      = 20;   // сессий на игрока в файле и в ответе
+
+    static PlayerTrackerOptions from_json(const nlohmann::json& players);
+};
+
+class PlayerTracker {
+public:
+    struct Session {
+        int64_t join  = 0;   // unix, секунды
+        int64_t leave = 0;   // 0 — ещё в игре
+    };
+
+    struct Player {
+        std::string name, uuid, ip;
+        int64_t  first_seen = 0, last_seen = 0;
+        int64_t  online_since = 0;   // 0 — не в игре
+        uint64_t total_s  = 0;       // завершённые сессии
+        uint32_t sessions = 0;
+        std::deque<Session> recent;  // от старых к новым
+    };
+
+    PlayerTracker() = default;
+    ~PlayerTracker();
+
+    PlayerTracker(const PlayerTracker&)            = delete;
+    PlayerTracker& operator=(const PlayerTracker&) = delete;
+
+    /* Загрузить <dir>/<id>.dat; нет файла — пустой индекс */
+    void open(const PlayerTrackerOptions& opt, const std::string& id);
+
+    /* Строка stdout сервера; true — это было событие игрока */
+    bool on_line(const std::string& line, int64_t now);
+
+    /* Процесс сервера завершился: все сессии закрываются */
+    void server_stopped(int64_t now);
+
+    /* Записать файл, если есть несохранённые изменения */
+    void checkpoint();
+
+    nlohmann::json online() const;                       // {online: [...], count, known}
+    nlohmann::json find(const std::string& key) const;   // ник или uuid; null — не знаем
+
+private:
+    Player& touch(const std::string& name, int64_t now);   // под unique-блокировкой
+    void    end_session(Player& p, int64_t now);
+    void    trim(Player& p) const;
+    nlohmann::json to_json(const Player& p, int64_t now) const;
+    void    load();
+    void    save_locked(int64_t now);                       // под unique-блокировкой
+
+    static std::string lower(std::string s);
+
+    mutable std::shared_mutex mx_;
+    std::unordered_map<std::string, Player>      by_name_;   // lower(ник) →
+    std::unordered_map<std::string, std::string> by_uuid_;   // uuid → lower(ник)
+    std::unordered_set<std::string>              online_;    // lower(ник)
+
+    PlayerTrackerOptions  opt_;
+    std::filesystem::path file_;
+    bool    dirty_ = false;        // под mx_
+    int64_t saved_at_ = 0;         // под mx_
+};
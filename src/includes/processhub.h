@@ -0,0 +1,79 @@
+#pragma once
+
+#include <windows.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* ===== Общий цикл ввода-вывода дочерних процессов =====
+   Один поток на все инстансы: опрашивает stdout-пайпы и ждёт
+   завершения процессов. Новый инстанс стоит пары хендлов, а не
+   пары потоков.                                                    */
+class ProcessHub {
+public:
+    using LineFn = std::function<void(const std::string&)>;
+    using ExitFn = std::function<void()>;
+
+    static ProcessHub& instance() {
+        static ProcessHub hub;
+        return hub;
+    }
+
+    /* Подписать пайп/процесс. pending — недочитанный хвост строки
+       (при передаче процесса из одного слота в другой). 0 — хендл
+       процесса не скопировать, подписки нет. */
+    int attach(HANDLE readPipe, HANDLE process, LineFn on_line, ExitFn on_exit,
+               std::string pending = {});
+
+    /* Отписать. После возврата колбэки этой подписки больше не вызываются.
+       Возвращает недочитанный хвост строки. */
+    std::string detach(int id);
+
+    void shutdown();
+
+    size_t watched() const;
+
+private:
+    ProcessHub() = default;
+    ~ProcessHub() { shutdown(); }
+
+    ProcessHub(const ProcessHub&)            = delete;
+    ProcessHub& operator=(const ProcessHub&) = delete;
+
+    /* process — собственная копия хендла (DuplicateHandle): владелец
+       может закрыть свой сразу после detach(), пока цикл ещё ждёт на
+       копии в WaitForMultipleObjects. Закрывается вместе с последним
+       shared_ptr на запись. */
+    struct Entry {
+        int         id;
+        HANDLE      pipe;
+        HANDLE      process = nullptr;
+        LineFn      on_line;
+        ExitFn      on_exit;
+        std::string buf;
+
+        Entry() = default;
+        Entry(const Entry&)            = delete;
+        Entry& operator=(const Entry&) = delete;
+        ~Entry() { if (process) CloseHandle(process); }
+    };
+
+    void loop();
+    bool pump(Entry& e);          // true — что-то прочитали
+    bool finished(Entry& e);      // процесс умер и пайп выбран до конца
+
+    mutable std::mutex mx_;        // entries_, stop_
+    std::condition_variable cv_;
+    std::vector<std::shared_ptr<Entry>> entries_;
+    bool stop_{false};
+    int  next_id_{1};
+
+    std::mutex dispatch_mx_;       // держится, пока идут колбэки
+    std::thread thread_;
+};
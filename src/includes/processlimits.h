@@ -0,0 +1,42 @@
+#pragma once
+
+#include <windows.h>
+
+#include <string>
+#include "json.hpp"
+
+/* ===== Политика размещения дочерней JVM =====
+   config.json, блок "launch" инстанса:
+     "cpu_set":     "0-15,32"        — маска процессоров (группа 0)
+     "numa_node":   0                — предпочтительный NUMA-узел для памяти
+     "priority":    "above_normal"   — класс приоритета процесса
+     "io_priority": "low"            — very_low | low | normal
+     "job": { "cpu_rate_percent": 90, "memory_limit_mb": 20480 }
+   Job Object на Windows — аналог cgroup v2: cpu_rate ≈ cpu.max,
+   memory_limit ≈ memory.max (жёсткий, мягкого memory.high нет).      */
+struct LaunchPolicy {
+    DWORD_PTR cpu_mask         = 0;    // 0 — все процессоры системы
+    int       numa_node        = -1;   // -1 — не задан
+    DWORD     priority_class   = 0;    // 0 — по умолчанию
+    int       io_priority      = -1;   // -1 — по умолчанию
+    int       cpu_rate_percent = 0;    // 0 — без ограничения
+    size_t    memory_limit_mb  = 0;    // 0 — без ограничения
+
+    static LaunchPolicy from_json(const nlohmann::json& launch);
+
+    bool needs_job() const { return cpu_rate_percent > 0 || memory_limit_mb > 0; }
+};
+
+namespace proclimits {
+
+/* "0-3,8,10-11" → маска; бросает std::runtime_error на мусор/CPU ≥ 64 */
+DWORD_PTR parse_cpu_list(const std::string& list);
+
+/* Применить политику к процессу, созданному с CREATE_SUSPENDED.
+   job — Job Object инстанса (создаётся при первом вызове). */
+bool apply(HANDLE process, const LaunchPolicy& policy, HANDLE& job);
+
+/* Закрепить сам mshost (веб, логгер, ProcessHub) на служебных ядрах */
+bool pin_current_process(DWORD_PTR mask);
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/* ===== Файл региона Minecraft (.mca), отображённый в память =====
+   Первые 8 КБ — заголовок: 1024 расположения (big-endian, сектор << 8 |
+   число секторов по 4 КБ) и 1024 метки времени (секунды). Чанк по
+   расположению: [длина u32][сжатие u8][данные]. Отображение только для
+   чтения и с общим доступом: файл может держать открытым сервер,
+   читаются лишь страницы, к которым обратились.                       */
+class MappedRegion {
+public:
+    static constexpr size_t kSector      = 4096;
+    static constexpr size_t kHeaderBytes = 2 * kSector;
+    static constexpr int    kSlots       = 1024;
+
+    /* Бросает std::runtime_error, если файл не открывается */
+    explicit MappedRegion(const std::filesystem::path& path);
+    ~MappedRegion();
+
+    MappedRegion(const MappedRegion&)            = delete;
+    MappedRegion& operator=(const MappedRegion&) = delete;
+
+    size_t               size() const { return size_; }
+    const unsigned char* data() const { return data_; }
+    bool                 has_header() const { return size_ >= kHeaderBytes; }
+
+    uint32_t location(int slot)  const { return be32(data_ + slot * 4); }
+    uint32_t timestamp(int slot) const { return be32(data_ + kSector + slot * 4); }
+    uint64_t offset(int slot)    const { return uint64_t(location(slot) >> 8) * kSector; }
+    uint32_t sectors(int slot)   const { return location(slot) & 0xFF; }
+
+    /* Данные чанка в пределах файла: [длина][сжатие][данные], nullptr — битый */
+    const unsigned char* chunk(int slot, uint32_t& length) const;
+
+    static uint32_t be32(const unsigned char* p) {
+        return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+    }
+
+    /* r.<x>.<z>.mca → координаты региона */
+    static bool coords(const std::filesystem::path& path, int& rx, int& rz);
+
+    /* Путь каталога с .mca относительно мира → измерение и вид:
+       "region" → minecraft:overworld/region, "DIM-1/entities" →
+       minecraft:the_nether/entities, "dimensions/ns/name/poi" → ns:name/poi */
+    static void classify(const std::filesystem::path& rel_dir, std::string& dimension, std::string& kind);
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE map_  = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
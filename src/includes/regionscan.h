@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include "json.hpp"
+
+/* ===== Отчёт о мире по заголовкам регионов =====
+   Все .mca мира (region, entities, poi во всех измерениях) отображаются
+   в память пулом потоков; читаются только 8 КБ заголовков — данные
+   чанков не распаковываются и не трогаются.
+
+   В отчёте:
+     dimensions       — по измерению и виду: файлы, байты, занятые
+                        секторами байты, чанки, возраст чанков по корзинам
+                        (1h, 1d, 7d, 30d, 90d, 365d, older);
+     largest_regions  — top регионов по размеру файла;
+     churned_regions  — top по числу чанков, изменённых за сутки;
+     largest_chunks   — top чанков по числу секторов (координаты чанка).
+   slack — байты файла, не занятые ни заголовком, ни чанками: столько
+   вернёт сжатие секторов.                                              */
+struct RegionScanOptions {
+    unsigned threads = 0;    // 0 — все ядра
+    size_t   top     = 20;
+};
+
+class RegionScanner {
+public:
+    /* Бросает std::runtime_error, если мира нет */
+    static nlohmann::json scan(const std::filesystem::path& world_dir, const RegionScanOptions& opt = {});
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "backup.h"
+#include "json.hpp"
+
+/* ===== Восстановление мира из снимка (dedup или clone) =====
+   paths пуст — весь мир: собирается рядом, в <world>.restore/, и
+   подменяет мир переименованием; прежний мир — в <world>.before-restore/.
+
+   paths — файлы или каталоги внутри мира ("region/r.0.0.mca", "DIM-1"):
+   восстанавливаются только они, остальное не трогается. Заменённые
+   файлы и файлы, которых в снимке не было (регионы новее снимка),
+   уезжают в <world>.before-restore/ с теми же путями.
+
+   Файлы пишутся пулом потоков во временные (<файл>.restore-tmp или
+   каталог .restore) с проверкой каждого объекта; подмена — только если
+   собрано всё. Прошлый .before-restore при этом удаляется.
+   Сервер должен быть остановлен — это проверяет вызывающий.          */
+class WorldRestore {
+public:
+    /* root — <dir>/<id> */
+    WorldRestore(std::filesystem::path root, BackupOptions opt);
+
+    /* Бросает std::invalid_argument (нет снимка, пути) и std::runtime_error */
+    RestoreStats restore(const std::filesystem::path& world_dir, const std::string& name,
+                         const std::vector<std::string>& paths);
+
+    /* Снимки обоих видов по возрастанию: [{name, kind, created, files, stats}] */
+    nlohmann::json catalog() const;
+
+private:
+    std::filesystem::path root_;
+    BackupOptions opt_;
+};
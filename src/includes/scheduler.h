@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "json.hpp"
+#include "timerwheel.h"
+
+class ServerRegistry;
+
+/* ===== Выражение cron: "мин час день месяц день_недели" =====
+   Поля: звёздочка, число, a-b, шаг /n после звёздочки или диапазона и
+   списки через запятую; месяцы и дни недели можно именами (jan, mon),
+   воскресенье — 0 или 7. Если заданы и день месяца, и день недели —
+   подходит любой из них, как в cron.
+   Макросы: @hourly, @daily (@midnight), @weekly, @monthly, @yearly.
+   Время — местное.                                                     */
+class CronExpr {
+public:
+    /* std::invalid_argument при ошибке разбора */
+    static CronExpr parse(const std::string& expr);
+
+    /* Ближайшая подходящая минута строго позже after (unix); -1 — никогда */
+    int64_t next(int64_t after) const;
+
+    const std::string& text() const { return text_; }
+
+private:
+    bool day_ok(int mday, int wday) const;
+
+    std::string text_;
+    uint64_t minutes_ = 0;
+    uint32_t hours_ = 0, days_ = 0;
+    uint16_t months_ = 0;
+    uint8_t  weekdays_ = 0;
+    bool     any_day_ = true, any_weekday_ = true;
+};
+
+/* ===== Планировщик задач (config.json "scheduler") =====
+   { "enabled": true, "state_file": "scheduler-state.json", "tasks": [
+       { "name": "restart-05", "cron": "0 5 * * *", "action": "restart",
+         "server": "main", "jitter_s": 0, "missed": "run" },
+       { "name": "autosave", "cron": "0,30 * * * *", "action": "command",
+         "command": "save-all" },
+       { "name": "warmup", "delay_s": 300, "action": "webhook",
+         "url": "http://127.0.0.1:9000/hook", "body": {...} } ] }
+
+   action: command, restart, start, stop, backup ("full": true), webhook
+   (POST JSON на http://; поля task, server, time добавляются в body).
+   server — id инстанса, по умолчанию основной.
+   jitter_s — случайная задержка 0..jitter_s к каждому запуску (сама
+   сетка cron не сдвигается). missed — что делать с запуском, который
+   опоздал больше чем на минуту (MSHost не работал, сон, перевод часов):
+   "skip" (по умолчанию) — пропустить, "run" — выполнить один раз.
+   Время последнего запуска задач хранится в state_file.
+
+   Все сроки — в одном TimerWheel на одном потоке: поток спит до
+   ближайшего срока (не дольше минуты — заметить перевод часов), тысячи
+   задач не стоят ни потоков, ни опроса. Команды консоли выполняются
+   сразу, долгие действия (restart, backup, webhook, start/stop) — по
+   очереди на втором потоке; задача, которая ещё выполняется, повторно
+   не ставится.                                                         */
+class Scheduler {
+public:
+    static Scheduler& instance() {
+        static Scheduler scheduler;
+        return scheduler;
+    }
+
+    void start(const nlohmann::json& config, ServerRegistry& servers);
+    void reload(const nlohmann::json& config);   // перечитанный config.json
+    void shutdown();
+    bool enabled() const { return started_; }
+
+    /* {"enabled", "tasks": [...]} — по ближайшему сроку */
+    nlohmann::json to_json() const;
+
+    /* Разовая задача из API: {"delay_s", "action", ...}; std::invalid_argument */
+    nlohmann::json add_once(const nlohmann::json& task);
+
+    /* Снять задачу до следующей перезагрузки конфига; false — нет такой */
+    bool cancel(const std::string& name);
+
+private:
+    Scheduler() = default;
+    ~Scheduler() { shutdown(); }
+    Scheduler(const Scheduler&)            = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    struct Action {
+        std::string    kind;      // command | restart | start | stop | backup | webhook
+        std::string    server;    // пусто — основной инстанс
+        std::string    command;
+        std::string    url;
+        nlohmann::json body;
+        bool           full = false;
+    };
+
+    struct Task {
+        std::string name;
+        Action      action;
+        bool        has_cron = false;
+        CronExpr    cron;
+        int64_t     delay_s  = 0;
+        int         jitter_s = 0;
+        bool        run_missed = false;
+
+        uint64_t uid  = 0;   // запись в колесе; у перевзведённой задачи — новый
+        int64_t  base = 0;   // срок по сетке, без jitter
+        int64_t  due  = 0;
+        int64_t  last_run = 0;
+        uint64_t runs = 0;
+        bool     from_api = false;   // разовая из API: после запуска удаляется
+    };
+
+    struct Job {
+        std::string name;
+        Action      action;
+    };
+
+    static Task parse_task(const nlohmann::json& j, bool from_api);
+    void apply(const nlohmann::json& config, int64_t now);   // под mx_
+    void rearm_all(int64_t now, bool catch_up);              // под mx_
+    void arm(Task& t, int64_t base);                         // под mx_
+    bool fire(Task& t, int64_t now, std::vector<Job>& now_jobs);   // под mx_; false — задачу убрать
+    void loop();
+    void exec_loop();
+    void run(const Job& job);
+    void save_state();                                       // под mx_
+    nlohmann::json task_json(const Task& t) const;
+
+    ServerRegistry*  servers_ = nullptr;
+    std::atomic<bool> started_{false};
+    std::atomic<bool> stop_{false};
+
+    mutable std::mutex      mx_;
+    std::condition_variable cv_;
+    TimerWheel              wheel_;
+    std::unordered_map<std::string, Task>    tasks_;      // имя →
+    std::unordered_map<uint64_t, std::string> armed_;     // uid → имя
+    std::unordered_map<std::string, int64_t> last_runs_;  // из state_file
+    std::unordered_set<std::string>          done_once_;  // отработавшие delay_s
+    std::unordered_set<std::string>          busy_;       // в очереди или выполняются
+    std::string state_file_ = "scheduler-state.json";
+    bool        state_loaded_ = false;
+    int64_t     started_at_ = 0;   // отсчёт для delay_s из конфига
+    uint64_t    next_uid_ = 0;
+    uint64_t    once_seq_ = 0;
+
+    std::mutex              q_mx_;
+    std::condition_variable q_cv_;
+    std::deque<Job>         queue_;
+    bool                    exec_done_ = false;   // под q_mx_: exec_ вышел из цикла
+
+    /* Сколько shutdown() ждёт текущую задачу (restart, backup), потом — без неё */
+    static constexpr std::chrono::milliseconds kExecWait{3000};
+
+    std::thread thread_, exec_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "minecraftservermanager.h"
+
+/* ===== Реестр инстансов Minecraft-сервера =====
+   config.json: "servers": [ { "id": "...", <поля как у "server"> }, ... ].
+   Старый формат с одним "server" даёт один инстанс с id "main".
+   У каждого инстанса может быть свой блок "java" — он накладывается
+   поверх общего.                                                     */
+class ServerRegistry {
+public:
+    explicit ServerRegistry(const json& config);
+
+    ServerRegistry(const ServerRegistry&)            = delete;
+    ServerRegistry& operator=(const ServerRegistry&) = delete;
+
+    MinecraftServerManager* find(const std::string& id) const;
+    MinecraftServerManager& primary() const { return *servers_.front(); }
+
+    const std::vector<std::unique_ptr<MinecraftServerManager>>& all() const { return servers_; }
+    size_t size() const { return servers_.size(); }
+
+    void stop_all();
+
+    /* Перечитанный config.json: раздать инстансам их части.
+       Добавление/удаление инстансов требует перезапуска mshost. */
+    void reload(const json& config);
+
+private:
+    /* id → {"java": ..., "server": ...} для каждого инстанса */
+    static std::vector<std::pair<std::string, json>> instance_configs(const json& config);
+
+    std::vector<std::unique_ptr<MinecraftServerManager>> servers_;
+};
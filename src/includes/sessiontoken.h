@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "sha256.h"
+
+/* ===== Права доступа к API =====
+   read    — статус, логи, метрики, скачивание сборки (GET)
+   control — всё остальное: команды, старт/стоп, /api/exit         */
+enum class Scope : uint8_t { None = 0, Read = 1, Control = 2 };
+
+inline bool scope_allows(Scope have, Scope need) { return have >= need; }
+const char* scope_name(Scope s);
+Scope       parse_scope(const std::string& s);   // "read" / "control", иначе None
+
+/* HMAC-SHA256 с заранее поглощённым ключом: на подпись — копия двух
+   состояний и два коротких хеширования, без повторной обработки ключа */
+class HmacSha256 {
+public:
+    explicit HmacSha256(const std::string& key);
+    Sha256::Digest sign(const std::string& msg) const;
+
+private:
+    Sha256 inner_, outer_;
+};
+
+/* ===== Сессионные токены =====
+   Формат: v1.<r|c>.<expires unix>.<nonce>.<hmac hex>. Проверка без
+   общего состояния: пересчитать подпись и сравнить срок. Ключ живёт
+   в памяти процесса (или web.session_secret), так что перезапуск
+   mshost без session_secret обнуляет все сессии.                  */
+class SessionTokens {
+public:
+    SessionTokens(const std::string& secret, int ttl_s);
+
+    std::string issue(Scope scope, int64_t& expires_at) const;
+    Scope       verify(const std::string& token) const;   // None — подделан или истёк
+
+    int ttl_s() const { return ttl_s_; }
+
+private:
+    HmacSha256 mac_;
+    int        ttl_s_;
+};
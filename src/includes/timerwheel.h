@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* ===== Иерархическое колесо таймеров, шаг — секунда =====
+   4 уровня по 64 слота: 64 с, ~68 мин, ~3 сут, ~194 сут. Уровень записи —
+   старшая группа из 6 бит, в которой срок отличается от текущего
+   времени; при переходе через границу группы слот уровня выше
+   раскладывается по нижним. Срок дальше диапазона лежит в верхнем
+   уровне и перекладывается, когда до него дойдёт очередь.
+
+   Добавление — O(1). Каждый уровень держит маску занятых слотов, так
+   что next_due() находит ближайший момент, когда что-то истечёт или
+   разложится, за 4 шага: поток спит до него, а не опрашивает записи.
+   Отмены нет — вызывающий отбрасывает устаревшие id сам.
+   Не потокобезопасно.                                                  */
+class TimerWheel {
+public:
+    static constexpr int kBits   = 6;
+    static constexpr int kSlots  = 1 << kBits;
+    static constexpr int kLevels = 4;
+
+    struct Entry {
+        int64_t  due;
+        uint64_t id;
+    };
+
+    explicit TimerWheel(int64_t now = 0) : now_(now) {}
+
+    void reset(int64_t now);                     // очистить, часы — на now
+    void add(int64_t due, uint64_t id);          // due <= now() — истечёт на ближайшем advance
+    void advance(int64_t to, std::vector<Entry>& expired);   // всё с due <= to
+
+    /* Ближайший момент, когда advance() что-то сделает; INT64_MAX — пусто */
+    int64_t next_due() const;
+
+    int64_t now()  const { return now_; }
+    size_t  size() const { return size_; }
+
+private:
+    void place(const Entry& e);
+    void tick(int64_t t, std::vector<Entry>& expired);
+
+    int64_t now_;
+    size_t  size_ = 0;
+    std::array<std::array<std::vector<Entry>, kSlots>, kLevels> slots_;
+    std::array<uint64_t, kLevels> occupied_{};
+    std::vector<Entry> overdue_;
+};
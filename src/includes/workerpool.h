@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "httplib.h"
+#include "json.hpp"
+#include "metrics.h"
+
+/* ===== Пул обработчиков HTTP =====
+   httplib ставит в очередь соединение целиком, путь запроса ещё не
+   известен. Поэтому полосы работают на уровне запроса:
+     control — /api/... кроме логов и скачивания, статика сайта: не
+               режется никогда;
+     bulk    — скачивание сборки, логи, обход мира: не больше bulk_threads
+               одновременно, остальные ждут слот до bulk_wait_ms. 503 —
+               только при очереди больше shed_queue (или истёк bulk_wait_ms).
+   Ждущие bulk занимают поток, но один поток всегда остаётся control.
+
+   config.json, "web": { "pool": { "threads": 8, "bulk_threads": 3,
+                                   "bulk_wait_ms": 10000,
+                                   "max_queue": 256, "shed_queue": 32 } } */
+class WorkerPool final : public httplib::TaskQueue {
+public:
+    enum class Lane { Control, Bulk };
+
+    struct Options {
+        size_t threads      = 8;
+        size_t bulk_threads = 3;     // потолок одновременных bulk-запросов
+        size_t bulk_wait_ms = 10000; // сколько bulk ждёт свободный слот
+        size_t max_queue    = 256;   // сверх — соединение закрывается сразу
+        size_t shed_queue   = 32;    // сверх — bulk получает 503
+
+        static Options from_json(const nlohmann::json& pool);
+    };
+
+    explicit WorkerPool(Options opt);
+    ~WorkerPool() override = default;
+
+    bool enqueue(std::function<void()> fn) override;
+    void shutdown() override;
+
+    static Lane lane_of(const std::string& path);
+
+    /* Вызывается из pre-routing в потоке пула; bulk может ждать слот.
+       false — ответить 503 */
+    bool admit(Lane lane);
+
+    /* Конец запроса (logger httplib) или соединения — освободить bulk-слот */
+    void release();
+
+    size_t depth() const { return depth_.load(std::memory_order_relaxed); }
+
+private:
+    struct Job {
+        std::function<void()>                 fn;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    void worker();
+
+    Options opt_;
+    std::mutex mx_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    bool stop_{false};
+    std::vector<std::thread> threads_;
+
+    std::atomic<size_t> depth_{0};
+
+    /* Слоты bulk: семафор на bulk_threads с ограниченным ожиданием */
+    std::mutex              bulk_mx_;
+    std::condition_variable bulk_cv_;
+    size_t                  bulk_active_{0};    // под bulk_mx_
+    size_t                  bulk_waiting_{0};   // под bulk_mx_
+    std::atomic<bool>       closing_{false};
+
+    Histogram&             queue_wait_;
+    std::atomic<int64_t>&  depth_gauge_;
+    std::atomic<int64_t>&  bulk_gauge_;
+    std::atomic<int64_t>&  bulk_waiting_gauge_;
+    std::atomic<uint64_t>& shed_total_;
+    std::atomic<uint64_t>& rejected_total_;
+};
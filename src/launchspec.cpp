@@ -0,0 +1,272 @@
+#include "./includes/launchspec.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+LaunchSpec::Options LaunchSpec::options_from_json(const nlohmann::json& java, const nlohmann::json& server) {
+    Options o;
+    o.java_path     = java.at("path").get<std::string>();
+    o.server_dir    = server.at("directory").get<std::string>();
+    o.forge_args    = server.value("forge_args", "");
+    o.user_jvm_args = server.value("user_jvm_args", "");
+
+    if (java.contains("jvm_args") && java["jvm_args"].is_array()) {
+        for (const auto& arg : java["jvm_args"]) o.jvm_args.push_back(arg.get<std::string>());
+    }
+    if (java.contains("cds")) {
+        o.cds_enabled = java["cds"].value("enabled", o.cds_enabled);
+        o.cds_archive = java["cds"].value("archive", o.cds_archive);
+    }
+    return o;
+}
+
+/* ------------------------------------------------------------------ */
+/*              Разбор @argfile (правила java launcher)               */
+/* ------------------------------------------------------------------ */
+/*  Пробелы разделяют аргументы; "..." и '...' — один аргумент;
+    # в начале аргумента — комментарий до конца строки; обратный слэш
+    экранирует только внутри кавычек (\n \t \r \f, \\ \" \', перенос
+    строки). Вне кавычек \ — обычный символ (пути Windows).            */
+std::vector<std::string> LaunchSpec::parse_argfile(const std::string& text) {
+    std::vector<std::string> out;
+    std::string cur;
+    bool   in_token = false;
+    char   quote    = 0;
+    size_t i = 0, n = text.size();
+
+    while (i < n) {
+        char c = text[i];
+
+        if (quote) {
+            if (c == quote) { quote = 0; ++i; continue; }
+            if (c == '\\' && i + 1 < n) {
+                char e = text[i + 1];
+                i += 2;
+                switch (e) {
+                    case 'n': cur += '\n'; break;
+                    case 't': cur += '\t'; break;
+                    case 'r': cur += '\r'; break;
+                    case 'f': cur += '\f'; break;
+                    case '\r': if (i < n && text[i] == '\n') ++i; [[fallthrough]];
+                    case '\n':
+                        while (i < n && (text[i] == ' ' || text[i] == '\t')) ++i;
+                        break;
+                    default: cur += e; break;
+                }
+                continue;
+            }
+            cur += c; ++i;
+            continue;
+        }
+
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (in_token) { out.push_back(std::move(cur)); cur.clear(); in_token = false; }
+            ++i;
+            continue;
+        }
+        if (c == '#' && !in_token) {
+            while (i < n && text[i] != '\n') ++i;
+            continue;
+        }
+        if (c == '"' || c == '\'') { quote = c; in_token = true; ++i; continue; }
+
+        cur += c; in_token = true; ++i;
+    }
+    if (in_token) out.push_back(std::move(cur));
+    return out;
+}
+
+/* ---------- Экранирование для CreateProcess (обратное CommandLineToArgvW) ---------- */
+std::string LaunchSpec::quote_arg(const std::string& arg) {
+    if (!arg.empty() && arg.find_first_of(" \t\n\v\"") == std::string::npos) return arg;
+
+    std::string out = "\"";
+    size_t slashes = 0;
+    for (char c : arg) {
+        if (c == '\\') { ++slashes; continue; }
+        if (c == '"') out.append(slashes * 2 + 1, '\\');
+        else          out.append(slashes, '\\');
+        slashes = 0;
+        out += c;
+    }
+    out.append(slashes * 2, '\\');   // перед закрывающей кавычкой
+    out += '"';
+    return out;
+}
+
+/* ---------- @file → аргументы (кеш по mtime/размеру) ---------- */
+const std::vector<std::string>* LaunchSpec::expand_argfile(const std::string& rel) {
+    namespace fs = std::filesystem;
+    const fs::path path = fs::path(opt_.server_dir) / rel;
+
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec) {
+        LOG_WARNING("argfile не найден: " + path.string(), "MC_LAUNCH");
+        return nullptr;
+    }
+    auto size = fs::file_size(path, ec);
+
+    auto it = cache_.find(rel);
+    if (it != cache_.end() && it->second.mtime == mtime && it->second.size == size) {
+        return &it->second.args;
+    }
+
+    std::ifstream f(path, std::ios::binary);
+    std::stringstream ss;
+    ss << f.rdbuf();
+
+    ArgFile& entry = cache_[rel];
+    entry.mtime = mtime;
+    entry.size  = size;
+    entry.args  = parse_argfile(ss.str());
+
+    LOG_INFO("argfile раскрыт: " + rel + " (" + std::to_string(entry.args.size()) + " аргументов)", "MC_LAUNCH");
+    validate_paths(rel, entry.args);
+    return &entry.args;
+}
+
+void LaunchSpec::append_expanded(std::vector<std::string>& out, const std::string& arg) {
+    if (arg.size() > 1 && arg[0] == '@' && arg[1] != '@') {
+        if (const auto* args = expand_argfile(arg.substr(1))) {
+            out.insert(out.end(), args->begin(), args->end());
+            return;
+        }
+    }
+    out.push_back(arg);   // не раскрылся — пусть java попробует сама
+}
+
+/* ---------- Проверка classpath / module-path (один раз на версию файла) ---------- */
+void LaunchSpec::validate_paths(const std::string& file, const std::vector<std::string>& args) const {
+    namespace fs = std::filesystem;
+    static const char* list_opts[] = { "-p", "--module-path", "-cp", "-classpath", "--class-path" };
+    static const std::string legacy = "-DlegacyClassPath=";
+
+    size_t checked = 0, missing = 0;
+    std::string first_missing;
+
+    auto check_list = [&](const std::string& list) {
+        size_t pos = 0;
+        while (pos <= list.size()) {
+            size_t sep = list.find(';', pos);
+            std::string entry = list.substr(pos, sep == std::string::npos ? std::string::npos : sep - pos);
+            pos = (sep == std::string::npos) ? list.size() + 1 : sep + 1;
+            if (entry.empty()) continue;
+
+            ++checked;
+            std::error_code ec;
+            if (!fs::exists(fs::path(opt_.server_dir) / entry, ec)) {
+                if (!missing++) first_missing = entry;
+            }
+        }
+    };
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& a = args[i];
+        if (a.rfind(legacy, 0) == 0) { check_list(a.substr(legacy.size())); continue; }
+        for (const char* opt : list_opts) {
+            if (a == opt && i + 1 < args.size()) { check_list(args[++i]); break; }
+        }
+    }
+
+    if (missing) {
+        LOG_ERR(file + ": не найдено " + std::to_string(missing) + " из " + std::to_string(checked) +
+                " путей classpath, первый: " + first_missing, "MC_LAUNCH");
+    } else if (checked) {
+        LOG_INFO(file + ": classpath проверен, путей: " + std::to_string(checked), "MC_LAUNCH");
+    }
+}
+
+/* ---------- CDS: писать архив при первом запуске, дальше читать ---------- */
+/*  Ключ архива — хеш полной (раскрытой) argv и самой java. Изменился
+    модпак или флаги — архив пересоздаётся. Ключ записи лежит в
+    .key.pending и становится .key, только когда архив появился:
+    процесс, убитый TerminateProcess, архив не пишет — тогда попытка
+    повторится на следующем запуске.                                   */
+std::vector<std::string> LaunchSpec::cds_flags(const std::vector<std::string>& base) const {
+    namespace fs = std::filesystem;
+
+    uint64_t h = 1469598103934665603ull;   // FNV-1a
+    auto mix = [&h](const std::string& s) {
+        for (unsigned char c : s) { h ^= c; h *= 1099511628211ull; }
+        h ^= 0; h *= 1099511628211ull;
+    };
+    for (const auto& a : base) mix(a);
+    std::error_code ec;
+    mix(std::to_string(fs::file_size(opt_.java_path, ec)));
+
+    std::ostringstream key;
+    key << std::hex << h;
+
+    const fs::path archive = fs::path(opt_.server_dir) / opt_.cds_archive;
+    const fs::path keyfile = fs::path(archive).concat(".key");
+    const fs::path pending = fs::path(archive).concat(".key.pending");
+
+    // Архив появился — запуск с ArchiveClassesAtExit завершился штатно
+    if (fs::exists(pending, ec) && fs::exists(archive, ec)) fs::rename(pending, keyfile, ec);
+
+    std::string stored;
+    std::ifstream(keyfile) >> stored;
+
+    if (stored == key.str() && fs::exists(archive, ec)) {
+        return { "-XX:SharedArchiveFile=" + opt_.cds_archive };
+    }
+
+    fs::remove(archive, ec);
+    fs::remove(keyfile, ec);
+    std::ofstream(pending, std::ios::trunc) << key.str();
+    LOG_INFO("CDS-архив будет записан при выходе: " + archive.string(), "MC_LAUNCH");
+    return { "-XX:ArchiveClassesAtExit=" + opt_.cds_archive };
+}
+
+/* ------------------------------------------------------------------ */
+/*                               Сборка                               */
+/* ------------------------------------------------------------------ */
+std::vector<std::string> LaunchSpec::build(bool expand_forge, size_t& main_at) {
+    std::vector<std::string> out{ opt_.java_path };
+    for (const auto& a : opt_.jvm_args) append_expanded(out, a);
+    for (const auto& a : parse_argfile(opt_.user_jvm_args)) append_expanded(out, a);
+
+    main_at = out.size();   // дальше — main class и её аргументы
+    for (const auto& a : parse_argfile(opt_.forge_args)) {
+        if (expand_forge) append_expanded(out, a);
+        else              out.push_back(a);
+    }
+    out.push_back("nogui");
+    return out;
+}
+
+std::string LaunchSpec::command_line() {
+    constexpr size_t max_cmdline = 32767;   // предел CreateProcess
+
+    auto join = [](const std::vector<std::string>& args) {
+        std::string line;
+        for (const auto& a : args) {
+            if (!line.empty()) line += ' ';
+            line += quote_arg(a);
+        }
+        return line;
+    };
+
+    std::lock_guard lg(mx_);
+    size_t main_at = 0;
+    auto args = build(true, main_at);
+
+    // CDS-ключ — всегда от раскрытой argv: запасной вариант ниже тот же архив
+    std::vector<std::string> flags;
+    if (opt_.cds_enabled) flags = cds_flags(args);
+    args.insert(args.begin() + main_at, flags.begin(), flags.end());
+
+    std::string line = join(args);
+    if (line.size() < max_cmdline) return line;
+
+    // Раскрытый module-path не влез — отдаём forge_args как есть, java раскроет сама
+    LOG_WARNING("Командная строка длиннее " + std::to_string(max_cmdline) +
+                " символов, forge_args передаётся как @argfile", "MC_LAUNCH");
+    args = build(false, main_at);
+    args.insert(args.begin() + main_at, flags.begin(), flags.end());
+    return join(args);
+}
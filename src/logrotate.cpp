@@ -0,0 +1,155 @@
+#include "./includes/logrotate.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#ifdef MSHOST_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fs = std::filesystem;
+
+bool LogRotator::compression_available() {
+#ifdef MSHOST_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+void LogRotator::start(const fs::path& logs_root, const fs::path& current_session, const LogRotation& policy) {
+    stop();
+    root_    = logs_root;
+    current_ = current_session;
+    policy_  = policy;
+    stop_    = false;
+    thread_  = std::thread(&LogRotator::loop, this);
+}
+
+void LogRotator::submit(const fs::path& segment) {
+    {
+        std::lock_guard lg(mx_);
+        queue_.push_back(segment);
+    }
+    cv_.notify_one();
+}
+
+void LogRotator::stop() {
+    stop_ = true;
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void LogRotator::loop() {
+#ifdef _WIN32
+    // Низкий приоритет CPU и IO: сжатие не должно мешать серверу
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#endif
+    sweep_uncompressed();   // остатки прошлых запусков
+    enforce_retention();
+
+    for (;;) {
+        fs::path next;
+        {
+            std::unique_lock lk(mx_);
+            cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            next = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        if (policy_.compress && compression_available()) compress(next);
+        enforce_retention();
+    }
+}
+
+/* ---------- segment.log → segment.log.gz, оригинал удаляется ---------- */
+bool LogRotator::compress(const fs::path& src) {
+#ifdef MSHOST_HAVE_ZLIB
+    const fs::path dst = fs::path(src).concat(".gz");
+    const fs::path tmp = fs::path(dst).concat(".part");
+
+    std::ifstream in(src, std::ios::binary);
+    if (!in) return false;   // уже удалён чисткой
+    gzFile out = gzopen(tmp.string().c_str(), "wb6");
+    if (!out) return false;
+
+    std::vector<char> buf(256 * 1024);
+    bool ok = true;
+    while (in && ok) {
+        if (stop_) { ok = false; break; }   // выходим сразу, дожмём в следующий раз
+        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        const auto n = in.gcount();
+        if (n > 0 && gzwrite(out, buf.data(), static_cast<unsigned>(n)) != n) ok = false;
+    }
+    ok = (gzclose(out) == Z_OK) && ok;
+    in.close();
+
+    std::error_code ec;
+    if (!ok) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    fs::rename(tmp, dst, ec);
+    if (ec) return false;
+    fs::remove(src, ec);
+    return true;
+#else
+    (void)src;
+    return false;
+#endif
+}
+
+void LogRotator::sweep_uncompressed() {
+    if (!policy_.compress || !compression_available()) return;
+
+    std::error_code ec;
+    for (const auto& session : fs::directory_iterator(root_, ec)) {
+        if (!session.is_directory() || session.path() == current_) continue;
+        std::error_code ec2;
+        for (const auto& f : fs::directory_iterator(session.path(), ec2)) {
+            if (stop_) return;
+            if (f.path().extension() == ".log") compress(f.path());
+        }
+    }
+}
+
+/* ---------- Чистка: не больше keep_segments и не старше max_age_days ---------- */
+void LogRotator::enforce_retention() {
+    if (!policy_.keep_segments && !policy_.max_age_days) return;
+
+    struct Seg { fs::path path; fs::file_time_type mtime; };
+    std::vector<Seg> segs;
+
+    std::error_code ec;
+    for (const auto& session : fs::directory_iterator(root_, ec)) {
+        if (!session.is_directory()) continue;
+        std::error_code ec2;
+        for (const auto& f : fs::directory_iterator(session.path(), ec2)) {
+            const std::string name = f.path().filename().string();
+            const bool is_log = f.path().extension() == ".log" ||
+                                (name.size() > 7 && name.compare(name.size() - 7, 7, ".log.gz") == 0);
+            if (!is_log || !f.is_regular_file()) continue;
+            segs.push_back({ f.path(), f.last_write_time(ec2) });
+        }
+    }
+    std::sort(segs.begin(), segs.end(), [](const Seg& a, const Seg& b) { return a.mtime > b.mtime; });
+
+    const auto cutoff = fs::file_time_type::clock::now() - std::chrono::hours(24) * policy_.max_age_days;
+    size_t removed = 0;
+    for (size_t i = 0; i < segs.size(); ++i) {
+        const bool too_many = policy_.keep_segments && i >= policy_.keep_segments;
+        const bool too_old  = policy_.max_age_days && segs[i].mtime < cutoff;
+        if (!too_many && !too_old) continue;
+        if (fs::remove(segs[i].path, ec)) ++removed;
+    }
+
+    // Пустые каталоги сессий — тоже
+    for (const auto& session : fs::directory_iterator(root_, ec)) {
+        if (session.is_directory() && session.path() != current_ && fs::is_empty(session.path(), ec)) {
+            fs::remove(session.path(), ec);
+        }
+    }
+    if (removed) LOG_INFO("Удалено старых сегментов лога: " + std::to_string(removed), "LOGGER");
+}
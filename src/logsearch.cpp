@@ -0,0 +1,575 @@
+#include "./includes/logsearch.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef MSHOST_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t kMinWord = 2;           // короче — не индексируется
+    constexpr size_t kMaxWord = 64;
+    constexpr size_t kMaxChecks = 200000;    // проверок кандидатов за запрос, дальше — next
+    constexpr size_t kLiveWindow = 32u << 20;   // байт текущего файла за запрос
+    constexpr auto   kGcEvery    = std::chrono::minutes(10);   // проверка удалённых сегментов
+
+    /* server.NNN.log[.gz] → NNN: имя с setw(3) после 999 сегментов
+       лексически сортируется неверно */
+    uint64_t segment_no(const fs::path& p) {
+        std::string name = p.filename().string();
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) name.resize(name.size() - 3);
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".log") == 0) name.resize(name.size() - 4);
+        const size_t dot = name.rfind('.');
+        if (dot == std::string::npos) return 0;
+        uint64_t n = 0;
+        for (size_t i = dot + 1; i < name.size(); ++i) {
+            if (name[i] < '0' || name[i] > '9') return 0;
+            n = n * 10 + static_cast<uint64_t>(name[i] - '0');
+        }
+        return n;
+    }
+
+    bool word_byte(unsigned char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               c == '_' || c >= 0x80;
+    }
+
+    char lower(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; }
+
+    std::string lowered(std::string_view s) {
+        std::string r(s);
+        for (auto& c : r) c = lower(c);
+        return r;
+    }
+
+    template <class Fn>
+    void for_each_word(std::string_view s, Fn fn) {
+        size_t i = 0;
+        while (i < s.size()) {
+            while (i < s.size() && !word_byte(s[i])) ++i;
+            const size_t b = i;
+            while (i < s.size() && word_byte(s[i])) ++i;
+            if (i - b >= kMinWord && i - b <= kMaxWord) fn(s.substr(b, i - b));
+        }
+    }
+
+    /* Терм по границам слов — как и в индексе: "exception" не находится
+       в "nullpointerexception". line и term уже в нижнем регистре.      */
+    bool has_term(std::string_view line, std::string_view term) {
+        for (size_t pos = line.find(term); pos != std::string_view::npos; pos = line.find(term, pos + 1)) {
+            const size_t end = pos + term.size();
+            const bool left  = pos == 0 || !word_byte(line[pos - 1]) || !word_byte(term.front());
+            const bool right = end == line.size() || !word_byte(line[end]) || !word_byte(term.back());
+            if (left && right) return true;
+        }
+        return false;
+    }
+
+    /* слова и "фразы в кавычках" */
+    std::vector<std::string> parse_terms(const std::string& q) {
+        std::vector<std::string> terms;
+        std::string cur;
+        bool quoted = false;
+        auto flush = [&] {
+            const auto b = cur.find_first_not_of(' ');
+            if (b != std::string::npos) terms.push_back(cur.substr(b, cur.find_last_not_of(' ') - b + 1));
+            cur.clear();
+        };
+        for (char c : q) {
+            if (c == '"')                  { flush(); quoted = !quoted; continue; }
+            if (!quoted && (c == ' ' || c == '\t')) { flush(); continue; }
+            cur += lower(c);
+        }
+        flush();
+        return terms;
+    }
+
+    /* "[YYYY-MM-DD HH:MM:SS] ..." → unix-секунды (локальное время); 0 — без метки.
+       mktime — раз в час лога, остальное арифметикой. */
+    class TsParser {
+    public:
+        int64_t operator()(std::string_view line) {
+            if (line.size() < 21 || line[0] != '[' || line[5] != '-' || line[8] != '-' ||
+                line[11] != ' ' || line[14] != ':' || line[17] != ':' || line[20] != ']') return 0;
+            for (size_t i : { 1, 2, 3, 4, 6, 7, 9, 10, 12, 13, 15, 16, 18, 19 }) {
+                if (line[i] < '0' || line[i] > '9') return 0;
+            }
+            auto num = [&](size_t i, size_t n) {
+                int v = 0;
+                for (size_t k = 0; k < n; ++k) v = v * 10 + (line[i + k] - '0');
+                return v;
+            };
+            const std::string_view hour = line.substr(1, 13);
+            if (hour != hour_key_) {
+                std::tm tm{};
+                tm.tm_year  = num(1, 4) - 1900;
+                tm.tm_mon   = num(6, 2) - 1;
+                tm.tm_mday  = num(9, 2);
+                tm.tm_hour  = num(12, 2);
+                tm.tm_isdst = -1;
+                hour_key_.assign(hour);
+                hour_base_ = static_cast<int64_t>(std::mktime(&tm));
+            }
+            return hour_base_ + num(15, 2) * 60 + num(18, 2);
+        }
+
+    private:
+        std::string hour_key_;
+        int64_t     hour_base_ = 0;
+    };
+
+    /* path или path.gz — ротатор сжимает сегменты уже после индексации */
+    bool read_segment(const fs::path& path, std::string& out) {
+        std::error_code ec;
+        if (fs::exists(path, ec)) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) return false;
+            in.seekg(0, std::ios::end);
+            out.resize(static_cast<size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(out.data(), static_cast<std::streamsize>(out.size()));
+            out.resize(static_cast<size_t>(in.gcount()));
+            return true;
+        }
+#ifdef MSHOST_HAVE_ZLIB
+        const fs::path gz = fs::path(path).concat(".gz");
+        if (fs::exists(gz, ec)) {
+            gzFile f = gzopen(gz.string().c_str(), "rb");
+            if (!f) return false;
+            std::vector<char> buf(256 * 1024);
+            int n;
+            while ((n = gzread(f, buf.data(), static_cast<unsigned>(buf.size()))) > 0) out.append(buf.data(), n);
+            gzclose(f);
+            return n == 0;
+        }
+#endif
+        return false;
+    }
+
+    std::string_view line_at(const std::string& text, size_t off) {
+        size_t eol = text.find('\n', off);
+        if (eol == std::string::npos) eol = text.size();
+        std::string_view line(text.data() + off, eol - off);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return line;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*                             Postings                               */
+/* ------------------------------------------------------------------ */
+void LogSearch::Postings::add(uint32_t line) {
+    uint32_t d = count ? line - last : line;
+    while (d >= 0x80) {
+        data.push_back(static_cast<uint8_t>(d | 0x80));
+        d >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(d));
+    last = line;
+    ++count;
+}
+
+void LogSearch::Postings::decode(std::vector<uint32_t>& out) const {
+    out.clear();
+    out.reserve(count);
+    size_t   i   = 0;
+    uint32_t cur = 0;
+    for (uint32_t k = 0; k < count; ++k) {
+        uint32_t d = 0;
+        int shift  = 0;
+        uint8_t b;
+        do {
+            b = data[i++];
+            d |= uint32_t(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        cur = k ? cur + d : d;
+        out.push_back(cur);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*                            Индексатор                              */
+/* ------------------------------------------------------------------ */
+void LogSearch::start(const fs::path& logs_root, const fs::path& live_file, size_t cache_segments) {
+    if (started_) return;
+    root_        = logs_root;
+    live_        = live_file;
+    cache_limit_ = std::max<size_t>(cache_segments, 1);
+    stop_        = false;
+    started_     = true;
+    thread_      = std::thread(&LogSearch::loop, this);
+}
+
+void LogSearch::shutdown() {
+    stop_ = true;
+    q_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void LogSearch::submit(const fs::path& segment) {
+    if (!started_) return;
+    if (segment.filename().string().rfind(live_.stem().string() + ".", 0) != 0) return;   // web.* — мимо
+    {
+        std::lock_guard lg(q_mx_);
+        queue_.push_back(segment);
+    }
+    q_cv_.notify_one();
+}
+
+void LogSearch::loop() {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#endif
+    const std::string prefix = live_.stem().string() + ".";
+    auto is_segment = [&](const fs::path& p) {
+        const std::string name = p.filename().string();
+        if (name.rfind(prefix, 0) != 0) return false;
+        return p.extension() == ".log" ||
+               (p.extension() == ".gz" && p.stem().extension() == ".log");
+    };
+
+    // Весь архив: сессии по имени (это время старта), сегменты по номеру
+    indexing_ = true;
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<fs::path> sessions;
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(root_, ec)) {
+        if (e.is_directory()) sessions.push_back(e.path());
+    }
+    std::sort(sessions.begin(), sessions.end());
+
+    for (const auto& session : sessions) {
+        std::vector<fs::path> files;
+        for (const auto& f : fs::directory_iterator(session, ec)) {
+            if (f.is_regular_file() && is_segment(f.path())) files.push_back(f.path());
+        }
+        std::sort(files.begin(), files.end(), [](const fs::path& a, const fs::path& b) {
+            return segment_no(a) < segment_no(b);
+        });
+        for (const auto& f : files) {
+            if (stop_) return;
+            index_segment(f);
+        }
+    }
+    indexing_ = false;
+
+    {
+        std::shared_lock lk(mx_);
+        LOG_INFO("Индекс логов готов: сегментов " + std::to_string(segments_.size()) +
+                 ", строк " + std::to_string(line_off_.size()) + " за " +
+                 std::to_string(std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::steady_clock::now() - t0).count()) + " с", "LOGGER");
+    }
+
+    for (;;) {
+        fs::path next;
+        {
+            std::unique_lock lk(q_mx_);
+            q_cv_.wait_for(lk, kGcEvery, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            if (!queue_.empty()) {
+                next = std::move(queue_.front());
+                queue_.pop_front();
+            }
+        }
+        if (!next.empty()) {
+            indexing_ = true;
+            index_segment(next);
+            indexing_ = false;
+        }
+        drop_missing();   // ротация — обычно и момент чистки по keep_segments/max_age_days
+    }
+}
+
+/* Сегменты, которых больше нет ни как .log, ни как .log.gz, удаляются из
+   индекса: номера строк за ними сдвигаются, списки слов перекодируются.
+   Новый индекс собирается под shared-блокировкой (пишет только этот
+   поток), под исключительной — только обмен. */
+void LogSearch::drop_missing() {
+    std::vector<char> alive;
+    {
+        std::shared_lock lk(mx_);
+        alive.reserve(segments_.size());
+        for (const auto& seg : segments_) {
+            std::error_code ec;
+            alive.push_back(fs::exists(seg.path, ec) || fs::exists(fs::path(seg.path).concat(".gz"), ec));
+        }
+    }
+    if (std::all_of(alive.begin(), alive.end(), [](char a) { return a != 0; })) return;
+
+    std::vector<Segment>  segments;
+    std::vector<uint32_t> line_off;
+    std::vector<int64_t>  line_ts;
+    std::unordered_map<std::string, Postings> postings;
+    std::vector<std::string> dropped;
+    {
+        std::shared_lock lk(mx_);
+        std::vector<int64_t> shift(segments_.size(), -1);   // старый номер строки → новый: id - shift
+        for (size_t i = 0; i < segments_.size(); ++i) {
+            const Segment& seg = segments_[i];
+            if (!alive[i]) {
+                dropped.push_back(seg.path.lexically_normal().string());
+                continue;
+            }
+            Segment moved = seg;
+            moved.first_line = static_cast<uint32_t>(line_off.size());
+            shift[i] = int64_t(seg.first_line) - moved.first_line;
+            line_off.insert(line_off.end(), line_off_.begin() + seg.first_line,
+                            line_off_.begin() + seg.first_line + seg.lines);
+            line_ts.insert(line_ts.end(), line_ts_.begin() + seg.first_line,
+                           line_ts_.begin() + seg.first_line + seg.lines);
+            segments.push_back(std::move(moved));
+        }
+
+        std::vector<uint32_t> ids;
+        for (const auto& [word, list] : postings_) {
+            list.decode(ids);
+            Postings* out = nullptr;
+            size_t si = 0;
+            for (uint32_t id : ids) {   // номера растут — сегмент ищется проходом вперёд
+                while (si + 1 < segments_.size() && segments_[si + 1].first_line <= id) ++si;
+                if (shift[si] < 0) continue;
+                if (!out) out = &postings[word];
+                out->add(static_cast<uint32_t>(id - shift[si]));
+            }
+        }
+    }
+
+    {
+        std::unique_lock lk(mx_);
+        segments_.swap(segments);
+        line_off_.swap(line_off);
+        line_ts_.swap(line_ts);
+        postings_.swap(postings);
+        for (const auto& key : dropped) indexed_.erase(key);
+
+        std::lock_guard lg(cache_mx_);   // ещё под mx_: поиск не застанет старый текст
+        cache_.remove_if([&](const auto& entry) {
+            return std::find(dropped.begin(), dropped.end(), entry.first) != dropped.end();
+        });
+    }
+    LOG_INFO("Из индекса логов убрано удалённых сегментов: " + std::to_string(dropped.size()), "LOGGER");
+}
+
+void LogSearch::index_segment(const fs::path& segment) {
+    fs::path path = segment;
+    if (path.extension() == ".gz") path.replace_extension();
+    const std::string key = path.lexically_normal().string();
+    {
+        std::shared_lock lk(mx_);
+        if (indexed_.count(key)) return;
+    }
+
+    std::string text;
+    if (!read_segment(path, text) || text.size() > UINT32_MAX) return;
+    const std::string lc = lowered(text);   // слова — виды в эту строку
+
+    // Сначала всё локально, под блокировкой только слияние
+    std::vector<uint32_t> offs;
+    std::vector<int64_t>  ts;
+    std::unordered_map<std::string_view, std::vector<uint32_t>> words;
+    TsParser parse_ts;
+    int64_t  cur_ts = 0;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (stop_) return;
+        const std::string_view line = line_at(text, pos);
+        if (!line.empty()) {
+            const uint32_t n = static_cast<uint32_t>(offs.size());
+            if (const int64_t t = parse_ts(line)) cur_ts = t;   // продолжение строки — время предыдущей
+            offs.push_back(static_cast<uint32_t>(pos));
+            ts.push_back(cur_ts);
+            for_each_word(std::string_view(lc).substr(pos, line.size()), [&](std::string_view w) {
+                auto& v = words[w];
+                if (v.empty() || v.back() != n) v.push_back(n);
+            });
+        }
+        const size_t eol = text.find('\n', pos);
+        pos = eol == std::string::npos ? text.size() : eol + 1;
+    }
+
+    Segment seg;
+    seg.path    = path;
+    seg.session = path.parent_path().filename().string();
+    seg.lines   = static_cast<uint32_t>(offs.size());
+
+    std::unique_lock lk(mx_);
+    if (!indexed_.insert(key).second) return;
+    if (line_off_.size() + offs.size() > UINT32_MAX) return;
+
+    seg.first_line = static_cast<uint32_t>(line_off_.size());
+    line_off_.insert(line_off_.end(), offs.begin(), offs.end());
+    line_ts_.insert(line_ts_.end(), ts.begin(), ts.end());
+    for (const auto& [w, lines] : words) {
+        auto& p = postings_[std::string(w)];
+        for (uint32_t n : lines) p.add(seg.first_line + n);
+    }
+    segments_.push_back(std::move(seg));
+}
+
+std::shared_ptr<const std::string> LogSearch::load(uint32_t seg) {
+    const fs::path& path = segments_[seg].path;
+    std::string key = path.lexically_normal().string();
+    {
+        std::lock_guard lg(cache_mx_);
+        for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+            if (it->first != key) continue;
+            cache_.splice(cache_.begin(), cache_, it);
+            return it->second;
+        }
+    }
+
+    auto text = std::make_shared<std::string>();
+    if (!read_segment(path, *text)) text->clear();   // удалён чисткой — пусто
+
+    std::lock_guard lg(cache_mx_);
+    cache_.emplace_front(std::move(key), text);
+    if (cache_.size() > cache_limit_) cache_.pop_back();
+    return text;
+}
+
+/* ------------------------------------------------------------------ */
+/*                               Поиск                                */
+/* ------------------------------------------------------------------ */
+nlohmann::json LogSearch::search(const std::string& q, int64_t from_us, int64_t to_us,
+                                 size_t limit, const std::string& cursor)
+{
+    const auto terms = parse_terms(q);
+    std::vector<std::string> words;
+    for (const auto& t : terms) {
+        for_each_word(t, [&](std::string_view w) {
+            if (std::find(words.begin(), words.end(), w) == words.end()) words.emplace_back(w);
+        });
+    }
+    if (words.empty()) throw std::invalid_argument("q: нужно хотя бы одно слово от 2 символов");
+
+    const bool    ranged = from_us != INT64_MIN || to_us != INT64_MAX;
+    const int64_t from_s = from_us == INT64_MIN ? INT64_MIN : from_us / 1000000;
+    const int64_t to_s   = to_us   == INT64_MAX ? INT64_MAX : to_us / 1000000;
+    auto in_range = [&](int64_t ts) { return !ranged || (ts && ts >= from_s && ts <= to_s); };
+
+    // Курсор: "L:<смещение>" — текущий файл, "A:<строка>" — архив; всё строго раньше
+    char     phase = 'L';
+    uint64_t until = UINT64_MAX;
+    if (!cursor.empty()) {
+        if (cursor.size() < 3 || cursor[1] != ':' || (cursor[0] != 'L' && cursor[0] != 'A')) {
+            throw std::invalid_argument("cursor");
+        }
+        phase = cursor[0];
+        until = std::stoull(cursor.substr(2));
+    }
+
+    nlohmann::json results = nlohmann::json::array();
+    std::string next;
+    auto matches = [&](std::string_view line) {
+        const std::string lc = lowered(line);
+        return std::all_of(terms.begin(), terms.end(), [&](const std::string& t) { return has_term(lc, t); });
+    };
+    auto emit = [&](std::string_view line, int64_t ts, const std::string& session, const std::string& segment) {
+        results.push_back({ {"ts", ts}, {"session", session}, {"segment", segment}, {"line", std::string(line)} });
+    };
+
+    /* ---------- Текущий файл: просмотр с конца, окном до until ---------- */
+    if (phase == 'L') {
+        std::string text;
+        uint64_t base = 0;        // смещение text в файле
+        size_t   limit_pos = 0;   // строки text, начатые до until
+        std::ifstream in(live_, std::ios::binary);
+        if (in) {
+            in.seekg(0, std::ios::end);
+            const uint64_t size = static_cast<uint64_t>(in.tellg());
+            const uint64_t end  = std::min<uint64_t>(size, until);   // строки, начатые до end
+            base = end > kLiveWindow ? end - kLiveWindow : 0;
+            // Строка на границе until дочитывается целиком
+            text.resize(static_cast<size_t>(std::min<uint64_t>(size, end + 64 * 1024) - base));
+            in.seekg(static_cast<std::streamoff>(base));
+            in.read(text.data(), static_cast<std::streamsize>(text.size()));
+            text.resize(static_cast<size_t>(in.gcount()));
+            if (base > 0) {   // окно начинается посреди строки — её доберёт следующий запрос
+                const size_t eol = text.find('\n');
+                const size_t skip = eol == std::string::npos ? text.size() : eol + 1;
+                text.erase(0, skip);
+                base += skip;
+            }
+            limit_pos = end > base ? static_cast<size_t>(end - base) : 0;
+        }
+
+        struct Line { size_t off; int64_t ts; };
+        std::vector<Line> lines;
+        TsParser parse_ts;
+        int64_t  cur_ts = 0;
+        for (size_t pos = 0; pos < text.size() && pos < limit_pos; ) {
+            const std::string_view line = line_at(text, pos);
+            if (const int64_t t = parse_ts(line)) cur_ts = t;
+            if (!line.empty()) lines.push_back({ pos, cur_ts });
+            const size_t eol = text.find('\n', pos);
+            pos = eol == std::string::npos ? text.size() : eol + 1;
+        }
+
+        for (auto it = lines.rbegin(); it != lines.rend(); ++it) {
+            if (!in_range(it->ts)) continue;
+            const std::string_view line = line_at(text, it->off);
+            if (!matches(line)) continue;
+            if (results.size() >= limit) { next = "L:" + std::to_string(base + it->off + 1); break; }
+            emit(line, it->ts, "", live_.filename().string());
+        }
+        if (next.empty() && base > 0) next = "L:" + std::to_string(base);   // начало файла — следующим запросом
+        until = UINT64_MAX;
+    }
+
+    /* ---------- Архив: пересечение списков, проверка кандидатов с конца ---------- */
+    std::shared_lock lk(mx_);
+    if (next.empty()) {
+        std::sort(words.begin(), words.end(), [&](const std::string& a, const std::string& b) {
+            auto ia = postings_.find(a), ib = postings_.find(b);
+            return (ia == postings_.end() ? 0 : ia->second.count) < (ib == postings_.end() ? 0 : ib->second.count);
+        });
+
+        std::vector<uint32_t> cand, other, merged;
+        for (size_t i = 0; i < words.size(); ++i) {
+            auto it = postings_.find(words[i]);
+            if (it == postings_.end()) { cand.clear(); break; }
+            if (i == 0) { it->second.decode(cand); continue; }
+            it->second.decode(other);
+            merged.clear();
+            std::set_intersection(cand.begin(), cand.end(), other.begin(), other.end(), std::back_inserter(merged));
+            cand.swap(merged);
+            if (cand.empty()) break;
+        }
+
+        auto end = std::lower_bound(cand.begin(), cand.end(),
+                                    until > UINT32_MAX ? uint64_t(UINT32_MAX) + 1 : until);
+        size_t checks = 0;
+        for (auto it = std::make_reverse_iterator(end); it != cand.rend(); ++it) {
+            const uint32_t id = *it;
+            if (!in_range(line_ts_[id])) continue;
+            if (++checks > kMaxChecks) { next = "A:" + std::to_string(uint64_t(id) + 1); break; }
+
+            const auto sit = std::upper_bound(segments_.begin(), segments_.end(), id,
+                [](uint32_t v, const Segment& s) { return v < s.first_line; }) - 1;
+            const auto text = load(static_cast<uint32_t>(sit - segments_.begin()));
+            if (text->empty() || line_off_[id] >= text->size()) continue;
+
+            const std::string_view line = line_at(*text, line_off_[id]);
+            if (!matches(line)) continue;
+            if (results.size() >= limit) { next = "A:" + std::to_string(uint64_t(id) + 1); break; }
+            emit(line, line_ts_[id], sit->session, sit->path.filename().string());
+        }
+    }
+
+    return {
+        {"results",  results},
+        {"next",     next.empty() ? nlohmann::json(nullptr) : nlohmann::json(next)},
+        {"indexing", indexing_.load()},
+        {"segments", segments_.size()},
+        {"lines",    line_off_.size()}
+    };
+}
@@ -4,11 +4,13 @@ g++ ./main.cpp ./MinecraftServerManager.cpp ./httpServer.cpp -o ../bin/mshost -l
 */
 
 #include <thread>
+#include <ctime>
 #include <atomic>
 #include <string>
 #include <algorithm>
 #include <csignal>
 #include <fstream>
+#include <sstream>
 #include "./includes/json.hpp"
 
 #ifdef _WIN32
@@ -25,7 +27,11 @@ g++ ./main.cpp ./MinecraftServerManager.cpp ./httpServer.cpp -o ../bin/mshost -l
 #include <unistd.h>
 #endif
 
-#include "./includes/minecraftservermanager.h"
+#include "./includes/serverregistry.h"
+#include "./includes/processlimits.h"
+#include "./includes/filewatcher.h"
+#include "./includes/logsearch.h"
+#include "./includes/scheduler.h"
 #include "./includes/httpServer.h"
 #include "./includes/logger.h"
 
@@ -35,7 +41,7 @@ using json = nlohmann::json;
 std::atomic<bool> running(true);
 const std::string Version = "0.4.0.134a";
 
-static MinecraftServerManager* g_mc   = nullptr; // для сигнал‑хендлеров
+static ServerRegistry*      g_servers = nullptr; // для сигнал‑хендлеров
 static HttpServer*          g_http = nullptr;
 static std::thread          g_webThread;   // поток веб‑сервера
 static std::atomic<bool>    webRunning{false};
@@ -45,12 +51,16 @@ void request_shutdown(const char* why) {
     if (!running.exchange(false)) return; // уже в процессе
     LOG_INFO(std::string("Получен сигнал завершения ( ") + why + " )", "SHUTDOWN");
 
+    // Сначала расписание: задача в работе доходит до конца, новые не стартуют
+    // и не поднимут инстанс, который stop_all() уже остановил
+    Scheduler::instance().shutdown();
+
     if (webRunning) {
         g_http->stop();
         if (g_webThread.joinable()) g_webThread.join();
         webRunning = false;
     }
-    if (g_mc)   g_mc->stop();
+    if (g_servers) g_servers->stop_all();
 
 #ifdef _WIN32
     // Разблокируем ReadConsole у input‑потока
@@ -83,8 +93,9 @@ BOOL WINAPI ConsoleHandler(DWORD sig)
 #endif
 
 // ────────────────────────── CLI Поток ───────────────────────────
-void handle_input(MinecraftServerManager& manager, HttpServer& http) {
+void handle_input(ServerRegistry& servers, HttpServer& http) {
     std::string command;
+    MinecraftServerManager* selected = &servers.primary();   // инстанс для server-* и "/команд"
     while (running) {
 #ifdef _WIN32
         std::wstring wcmd;
@@ -95,9 +106,26 @@ void handle_input(MinecraftServerManager& manager, HttpServer& http) {
         if (!std::getline(std::cin, command)) { request_shutdown("stdin EOF"); break; }
 #endif
         if (command.empty()) continue;
+        MinecraftServerManager& manager = *selected;
 
         // === команды ===
-        if (command == "server-start") {
+        if (command == "server-list") {
+            for (const auto& mc : servers.all()) {
+                std::wcout << (mc.get() == selected ? L"* " : L"  ")
+                           << std::wstring(mc->id().begin(), mc->id().end())
+                           << L" : " << mc->get_status() << std::endl;
+            }
+        }
+        else if (command.rfind("server-select ", 0) == 0) {
+            std::string id = command.substr(14);
+            if (auto* mc = servers.find(id)) {
+                selected = mc;
+                LOG_INFO("Выбран инстанс: " + id, "INPUT");
+            } else {
+                LOG_ERR("Нет инстанса с id: " + id, "INPUT");
+            }
+        }
+        else if (command == "server-start") {
             LOG_INFO("Инициализация запуска сервера...", "INPUT");
             manager.start();
         } 
@@ -107,9 +135,100 @@ void handle_input(MinecraftServerManager& manager, HttpServer& http) {
         } 
         else if (command == "server-restart") {
             LOG_INFO("Получена команда перезапуска сервера...", "INPUT");
-            manager.stop();
-            manager.start();
+            manager.restart();
         } 
+        else if (command == "server-backup" || command == "server-backup full") {
+            try {
+                manager.backup(command.size() > 13);
+            } catch (const std::exception& e) {
+                LOG_ERR(std::string("Снимок не создан: ") + e.what(), "INPUT");
+            }
+        }
+        else if (command == "server-backups") {
+            for (const auto& b : manager.backups()) {
+                const std::string name = b["name"].get<std::string>(), kind = b["kind"].get<std::string>();
+                std::wcout << std::wstring(name.begin(), name.end()) << L"  "
+                           << std::wstring(kind.begin(), kind.end())
+                           << L"  файлов: " << b["files"].get<size_t>() << std::endl;
+            }
+        }
+        else if (command == "server-players") {
+            const json list = manager.players();
+            for (const auto& p : list["online"]) {
+                const std::string name = p["name"].get<std::string>();
+                std::wcout << std::wstring(name.begin(), name.end())
+                           << L"  в игре " << p["session_s"].get<int64_t>() / 60 << L" мин" << std::endl;
+            }
+            std::wcout << L"Онлайн: " << list["count"].get<size_t>() << L", известно: "
+                       << list["known"].get<size_t>() << std::endl;
+        }
+        else if (command == "schedule") {
+            const json sched = Scheduler::instance().to_json();
+            if (!sched["enabled"].get<bool>()) {
+                LOG_WARNING("Планировщик выключен (scheduler.enabled)", "INPUT");
+            }
+            for (const auto& t : sched["tasks"]) {
+                const std::string name = t["name"].get<std::string>(), action = t["action"].get<std::string>();
+                std::wcout << std::wstring(name.begin(), name.end()) << L"  "
+                           << std::wstring(action.begin(), action.end()) << L"  ";
+                if (t.contains("cron")) {
+                    const std::string cron = t["cron"].get<std::string>();
+                    std::wcout << std::wstring(cron.begin(), cron.end());
+                } else {
+                    std::wcout << L"разовая, " << t["delay_s"].get<int64_t>() << L" с";
+                }
+                if (t["next"].is_null()) {
+                    std::wcout << L"  не запланирована" << std::endl;
+                } else {
+                    std::wcout << L"  через " << (t["next"].get<int64_t>() - std::time(nullptr)) / 60 << L" мин" << std::endl;
+                }
+            }
+        }
+        else if (command.rfind("server-restore ", 0) == 0) {
+            // server-restore <снимок> [путь ...]
+            std::istringstream args(command.substr(15));
+            std::string name, path;
+            std::vector<std::string> paths;
+            args >> name;
+            while (args >> path) paths.push_back(path);
+            try {
+                manager.restore(name, paths);
+            } catch (const std::exception& e) {
+                LOG_ERR(std::string("Восстановление не выполнено: ") + e.what(), "INPUT");
+            }
+        }
+        else if (command.rfind("server-prune ", 0) == 0) {
+            // server-prune inhabited_below=1200 radius=5000 center=0,0 before=2025-01-01 dimensions=a,b [dry]
+            std::istringstream args(command.substr(13));
+            json body = json::object();
+            std::string arg;
+            try {
+                while (args >> arg) {
+                    const size_t eq = arg.find('=');
+                    if (eq == std::string::npos) {
+                        if (arg == "dry" || arg == "dry_run") body["dry_run"] = true;
+                        else throw std::invalid_argument("непонятный аргумент: " + arg);
+                        continue;
+                    }
+                    const std::string key = arg.substr(0, eq), value = arg.substr(eq + 1);
+                    if (key == "center") {
+                        const size_t comma = value.find(',');
+                        if (comma == std::string::npos) throw std::invalid_argument("center=x,z");
+                        body["center"] = { std::stoll(value.substr(0, comma)), std::stoll(value.substr(comma + 1)) };
+                    } else if (key == "dimensions") {
+                        std::istringstream list(value);
+                        for (std::string d; std::getline(list, d, ','); ) body["dimensions"].push_back(d);
+                    } else if (key == "before" && value.find('-') != std::string::npos) {
+                        body["before"] = value;
+                    } else {
+                        body[key] = std::stoll(value);
+                    }
+                }
+                manager.prune(PruneOptions::from_json(body));
+            } catch (const std::exception& e) {
+                LOG_ERR(std::string("Прореживание не выполнено: ") + e.what(), "INPUT");
+            }
+        }
         else if (command == "web-start") {
             if (!webRunning) {
                 webRunning = true;
@@ -167,10 +286,18 @@ void handle_input(MinecraftServerManager& manager, HttpServer& http) {
                        << L"\"server-start/stop\" : Останавливает запущенный Minecraft Server\n"
                        << L"\"server-restart\" : Перезапускает Minecraft Server\n"
                        << L"\"server-status\" : Выводит статус сервера\n"
+                       << L"\"server-backup [full]\" : Снимок мира без остановки сервера\n"
+                       << L"\"server-backups\" : Список снимков мира\n"
+                       << L"\"server-restore <снимок> [путь ...]\" : Восстановление мира или его частей (сервер остановлен)\n"
+                       << L"\"server-prune условие=значение ... [dry]\" : Удаление чанков мира (сервер остановлен)\n"
+                       << L"\"server-players\" : Игроки онлайн\n"
+                       << L"\"schedule\" : Задачи планировщика и их ближайший запуск\n"
+                       << L"\"server-list\" : Список инстансов (* — выбранный)\n"
+                       << L"\"server-select <id>\" : Выбирает инстанс для server-* и /команд\n"
                        << L"\"web-start\" : Запускает Web Server\n"
                        << L"\"web-stop\" : Останавливает запущенный Web Server\n"
                        << L"\"web-restart\" : Перезапускает Web Server\n"
-                       << L"\"web-updatetokens\" : перечитывает файл токенов\n"
+                       << L"\"web-updatetokens\" : перечитывает файл токенов (обычно не нужно — правки подхватываются сами)\n"
                        << L"\"exit\" : Останавливает ВСЕ и завершает программу\n"
                        << L"\"help\" : Выводит список команд\n"
                        << L"\"prank <игрок>\" : Наносит психоурон игроку)))\n"
@@ -284,32 +411,123 @@ int main(int argc, char* argv[])
             return 1;
         }
 
+        // Уровни логирования: общий и по модулям
+        if (config.contains("logging")) {
+            try {
+                Logger::instance().configure(config["logging"]);
+            } catch (const std::exception& e) {
+                LOG_WARNING(std::string("Уровни логирования не применены: ") + e.what(), "MAIN");
+            }
+        }
+
+        // Ротация server.log/web.log, сжатие и чистка архива
+        if (config.contains("logging") && config["logging"].contains("rotation")) {
+            const auto& rt = config["logging"]["rotation"];
+            LogRotation rot;
+            rot.max_bytes     = rt.value("max_mb", uint64_t(0)) << 20;
+            rot.interval_h    = rt.value("interval_h", 0);
+            rot.compress      = rt.value("compress", true);
+            rot.keep_segments = rt.value("keep_segments", size_t(0));
+            rot.max_age_days  = rt.value("max_age_days", 0);
+            Logger::instance().setRotation(rot);
+            if (rot.compress && !LogRotator::compression_available()) {
+                LOG_WARNING("Сборка без zlib: сегменты лога не сжимаются", "MAIN");
+            }
+        }
+
+        // Поиск по архиву логов (/api/logs/search): индекс строится в фоне
+        if (config.contains("logging") && config["logging"].contains("search")) {
+            const auto& sr = config["logging"]["search"];
+            if (sr.value("enabled", false)) {
+                LogSearch::instance().start("../logs", "server.log", sr.value("cache_segments", size_t(4)));
+                Logger::instance().setArchiveHook([](const fs::path& segment) {
+                    LogSearch::instance().submit(segment);
+                });
+            }
+        }
+
+        // Двоичные сегменты лога с индексом по времени (/api/logs/query)
+        if (config.contains("logging") && config["logging"].contains("structured")) {
+            const auto& st = config["logging"]["structured"];
+            if (st.value("enabled", false)) {
+                Logger::instance().enableStructured(
+                    st.value("dir", std::string("../logs/structured")),
+                    st.value("segment_mb", uint64_t(64)) << 20,
+                    st.value("index_every", uint32_t(256)),
+                    st.value("keep_segments", size_t(0)),
+                    st.value("max_age_days", 0));
+                LOG_INFO("Структурированный лог включён", "MAIN");
+            }
+        }
+
+        // Служебные ядра для самого mshost: веб, логгер, ProcessHub не
+        // отнимают время у тик-потока JVM (её ядра задаёт "launch" инстанса)
+        if (config.contains("host") && config["host"].contains("housekeeping_cpus")) {
+            const auto cpus = config["host"]["housekeeping_cpus"].get<std::string>();
+            if (proclimits::pin_current_process(proclimits::parse_cpu_list(cpus))) {
+                LOG_INFO("mshost закреплён на ядрах: " + cpus, "MAIN");
+            } else {
+                LOG_WARNING("Не удалось закрепить mshost на ядрах: " + cpus, "MAIN");
+            }
+        }
+
         LOG_INFO("Инициализация серверов...", "MAIN");
-        MinecraftServerManager mcserver(config);
+        ServerRegistry servers(config);
+        Scheduler::instance().start(config.value("scheduler", json::object()), servers);
 
         HttpServer http(
-            mcserver, 
+            servers, 
             config["web"]["port"].get<std::int16_t>(),
             running,
             config["web"]["tokens_file"].get<std::string>(),
             config["web"]["logs_path"].get<std::string>(),
             config["web"]["modpack_path"].get<std::string>(),
             config["web"]["web_root"].get<std::string>(),
-            config["web"]["upload_limit"].get<std::int16_t>()
+            config["web"]["upload_limit"].get<std::int16_t>(),
+            config["web"].value("session_secret", ""),
+            config["web"].value("session_ttl_s", 3600),
+            config["web"].value("allow_raw_token", true)
         );
+        http.configure(config["web"]);
 
-        g_mc   = &mcserver;
-        g_http = &http;
+        g_servers = &servers;
+        g_http    = &http;
+
+        // Правки config.json подхватываются на лету (файл токенов HttpServer сторожит сам)
+        const int config_watch = FileWatcher::instance().watch("config.json", [&servers, &http] {
+            json fresh;
+            try {
+                std::ifstream f("config.json");
+                fresh = json::parse(f);
+                servers.reload(fresh);
+                Scheduler::instance().reload(fresh.value("scheduler", json::object()));
+            } catch (const std::exception& e) {
+                LOG_ERR(std::string("config.json не применён: ") + e.what(), "MAIN");
+                return;
+            }
+            if (fresh.contains("logging")) {
+                try {
+                    Logger::instance().configure(fresh["logging"]);
+                } catch (const std::exception& e) {
+                    LOG_WARNING(std::string("Уровни логирования не применены: ") + e.what(), "MAIN");
+                }
+            }
+            if (fresh.contains("web") && fresh["web"].contains("tokens_file")) {
+                http.set_tokens_file(fresh["web"]["tokens_file"].get<std::string>());
+            }
+        });
         LOG_INFO("Успешно!", "MAIN");
 
         std::wcout << L"\nСписок доступных команд:\n"
             << L"\"server-start/stop\" : Останавливает запущенный Minecraft Server\n"
             << L"\"server-restart\" : Перезапускает Minecraft Server\n"
             << L"\"server-status\" : Выводит статус сервера\n"
+            << L"\"server-list\" : Список инстансов (* — выбранный)\n"
+            << L"\"server-select <id>\" : Выбирает инстанс для server-* и /команд\n"
             << L"\"web-start\" : Запускает Web Server\n"
             << L"\"web-stop\" : Останавливает запущенный Web Server\n"
             << L"\"web-restart\" : Перезапускает Web Server\n"
-            << L"\"web-updatetokens\" : перечитывает файл токенов\n"
+            << L"\"web-updatetokens\" : перечитывает файл токенов (обычно не нужно — правки подхватываются сами)\n"
             << L"\"exit\" : Останавливает ВСЕ и завершает программу\n"
             << L"\"help\" : Выводит список команд\n"
             << L"\"prank <игрок>\" : Наносит психоурон игроку)))\n"
@@ -322,14 +540,17 @@ int main(int argc, char* argv[])
             LOG_INFO("HTTP запущен по флагу", "MAIN");
         }
         if (flagMc) {
-            mcserver.start();
+            for (const auto& mc : servers.all()) mc->start();
         }
         LOG_INFO("Запуск потоков...", "MAIN");
-        std::thread input_thread(handle_input, std::ref(mcserver), std::ref(http));
+        std::thread input_thread(handle_input, std::ref(servers), std::ref(http));
         LOG_INFO("Успешно!", "MAIN");      
 
         input_thread.join();
+        Scheduler::instance().shutdown();
         if (g_webThread.joinable()) g_webThread.join();
+        FileWatcher::instance().unwatch(config_watch);
+        LogSearch::instance().shutdown();
 
         LOG_INFO("Программа завершена", "MAIN");
         Logger::instance().finalize();
@@ -1,14 +1,57 @@
 #include "./includes/minecraftservermanager.h"
+#include "./includes/processhub.h"
+#include "./includes/processlimits.h"
+#include "./includes/metrics.h"
 #include "./includes/logger.h"
+#include "./includes/clonebackup.h"
+#include "./includes/restore.h"
+#include "./includes/regionscan.h"
 
 #include <iostream>
 #include <vector>
 #include <numeric>
+#include <utility>
+#include <ctime>
+
+namespace {
+/* Захват backup_busy_: запуск, снимок, восстановление и прореживание
+   не пересекаются. Флаг снимается при любом выходе из области.       */
+class WorldBusy {
+public:
+    explicit WorldBusy(std::atomic<bool>& flag) : flag_(flag), owned_(!flag.exchange(true)) {}
+    ~WorldBusy() { if (owned_) flag_ = false; }
+    WorldBusy(const WorldBusy&) = delete;
+    WorldBusy& operator=(const WorldBusy&) = delete;
+
+    explicit operator bool() const { return owned_; }
+
+private:
+    std::atomic<bool>& flag_;
+    const bool         owned_;
+};
+
+/* Текст сообщения самого сервера: "[12:00:00] [Server thread/INFO] [логгер]: текст".
+   Чат печатается тем же потоком, но как "<ник> текст", поэтому события
+   сравниваются с текстом целиком, а не ищутся подстрокой. Пусто — не сервер */
+std::string server_message(const std::string& line) {
+    const size_t p = line.find("]: ");
+    if (p == std::string::npos || line.rfind("[Server thread/", p) == std::string::npos) return {};
+    return line.substr(p + 3);
+}
+
+constexpr const char* kWorldBusy = "мир занят: идёт запуск, снимок, восстановление или прореживание";
+} // namespace
 
-MinecraftServerManager::MinecraftServerManager(const json& config_data) {
+MinecraftServerManager::MinecraftServerManager(const json& config_data, std::string id)
+    : id_(std::move(id)),
+      mod_(id_ == "main" ? "MC" : "MC:" + id_),
+      out_mod_(id_ == "main" ? "MC_OUT" : "MC_OUT:" + id_),
+      lines_metric_(Metrics::instance().counter("mc." + id_ + ".lines"))
+{
     try {
         ZeroMemory(&procInfo_, sizeof(procInfo_));
         load_config(config_data);
+        players_.open(config_.players, id_);
     } catch (const std::exception& e) {
         LOG_CRITICAL(std::string("Ошибка инициализации: ") + e.what(), "MC_INIT");
         throw;
@@ -16,6 +59,7 @@ MinecraftServerManager::MinecraftServerManager(const json& config_data) {
 }
 
 MinecraftServerManager::~MinecraftServerManager() {
+    discard_standby();
     stop();
 
     /*rcon_connecting_ = false;
@@ -24,26 +68,23 @@ MinecraftServerManager::~MinecraftServerManager() {
     }
     rcon_.disconnect();*/
 
-    if (procInfo_.hProcess) {
-        CloseHandle(procInfo_.hProcess);
-        procInfo_.hProcess = nullptr;
-    }
-    if (procInfo_.hThread) {
-        CloseHandle(procInfo_.hThread);
-        procInfo_.hThread = nullptr;
-    }
-    if (stdinPipe_) {
-        CloseHandle(stdinPipe_);
-        stdinPipe_ = nullptr;
-    }
-    if (readPipe_) {
-        CloseHandle(readPipe_);
-        readPipe_ = nullptr;
-    }
+    ProcessHub::instance().detach(hub_id_);
+    close_process_handles();
+    if (job_) CloseHandle(job_);
 }
 
-std::string quote(const std::string& str) {
-    return "\"" + str + "\"";
+/* level-name из server.properties (по умолчанию "world") */
+static std::string read_level_name(const std::string& server_dir) {
+    std::ifstream props(fs::path(server_dir) / "server.properties");
+    std::string line;
+    while (std::getline(props, line)) {
+        if (line.rfind("level-name=", 0) == 0) {
+            std::string name = line.substr(11);
+            name.erase(name.find_last_not_of(" \t\r") + 1);
+            if (!name.empty()) return name;
+        }
+    }
+    return "world";
 }
 
 void MinecraftServerManager::load_config(json data) {
@@ -59,13 +100,39 @@ void MinecraftServerManager::load_config(json data) {
         // Загрузка параметров с проверкой
         config_.java_path = data["java"]["path"].get<std::string>();
         config_.server_dir = data["server"]["directory"].get<std::string>();
-        config_.forge_args = data["server"]["forge_args"].get<std::string>();
 
-        // Обработка JVM аргументов
-        if (data["java"].contains("jvm_args") && data["java"]["jvm_args"].is_array()) {
-            for (const auto& arg : data["java"]["jvm_args"]) {
-                config_.jvm_args_vec.push_back(arg.get<std::string>());
-            }
+        // Таймауты поэтапной остановки
+        const auto& srv = data["server"];
+        config_.shutdown.countdown_s           = srv.value("stop_countdown_s",      config_.shutdown.countdown_s);
+        config_.shutdown.save_timeout_ms       = srv.value("save_timeout_ms",       config_.shutdown.save_timeout_ms);
+        config_.shutdown.stop_timeout_ms       = srv.value("stop_timeout_ms",       config_.shutdown.stop_timeout_ms);
+        config_.shutdown.force_kill_timeout_ms = srv.value("force_kill_timeout_ms", config_.shutdown.force_kill_timeout_ms);
+
+        // Быстрый перезапуск через тёплый резерв
+        if (srv.contains("fast_restart")) {
+            const auto& fr = srv["fast_restart"];
+            config_.fast_restart.enabled            = fr.value("enabled",            config_.fast_restart.enabled);
+            config_.fast_restart.gate_pattern       = fr.value("gate_pattern",       config_.fast_restart.gate_pattern);
+            config_.fast_restart.standby_timeout_ms = fr.value("standby_timeout_ms", config_.fast_restart.standby_timeout_ms);
+            config_.fast_restart.lock_timeout_ms    = fr.value("lock_timeout_ms",    config_.fast_restart.lock_timeout_ms);
+        }
+        config_.level_name = read_level_name(config_.server_dir);
+
+        // Размещение JVM: ядра, NUMA, приоритеты, Job Object
+        if (srv.contains("launch")) config_.launch = LaunchPolicy::from_json(srv["launch"]);
+
+        // Инкрементальные снимки мира
+        if (srv.contains("backup")) config_.backup = BackupOptions::from_json(srv["backup"]);
+
+        // Индекс игроков; dir читается только при создании инстанса
+        if (srv.contains("players")) config_.players = PlayerTrackerOptions::from_json(srv["players"]);
+
+        // То, что панель показывает игрокам
+        if (srv.contains("display")) {
+            const auto& d = srv["display"];
+            config_.display.ip      = d.value("ip",      config_.display.ip);
+            config_.display.port    = d.value("port",    config_.display.port);
+            config_.display.version = d.value("version", config_.display.version);
         }
 
         // Валидация конфигурации
@@ -92,18 +159,10 @@ void MinecraftServerManager::load_config(json data) {
             }
         }*/
 
-        // Собираем команду запуска
-        std::ostringstream oss;
-        oss << quote(config_.java_path) << " ";
+        // argv собирается при каждом запуске: argfile-ы могли поменяться
+        launch_spec_.emplace(LaunchSpec::options_from_json(data["java"], data["server"]));
 
-        for (const auto& arg : config_.jvm_args_vec)
-            oss << arg << " ";
-
-        oss << quote(config_.forge_args) << " nogui";
-
-        config_.full_command = oss.str();
-
-        LOG_INFO("Конфигурация успешно загружена: "+ config_.full_command, "CONFIG");
+        LOG_INFO("Конфигурация успешно загружена: " + config_.server_dir, "CONFIG");
     } catch (const json::exception& e) {
         throw std::runtime_error("Ошибка JSON: " + std::string(e.what()));
     } catch (const std::exception& e) {
@@ -111,6 +170,33 @@ void MinecraftServerManager::load_config(json data) {
     }
 }
 
+/* ---------- Перечитанный config.json ---------- */
+void MinecraftServerManager::reload_config(const json& config_data) {
+    // Применяем только в start()/launch_standby(): конфиг читают без блокировок
+    std::lock_guard lg(config_mx_);
+    pending_config_ = config_data;
+    LOG_INFO("Новая конфигурация применится при следующем запуске", mod_);
+}
+
+void MinecraftServerManager::apply_pending_config() {
+    std::lock_guard lg(config_mx_);
+    if (!pending_config_) return;
+
+    json data = std::move(*pending_config_);
+    pending_config_.reset();
+
+    // Поля, которых нет в новом конфиге, возвращаются к умолчаниям
+    Config previous = config_;
+    config_ = Config{};
+    try {
+        load_config(std::move(data));
+        LOG_INFO("Конфигурация инстанса обновлена", mod_);
+    } catch (const std::exception& e) {
+        config_ = previous;
+        LOG_ERR(std::string("Новая конфигурация отклонена: ") + e.what(), mod_);
+    }
+}
+
 /* ---------- Получение текстовой расшифровки Win32-ошибки ---------- */
 std::string MinecraftServerManager::get_last_error_message(DWORD err) {
     LPSTR buf = nullptr;
@@ -130,6 +216,14 @@ std::string MinecraftServerManager::get_last_error_message(DWORD err) {
     return msg;
 }
 
+/* ---------- Закрытие хендлов процесса (после join потоков!) ---------- */
+void MinecraftServerManager::close_process_handles() {
+    if (procInfo_.hProcess) { CloseHandle(procInfo_.hProcess); procInfo_.hProcess = nullptr; }
+    if (procInfo_.hThread)  { CloseHandle(procInfo_.hThread);  procInfo_.hThread  = nullptr; }
+    if (stdinPipe_)         { CloseHandle(stdinPipe_);         stdinPipe_         = nullptr; }
+    if (readPipe_)          { CloseHandle(readPipe_);          readPipe_          = nullptr; }
+}
+
 /*
 void MinecraftServerManager::setup_rcon() {
     if (!config_.rcon.enabled || config_.rcon.password.empty()) {
@@ -187,11 +281,11 @@ void MinecraftServerManager::check_server_ready_via_rcon() {
         if (!response.empty()) {
             ready_ = true;
             status_ = ServerStatus::Running;
-            LOG_INFO("Сервер полностью запущен (подтверждено через RCON)!", "MC");
-            LOG_INFO("Ответ сервера: " + response, "MC");
+            LOG_INFO("Сервер полностью запущен (подтверждено через RCON)!", mod_);
+            LOG_INFO("Ответ сервера: " + response, mod_);
         }
     } catch (const std::exception& e) {
-        LOG_WARNING("Ошибка проверки готовности через RCON: " + std::string(e.what()), "MC");
+        LOG_WARNING("Ошибка проверки готовности через RCON: " + std::string(e.what()), mod_);
     }
 }
 */
@@ -201,25 +295,77 @@ void MinecraftServerManager::check_server_ready_via_rcon() {
 /* ------------------------------------------------------------------ */
 void MinecraftServerManager::start() {
     if (running_) {
-        LOG_WARNING("Сервер уже запущен.", "MC");
+        LOG_WARNING("Сервер уже запущен.", mod_);
+        return;
+    }
+    WorldBusy busy(backup_busy_);   // до конца запуска: restore/prune не начнутся
+    if (!busy) {
+        LOG_WARNING("Идёт снимок, восстановление или прореживание мира — запуск отменён.", mod_);
         return;
     }
 
-    // safety‑net, если кто‑то вызвал start() без stop()
-    if (output_thread_.joinable())          output_thread_.join();
-    if (process_monitor_thread_.joinable()) process_monitor_thread_.join();
+    reset_primary();
+    apply_pending_config();
+
+    status_ = ServerStatus::Starting;
+    LOG_INFO("Запуск Minecraft‑сервера...", mod_);
+
+    if (!spawn_process(stdinPipe_, readPipe_, procInfo_, job_)) {
+        status_ = ServerStatus::Stopped;
+        running_ = false;
+        ready_ = false;
+        return;
+    }
 
-    output_thread_          = std::thread();
-    process_monitor_thread_ = std::thread();
+    if (!attach_primary()) return;
+    LOG_INFO("Процесс сервера запущен успешно", mod_);
+}
+
+/* ---------- Подготовка основного слота к новому процессу ---------- */
+void MinecraftServerManager::reset_primary() {
+    // safety‑net, если кто‑то вызвал start() без stop()
+    ProcessHub::instance().detach(hub_id_);
+    hub_id_ = 0;
 
-    /* Сбрасываем procInfo_ на случай повторного запуска */
+    /* Хендлы прошлого запуска (если процесс умер сам) и сброс procInfo_ */
+    close_process_handles();
     ZeroMemory(&procInfo_, sizeof(procInfo_));
+    {
+        std::lock_guard lg(events_mx_);
+        save_confirmed_ = false;
+        exited_         = false;
+    }
+}
 
-    status_ = ServerStatus::Starting;
-    LOG_INFO("Запуск Minecraft‑сервера...", "MC");
+/* ---------- Процесс уже создан: подписываем его на общий цикл ----------
+   Без подписки некому читать вывод и заметить выход: такой процесс
+   убиваем, иначе инстанс навсегда «запущен», а stop() ждёт все таймауты */
+bool MinecraftServerManager::attach_primary(std::string pending) {
+    running_ = true;
+    ready_   = false;
 
-    const std::string& cmd = config_.full_command;
-    LOG_INFO("Конфиги запуска инициализированы!", "MC");
+    //setup_rcon();
+
+    hub_id_ = ProcessHub::instance().attach(
+        readPipe_, procInfo_.hProcess,
+        [this](const std::string& line) { handle_line(line); },
+        [this] { handle_exit(); },
+        std::move(pending));
+    if (hub_id_) return true;
+
+    LOG_ERR("Процесс сервера не подключён к ProcessHub — запуск отменён.", mod_);
+    TerminateProcess(procInfo_.hProcess, 1);
+    WaitForSingleObject(procInfo_.hProcess, config_.shutdown.force_kill_timeout_ms);
+    close_process_handles();
+    if (job_) { CloseHandle(job_); job_ = nullptr; }
+    running_ = false;
+    status_  = ServerStatus::Stopped;
+    return false;
+}
+
+/* ---------- Пайпы + CreateProcess ---------- */
+bool MinecraftServerManager::spawn_process(HANDLE& stdinPipe, HANDLE& readPipe, PROCESS_INFORMATION& pi, HANDLE& job) {
+    const std::string cmd = launch_spec_->command_line();
 
     /* ---------- Настройка пайпов ---------- */
     SECURITY_ATTRIBUTES sa{ sizeof(sa), nullptr, TRUE };
@@ -227,32 +373,53 @@ void MinecraftServerManager::start() {
     HANDLE writePipeOut = nullptr;   // то, куда сервер пишет stdout
     HANDLE readPipeIn   = nullptr;   // то, откуда сервер читает stdin
 
-    /* stdout → наш readPipe_ */
-    if (!CreatePipe(&readPipe_, &writePipeOut, &sa, 0)) {
+    /* stdout → наш readPipe */
+    if (!CreatePipe(&readPipe, &writePipeOut, &sa, 0)) {
         LOG_ERR("Не удалось создать pipe stdout.", "MC_PIPE");
-        status_ = ServerStatus::Stopped;
-        return;
+        return false;
     }
-    SetHandleInformation(readPipe_, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
 
-    /* stdin  ← наш stdinPipe_  */
-    if (!CreatePipe(&readPipeIn, &stdinPipe_, &sa, 0)) {
+    /* stdin  ← наш stdinPipe  */
+    if (!CreatePipe(&readPipeIn, &stdinPipe, &sa, 0)) {
         LOG_ERR("Не удалось создать pipe stdin.", "MC_PIPE");
-        status_ = ServerStatus::Stopped;
-        CloseHandle(readPipe_);
+        CloseHandle(readPipe);
         CloseHandle(writePipeOut);
-        return;
+        readPipe = nullptr;
+        return false;
     }
-    SetHandleInformation(stdinPipe_, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(stdinPipe, HANDLE_FLAG_INHERIT, 0);
 
     /* ---------- Запуск процесса ---------- */
-    STARTUPINFOA si{};
+    STARTUPINFOEXA six{};
+    STARTUPINFOA& si = six.StartupInfo;
     si.cb         = sizeof(si);
     si.hStdInput  = readPipeIn;
     si.hStdOutput = writePipeOut;
     si.hStdError  = writePipeOut;
     si.dwFlags    = STARTF_USESTDHANDLES;
 
+    /* Предпочтительный NUMA-узел задаётся только атрибутом при создании */
+    DWORD flags = CREATE_SUSPENDED;   // политику применяем до первой инструкции JVM
+    std::vector<char> attrBuf;
+    USHORT node = static_cast<USHORT>(config_.launch.numa_node);
+    if (config_.launch.numa_node >= 0) {
+        SIZE_T size = 0;
+        InitializeProcThreadAttributeList(nullptr, 1, 0, &size);
+        attrBuf.resize(size);
+        six.lpAttributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attrBuf.data());
+        if (InitializeProcThreadAttributeList(six.lpAttributeList, 1, 0, &size) &&
+            UpdateProcThreadAttribute(six.lpAttributeList, 0, PROC_THREAD_ATTRIBUTE_PREFERRED_NODE,
+                                      &node, sizeof(node), nullptr, nullptr))
+        {
+            si.cb  = sizeof(six);
+            flags |= EXTENDED_STARTUPINFO_PRESENT;
+        } else {
+            LOG_WARNING("NUMA-узел не применён: ошибка " + std::to_string(GetLastError()), "MC_LAUNCH");
+            six.lpAttributeList = nullptr;
+        }
+    }
+
     // Преобразуем рабочую директорию в C-строку
     std::vector<char> dirBuf(config_.server_dir.begin(), config_.server_dir.end());
     dirBuf.push_back('\0');
@@ -260,75 +427,454 @@ void MinecraftServerManager::start() {
     std::vector<char> cmdBuf(cmd.begin(), cmd.end());
     cmdBuf.push_back('\0');
 
-    if (!CreateProcessA(nullptr, cmdBuf.data(),
-                        nullptr, nullptr, TRUE, 0,
-                        nullptr, dirBuf.data(),
-                        &si, &procInfo_))
+    ZeroMemory(&pi, sizeof(pi));
+    BOOL created = CreateProcessA(nullptr, cmdBuf.data(),
+                                  nullptr, nullptr, TRUE, flags,
+                                  nullptr, dirBuf.data(),
+                                  &si, &pi);
+    if (six.lpAttributeList) DeleteProcThreadAttributeList(six.lpAttributeList);
+
+    if (!created)
     {
         DWORD err = GetLastError();
         std::string errMsg = get_last_error_message(err);
-        LOG_CRITICAL("Ошибка запуска (код " + std::to_string(err) + "): " + errMsg, "MC");
-
-        LOG_CRITICAL("Прочитанный конфиг: " + config_.full_command ,"MC");
+        LOG_CRITICAL("Ошибка запуска (код " + std::to_string(err) + "): " + errMsg, mod_);
 
-        status_ = ServerStatus::Stopped;
-        running_ = false;
-        ready_ = false;                   
+        LOG_CRITICAL("Командная строка: " + cmd, mod_);
 
         CloseHandle(readPipeIn);
-        CloseHandle(stdinPipe_);
-        CloseHandle(readPipe_);
+        CloseHandle(stdinPipe);
+        CloseHandle(readPipe);
         CloseHandle(writePipeOut);
-        return;
+        stdinPipe = nullptr;
+        readPipe  = nullptr;
+        return false;
     }
 
+    proclimits::apply(pi.hProcess, config_.launch, job);
+    ResumeThread(pi.hThread);
+
     /* Эти хендлы процессу больше не нужны */
     CloseHandle(writePipeOut);
     CloseHandle(readPipeIn);
+    return true;
+}
 
-    running_ = true;
-    ready_   = false;
+/* ------------------------------------------------------------------ */
+/*                              RESTART                               */
+/* ------------------------------------------------------------------ */
+/*  Быстрый перезапуск: следующая JVM стартует, пока старая ещё
+    работает, и замораживается на gate_pattern. Шлюз обязан быть раньше
+    захвата <world>/session.lock: Forge берёт его в Main
+    (LevelStorageSource.createAccess) ещё до "Starting minecraft server
+    version", и резерв, дошедший до этого места, падает с "already
+    locked". Поэтому по умолчанию шлюз — "Launching target" ModLauncher:
+    сканирование модов и сборка модулей уже позади, Main ещё не начался.
+    Когда старый процесс сохранил мир и вышел, резерв размораживается.
+    У резерва свой Job Object: пока работают обе JVM, memory_limit_mb
+    действует на каждую отдельно, а не на сумму куч.                    */
+void MinecraftServerManager::restart() {
+    if (!config_.fast_restart.enabled || !running_) {
+        stop();
+        start();
+        return;
+    }
 
-    LOG_INFO("Процесс сервера запущен успешно", "MC");
+    LOG_INFO("Быстрый перезапуск: запуск резервной JVM...", mod_);
+    if (!launch_standby()) {
+        LOG_WARNING("Резерв не запущен, обычный перезапуск.", mod_);
+        stop();
+        start();
+        return;
+    }
 
-    //setup_rcon();
+    // Старый процесс обслуживает игроков, пока резерв грузит моды
+    {
+        std::unique_lock lk(events_mx_);
+        events_cv_.wait_for(lk, std::chrono::milliseconds(config_.fast_restart.standby_timeout_ms),
+                            [this] { return standby_gated_ || standby_exited_; });
+    }
+    if (!standby_gated_) {
+        LOG_WARNING("Резерв не дошёл до шлюза за отведённое время.", mod_);
+    }
 
-    /* ---------- Запускаем рабочие потоки ---------- */
-    output_thread_          = std::thread(&MinecraftServerManager::read_output,          this);
-    process_monitor_thread_ = std::thread(&MinecraftServerManager::monitor_process_exit, this);
+    stop();
+
+    if (!wait_session_lock_released(config_.fast_restart.lock_timeout_ms)) {
+        LOG_ERR("session.lock не освобождён вовремя — резерв отменён.", mod_);
+        discard_standby();
+        start();
+        return;
+    }
+
+    promote_standby();
+}
+
+/* ---------- Запуск резервного процесса ---------- */
+bool MinecraftServerManager::launch_standby() {
+    discard_standby();
+    apply_pending_config();
+
+    if (!spawn_process(standbyStdin_, standbyRead_, standbyInfo_, standbyJob_)) return false;
+
+    {
+        std::lock_guard lg(events_mx_);
+        standby_gated_  = false;
+        standby_exited_ = false;
+    }
+    standby_hub_id_ = ProcessHub::instance().attach(
+        standbyRead_, standbyInfo_.hProcess,
+        [this](const std::string& line) { standby_line(line); },
+        [this] {
+            {
+                std::lock_guard lg(events_mx_);
+                standby_exited_ = true;
+            }
+            events_cv_.notify_all();
+        });
+    if (!standby_hub_id_) {
+        discard_standby();
+        return false;
+    }
+
+    LOG_INFO("Резервная JVM запущена (PID " + std::to_string(standbyInfo_.dwProcessId) + ")", mod_);
+    return true;
+}
+
+/* ---------- Вывод резерва: логируем, на шлюзе — замораживаем ---------- */
+void MinecraftServerManager::standby_line(const std::string& line) {
+    LOG_INFO(line, out_mod_);
+    console_.push(line);
+
+    if (!standby_gated_ && line.find("session.lock") != std::string::npos) {
+        LOG_ERR("Резерв дошёл до session.lock раньше шлюза — gate_pattern \"" +
+                config_.fast_restart.gate_pattern + "\" печатается слишком поздно.", mod_);
+        return;
+    }
+    if (standby_gated_ || line.find(config_.fast_restart.gate_pattern) == std::string::npos) return;
+
+    if (!suspend_process(standbyInfo_.hProcess)) {
+        LOG_ERR("Не удалось заморозить резервную JVM.", mod_);
+        return;
+    }
+    {
+        std::lock_guard lg(events_mx_);
+        standby_gated_ = true;
+    }
+    events_cv_.notify_all();
+    LOG_INFO("Резерв остановлен на шлюзе, ждём освобождения мира.", mod_);
 }
 
-/* ------------------------------------------------------------------
-                                STOP                                */
-                                
+/* ---------- Резерв → основной процесс ---------- */
+void MinecraftServerManager::promote_standby() {
+    std::string tail = ProcessHub::instance().detach(standby_hub_id_);
+    standby_hub_id_ = 0;
+
+    if (!standbyInfo_.hProcess ||
+        WaitForSingleObject(standbyInfo_.hProcess, 0) != WAIT_TIMEOUT)
+    {
+        LOG_WARNING("Резервная JVM завершилась до повышения, холодный старт.", mod_);
+        discard_standby();
+        start();
+        return;
+    }
+
+    WorldBusy busy(backup_busy_);
+    if (!busy) {
+        LOG_WARNING("Идёт восстановление или прореживание мира — резерв отменён.", mod_);
+        discard_standby();
+        status_ = ServerStatus::Stopped;
+        return;
+    }
+
+    reset_primary();
+    if (job_) CloseHandle(job_);   // старая JVM уже вышла; процессы Job не убивает
+    job_         = std::exchange(standbyJob_, nullptr);
+    stdinPipe_   = std::exchange(standbyStdin_, nullptr);
+    readPipe_    = std::exchange(standbyRead_,  nullptr);
+    procInfo_    = standbyInfo_;
+    ZeroMemory(&standbyInfo_, sizeof(standbyInfo_));
+
+    status_ = ServerStatus::Starting;
+    if (!attach_primary(std::move(tail))) {
+        standby_gated_ = false;
+        return;
+    }
+
+    if (standby_gated_ && !resume_process(procInfo_.hProcess)) {
+        LOG_ERR("Не удалось разморозить резервную JVM!", mod_);
+    }
+    standby_gated_ = false;
+    LOG_INFO("Резерв повышен до основного процесса, загрузка мира...", mod_);
+}
+
+/* ---------- Убить и закрыть резерв ---------- */
+void MinecraftServerManager::discard_standby() {
+    if (standbyInfo_.hProcess) {
+        TerminateProcess(standbyInfo_.hProcess, 1);
+        WaitForSingleObject(standbyInfo_.hProcess, config_.shutdown.force_kill_timeout_ms);
+    }
+    ProcessHub::instance().detach(standby_hub_id_);
+    standby_hub_id_ = 0;
+
+    if (standbyInfo_.hProcess) { CloseHandle(standbyInfo_.hProcess); standbyInfo_.hProcess = nullptr; }
+    if (standbyInfo_.hThread)  { CloseHandle(standbyInfo_.hThread);  standbyInfo_.hThread  = nullptr; }
+    if (standbyStdin_)         { CloseHandle(standbyStdin_);         standbyStdin_         = nullptr; }
+    if (standbyRead_)          { CloseHandle(standbyRead_);          standbyRead_          = nullptr; }
+    if (standbyJob_)           { CloseHandle(standbyJob_);           standbyJob_           = nullptr; }
+    standby_gated_ = false;
+}
+
+/* ---------- Ждём, пока старый процесс отпустит <level>/session.lock ---------- */
+bool MinecraftServerManager::wait_session_lock_released(int timeout_ms) {
+    const fs::path lock = fs::path(config_.server_dir) / config_.level_name / "session.lock";
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    for (;;) {
+        HANDLE h = CreateFileA(lock.string().c_str(), GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h == INVALID_HANDLE_VALUE) {
+            // Файла нет — мир никем не занят; иначе его держат без общего доступа
+            if (GetLastError() != ERROR_SHARING_VIOLATION) return true;
+        } else {
+            OVERLAPPED ov{};
+            bool free = LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY,
+                                   0, MAXDWORD, MAXDWORD, &ov) != FALSE;
+            if (free) UnlockFileEx(h, 0, MAXDWORD, MAXDWORD, &ov);
+            CloseHandle(h);
+            if (free) return true;
+        }
+
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        Sleep(50);
+    }
+}
+
+/* ---------- Заморозка/разморозка всего процесса (ntdll) ---------- */
+using NtProcessFn = LONG (NTAPI*)(HANDLE);
+
+static NtProcessFn ntdll_fn(const char* name) {
+    HMODULE ntdll = GetModuleHandleA("ntdll.dll");
+    return ntdll ? reinterpret_cast<NtProcessFn>(GetProcAddress(ntdll, name)) : nullptr;
+}
+
+bool MinecraftServerManager::suspend_process(HANDLE process) {
+    static const NtProcessFn fn = ntdll_fn("NtSuspendProcess");
+    return fn && process && fn(process) >= 0;
+}
+
+bool MinecraftServerManager::resume_process(HANDLE process) {
+    static const NtProcessFn fn = ntdll_fn("NtResumeProcess");
+    return fn && process && fn(process) >= 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*                                STOP                                */
+/* ------------------------------------------------------------------ */
+/*  Этапы: отсчёт в чате → save-all flush → stop → TerminateProcess.
+    Каждый этап ограничен своим таймаутом из config.json и завершается,
+    как только сервер подтвердил результат, а не по худшему случаю.   */
 void MinecraftServerManager::stop() {
     if (!running_) return;
 
+    using clock = std::chrono::steady_clock;
+    const auto total_start = clock::now();
+    auto stage_start       = total_start;
+
+    auto end_stage = [&](const char* name, bool ok) {
+        auto now = clock::now();
+        auto ms  = std::chrono::duration_cast<std::chrono::milliseconds>(now - stage_start).count();
+        LOG_INFO(std::string("Этап '") + name + "': " + (ok ? "OK" : "таймаут") +
+                 ", " + std::to_string(ms) + " мс", "MC_STOP");
+        stage_start = now;
+    };
+
+    const bool world_loaded = ready_;
     status_ = ServerStatus::Stopping;
-    LOG_INFO("Отправка 'stop' в stdin...", "MC");
 
-    const std::string stopCmd = "stop\n";
-    DWORD written;
-    WriteFile(stdinPipe_, stopCmd.c_str(),
-              static_cast<DWORD>(stopCmd.size()),
-              &written, nullptr);
+    /* 1. Объявление игрокам — только если мир уже загружен */
+    if (world_loaded && config_.shutdown.countdown_s > 0) {
+        announce_countdown();
+        end_stage("countdown", true);
+    }
+
+    /* 2. Сброс мира на диск с подтверждением из вывода */
+    if (world_loaded) {
+        end_stage("save", flush_world());
+    }
+
+    /* 3. Штатный stop */
+    LOG_INFO("Отправка 'stop' в stdin...", mod_);
+    write_stdin("stop");
+    bool exited = wait_exit(config_.shutdown.stop_timeout_ms);
+    end_stage("stop", exited);
+
+    /* 4. Принудительное завершение.
+       Аналога SIGTERM для JVM на Windows нет (CTRL_BREAK лишь снимает
+       thread dump), поэтому сразу TerminateProcess. */
+    if (!exited) {
+        LOG_WARNING("Сервер не вышел вовремя. Принудительное завершение...", mod_);
+        if (procInfo_.hProcess) TerminateProcess(procInfo_.hProcess, 1);
+        end_stage("kill", wait_exit(config_.shutdown.force_kill_timeout_ms));
+    }
+
+    /* Отписка синхронная: после неё колбэки хаба нас не трогают */
+    ProcessHub::instance().detach(hub_id_);
+    hub_id_ = 0;
+    close_process_handles();
+
+    auto total = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - total_start).count();
+    LOG_INFO("Сервер остановлен за " + std::to_string(total) + " мс.", mod_);
+}
+
+/* ---------- Обратный отсчёт в чате ---------- */
+void MinecraftServerManager::announce_countdown() {
+    static constexpr int marks[] = { 300, 120, 60, 30, 10, 5, 4, 3, 2, 1 };
+
+    int left = config_.shutdown.countdown_s;
+    write_stdin("say Сервер будет остановлен через " + std::to_string(left) + " сек.");
+
+    for (int mark : marks) {
+        if (mark >= left) continue;
+
+        std::unique_lock lk(events_mx_);
+        if (events_cv_.wait_for(lk, std::chrono::seconds(left - mark), [this] { return exited_; }))
+            return; // процесс умер во время отсчёта
+        lk.unlock();
+
+        left = mark;
+        write_stdin("say Остановка через " + std::to_string(left) + " сек.");
+    }
+
+    std::unique_lock lk(events_mx_);
+    events_cv_.wait_for(lk, std::chrono::seconds(left), [this] { return exited_; });
+}
+
+/* ---------- save-all flush → "Saved the game" ---------- */
+bool MinecraftServerManager::flush_world() {
+    {
+        std::lock_guard lg(events_mx_);
+        save_confirmed_ = false;
+    }
+    if (!write_stdin("save-all flush")) return false;
+
+    std::unique_lock lk(events_mx_);
+    return events_cv_.wait_for(lk, std::chrono::milliseconds(config_.shutdown.save_timeout_ms),
+                               [this] { return save_confirmed_ || exited_; })
+           && save_confirmed_;
+}
+
+/* ---------- Ожидание выхода процесса (сигнал от монитора) ---------- */
+bool MinecraftServerManager::wait_exit(int timeout_ms) {
+    std::unique_lock lk(events_mx_);
+    return events_cv_.wait_for(lk, std::chrono::milliseconds(timeout_ms), [this] { return exited_; });
+}
 
-    /* Даём серверу шанс завершиться красиво */
-    if (WaitForSingleObject(procInfo_.hProcess, 40'000) == WAIT_TIMEOUT) {
-        LOG_WARNING("Сервер не вышел вовремя. Принудительное завершение...", "MC");
-        TerminateProcess(procInfo_.hProcess, 0);
-        WaitForSingleObject(procInfo_.hProcess, 5'000);
+/* ------------------------------------------------------------------ */
+/*                               BACKUP                               */
+/* ------------------------------------------------------------------ */
+/*  Пока автосохранение выключено, сервер не пишет в файлы мира, а
+    игра идёт дальше: изменения копятся в памяти до save-on. Поэтому
+    окно save-off держим ровно на время чтения мира. Остановленный
+    сервер снимается как есть.                                        */
+json MinecraftServerManager::backup(bool full) {
+    WorldBusy busy(backup_busy_);
+    if (!busy) throw std::runtime_error(kWorldBusy);
+
+    fs::path world;
+    BackupOptions opt;
+    {
+        std::lock_guard lg(config_mx_);
+        world = fs::path(config_.server_dir) / config_.level_name;
+        opt   = config_.backup;
     }
 
-    /* Stream‑потоки завершаются сами, но join обязателен */
-    if (output_thread_.joinable())          output_thread_.join();
-    if (process_monitor_thread_.joinable()) process_monitor_thread_.join();
+    if (running_ && !ready_) throw std::runtime_error("мир ещё загружается — снимок невозможен");
+    const bool live = running_;
+
+    using clock = std::chrono::steady_clock;
+    const auto paused_at = clock::now();
 
-    /* --- обнуляем --- */
-    output_thread_          = std::thread();
-    process_monitor_thread_ = std::thread();
+    /* save-on — при любом исходе, как только вышли из этой области */
+    struct SaveOn {
+        MinecraftServerManager* self;
+        bool armed;
+        ~SaveOn() { if (armed) self->write_stdin("save-on"); }
+    } save_on{this, false};
 
-    LOG_INFO("Сервер остановлен.", "MC");
+    if (live) {
+        if (!write_stdin("save-off")) throw std::runtime_error("stdin сервера недоступен");
+        save_on.armed = true;
+        if (!flush_world()) throw std::runtime_error("сервер не подтвердил save-all flush");
+    }
+
+    LOG_INFO(std::string("Снимок мира") + (full ? " (полный)" : "") + ": " + world.string(), mod_);
+    const fs::path root = fs::path(opt.dir) / id_;
+    BackupStats st = opt.mode == "clone" ? CloneBackup(root, opt).snapshot(world)
+                                         : WorldBackup(root, opt).snapshot(world, full);
+
+    json out = st.to_json();
+    if (live) {
+        write_stdin("save-on");
+        save_on.armed = false;
+        const auto paused = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - paused_at).count();
+        out["paused_ms"] = paused;
+        LOG_INFO("Автосохранение было выключено " + std::to_string(paused) + " мс", mod_);
+    }
+    return out;
+}
+
+json MinecraftServerManager::backups() const {
+    std::lock_guard lg(config_mx_);
+    return WorldRestore(fs::path(config_.backup.dir) / id_, config_.backup).catalog();
+}
+
+/* ---------- Восстановление: сервер стоит, start() ждать не будет ---------- */
+json MinecraftServerManager::restore(const std::string& name, const std::vector<std::string>& paths) {
+    WorldBusy busy(backup_busy_);
+    if (!busy) throw std::runtime_error(kWorldBusy);
+
+    if (running_) throw std::runtime_error("сервер запущен — сначала остановите его");
+
+    fs::path world;
+    BackupOptions opt;
+    {
+        std::lock_guard lg(config_mx_);
+        world = fs::path(config_.server_dir) / config_.level_name;
+        opt   = config_.backup;
+    }
+
+    LOG_INFO("Восстановление мира из снимка " + name, mod_);
+    return WorldRestore(fs::path(opt.dir) / id_, opt).restore(world, name, paths).to_json();
+}
+
+json MinecraftServerManager::world_report(size_t top) const {
+    fs::path world;
+    {
+        std::lock_guard lg(config_mx_);
+        world = fs::path(config_.server_dir) / config_.level_name;
+    }
+    RegionScanOptions opt;
+    opt.top = top;
+    return RegionScanner::scan(world, opt);
+}
+
+/* ---------- Прореживание: как и восстановление, переписывает мир на месте ---------- */
+json MinecraftServerManager::prune(const PruneOptions& opt) {
+    WorldBusy busy(backup_busy_);
+    if (!busy) throw std::runtime_error(kWorldBusy);
+
+    if (running_) throw std::runtime_error("сервер запущен — сначала остановите его");
+
+    fs::path world;
+    {
+        std::lock_guard lg(config_mx_);
+        world = fs::path(config_.server_dir) / config_.level_name;
+    }
+
+    LOG_INFO(std::string(opt.dry_run ? "Пробное прореживание мира: " : "Прореживание мира: ") + world.string(), mod_);
+    return ChunkPruner(opt).prune(world).to_json();
 }
 
 /* ------------------------------------------------------------------ */
@@ -344,7 +890,7 @@ ServerStatus MinecraftServerManager::get_status() const {
 
 void MinecraftServerManager::send_command(const std::string& cmd) {
     if (!running_) {
-        LOG_WARNING("Сервер не запущен — некуда слать команды.", "MC");
+        LOG_WARNING("Сервер не запущен — некуда слать команды.", mod_);
         return;
     }
 
@@ -359,12 +905,7 @@ void MinecraftServerManager::send_command(const std::string& cmd) {
         }
     }*/
 
-    const std::string cmdNL = cmd + '\n';
-    DWORD written;
-    if (!WriteFile(stdinPipe_, cmdNL.c_str(),
-                   static_cast<DWORD>(cmdNL.size()),
-                   &written, nullptr))
-    {
+    if (!write_stdin(cmd)) {
         LOG_ERR("Ошибка записи в stdin сервера.", "MC_IO");
     }
     else {
@@ -372,87 +913,77 @@ void MinecraftServerManager::send_command(const std::string& cmd) {
     }
 }
 
-/* ---------- Чтение stdout сервера ---------- */
-void MinecraftServerManager::read_output() {
-    try {
-        char buffer[1025];
-        DWORD bytesRead;
-        std::string lineBuf;
-
-        while (running_) {
-            DWORD avail = 0;
-            if (!PeekNamedPipe(readPipe_, nullptr, 0, nullptr, &avail, nullptr)) {
-                LOG_ERR("[read_output] Ошибка PeekNamedPipe.", "MC_IO");
-                break;
-            }
-            if (avail == 0) {
-                Sleep(10);
-                continue;
-            }
+bool MinecraftServerManager::write_stdin(const std::string& line) {
+    if (!stdinPipe_) return false;
 
-            if (ReadFile(readPipe_, buffer, 1024, &bytesRead, nullptr) && bytesRead) {
-                buffer[bytesRead] = '\0';
-                lineBuf += buffer;
-
-                size_t pos;
-                while ((pos = lineBuf.find('\n')) != std::string::npos) {
-                    std::string line = lineBuf.substr(0, pos);
-                    lineBuf.erase(0, pos + 1);
-
-                    // НЕ Дублируем в консоль, чтобы админ видел live‑лог.
-                    //std::cout << "[MC] " << line << '\n';
-
-                    // Пишем ПОЛНЫЙ вывод сервера в файл/консоль через Logger
-                    LOG_INFO(line, "MC_OUT");
-
-                    if (line.find("Dedicated server took") != std::string::npos && 
-                        line.find("seconds to load") != std::string::npos) {
-                        // Сервер запущен, но готовность подтвердим через RCON
-                         status_ = ServerStatus::Running;
-                         ready_ = true;
-                        LOG_INFO("Сервер сообщил о готовности, проверяем через RCON...", "MC");
-                    } else if (line.find("Stopping server") != std::string::npos) {
-                        status_ = ServerStatus::Stopping;
-                        LOG_INFO("Обнаружена остановка сервера...", "MC");
-                    } else if (line.find("All dimensions are saved") != std::string::npos) {
-                        running_ = false;
-                        //rcon_connecting_ = false; // Останавливаем попытки RCON подключения
-                        //rcon_.disconnect();
-                    }
-                }
-            } else {
-                break;  // ReadFile вернул 0 — пайп закрыт
-            }
-        }
-    } catch (const std::exception& ex) {
-        LOG_CRITICAL(std::string("[read_output] Exception: ") + ex.what(), "MC_IO");
-    } catch (...) {
-        LOG_ERR("[read_output] Unknown exception.", "MC_IO");
-    }
+    const std::string lineNL = line + '\n';
+    DWORD written;
+    return WriteFile(stdinPipe_, lineNL.c_str(),
+                     static_cast<DWORD>(lineNL.size()),
+                     &written, nullptr) != FALSE;
 }
 
-/* ---------- Мониторинг завершения процесса ---------- */
-void MinecraftServerManager::monitor_process_exit() {
-    try {
-        if (!procInfo_.hProcess) return;
+/* ---------- Строка stdout сервера (из потока ProcessHub) ---------- */
+void MinecraftServerManager::handle_line(const std::string& line) {
+    ++lines_metric_;
+    console_.push(line);
 
-        WaitForSingleObject(procInfo_.hProcess, INFINITE);
-        LOG_WARNING("Процесс сервера завершился извне.", "MC");
+    // Пишем ПОЛНЫЙ вывод сервера в файл/консоль через Logger
+    LOG_INFO(line, out_mod_);
 
-        /* Закрываем хендлы — только тут, чтобы не было дублей */
-        if (procInfo_.hProcess) { CloseHandle(procInfo_.hProcess); procInfo_.hProcess = nullptr; }
-        if (procInfo_.hThread)  { CloseHandle(procInfo_.hThread);  procInfo_.hThread  = nullptr; }
-        if (stdinPipe_)         { CloseHandle(stdinPipe_);         stdinPipe_         = nullptr; }
-        if (readPipe_)          { CloseHandle(readPipe_);          readPipe_          = nullptr; }
+    if (players_.on_line(line, static_cast<int64_t>(std::time(nullptr)))) return;
 
+    if (line.find("Dedicated server took") != std::string::npos && 
+        line.find("seconds to load") != std::string::npos) {
+        // Сервер запущен, но готовность подтвердим через RCON
+         status_ = ServerStatus::Running;
+         ready_ = true;
+        LOG_INFO("Сервер сообщил о готовности, проверяем через RCON...", mod_);
+        return;
+    }
+
+    const std::string msg = server_message(line);
+    if (msg == "Stopping server") {
+        status_ = ServerStatus::Stopping;
+        LOG_INFO("Обнаружена остановка сервера...", mod_);
+    } else if (msg == "Saved the game") {
+        {
+            std::lock_guard lg(events_mx_);
+            save_confirmed_ = true;
+        }
+        events_cv_.notify_all();
+    } else if (msg == "ThreadedAnvilChunkStorage: All dimensions are saved") {
         running_ = false;
-        ready_   = false;
-        status_  = ServerStatus::Stopped;
+        //rcon_connecting_ = false; // Останавливаем попытки RCON подключения
+        //rcon_.disconnect();
+    }
+}
+
+/* ---------- Процесс завершился и пайп вычитан (из потока ProcessHub) ---------- */
+void MinecraftServerManager::handle_exit() {
+    LOG_WARNING("Процесс сервера завершился.", mod_);
 
-        LOG_INFO("Статус сервера: Stopped", "MC");
-    } catch (const std::exception& ex) {
-        LOG_ERR(std::string("[monitor] Exception: ") + ex.what(), "MC_IO");
-    } catch (...) {
-        LOG_ERR("[monitor] Unknown exception.", "MC_IO");
+    /* Хендлы закрывает stop()/start() после detach — иначе гонка с
+       TerminateProcess */
+    running_ = false;
+    ready_   = false;
+    status_  = ServerStatus::Stopped;
+    players_.server_stopped(static_cast<int64_t>(std::time(nullptr)));
+
+    {
+        std::lock_guard lg(events_mx_);
+        exited_ = true;
     }
+    events_cv_.notify_all();
+
+    LOG_INFO("Статус сервера: Stopped", mod_);
+}
+
+nlohmann::json MinecraftServerManager::display_info() const {
+    std::lock_guard lg(config_mx_);
+    return json{
+        {"ip",      config_.display.ip},
+        {"port",    config_.display.port},
+        {"version", config_.display.version}
+    };
 }
@@ -0,0 +1,332 @@
+#include "./includes/players.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr char kMagic[8] = { 'M', 'S', 'P', 'L', 'R', 0, 1, 0 };
+
+bool valid_name(const std::string& s) {
+    return !s.empty() && s.size() <= 32 && std::all_of(s.begin(), s.end(), [](unsigned char c) {
+        return std::isalnum(c) || c == '_' || c == '.';
+    });
+}
+
+bool ends_with(const std::string& s, const char* suffix) {
+    const size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+/* "[12:00:00] [Server thread/INFO] [minecraft/DedicatedServer]: текст" → текст.
+   Первое "]: " — конец префикса: дальше может быть что угодно от игрока */
+std::string message_of(const std::string& line) {
+    const size_t p = line.find("]: ");
+    return p == std::string::npos ? line : line.substr(p + 3);
+}
+
+/* ---------- Двоичный файл: native-endian, как и .mslog ---------- */
+template <class T>
+void put(std::string& out, T v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+void put_str(std::string& out, const std::string& s) {
+    const uint8_t n = static_cast<uint8_t>(std::min<size_t>(s.size(), 255));
+    put(out, n);
+    out.append(s, 0, n);
+}
+
+struct Cursor {
+    const char* p;
+    const char* end;
+
+    template <class T>
+    bool get(T& v) {
+        if (end - p < static_cast<ptrdiff_t>(sizeof(T))) return false;
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+    bool get_str(std::string& s) {
+        uint8_t n;
+        if (!get(n) || end - p < n) return false;
+        s.assign(p, n);
+        p += n;
+        return true;
+    }
+};
+
+} // namespace
+
+PlayerTrackerOptions PlayerTrackerOptions::from_json(const json& players) {
+    PlayerTrackerOptions o;
+    if (!players.is_object()) return o;
+    o.dir          = players.value("dir",          o.dir);
+    o.checkpoint_s = players.value("checkpoint_s", o.checkpoint_s);
+    o.history      = players.value("history",      o.history);
+    return o;
+}
+
+PlayerTracker::~PlayerTracker() {
+    checkpoint();
+}
+
+std::string PlayerTracker::lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+void PlayerTracker::open(const PlayerTrackerOptions& opt, const std::string& id) {
+    std::unique_lock lk(mx_);
+    opt_  = opt;
+    file_ = fs::path(opt_.dir) / (id + ".dat");
+    load();
+}
+
+/* ---------- Разбор строк ---------- */
+bool PlayerTracker::on_line(const std::string& line, int64_t now) {
+    // Быстрый отказ: почти все строки — не про игроков
+    const bool game  = line.find(" the game") != std::string::npos;
+    const bool uuid  = !game && line.find("UUID of player ") != std::string::npos;
+    const bool login = !game && !uuid && line.find("] logged in with entity id ") != std::string::npos;
+    if (!game && !uuid && !login) return false;
+
+    const std::string msg = message_of(line);
+    std::string name, value;
+    enum { None, Uuid, Login, Join, Leave } kind = None;
+
+    if (uuid && msg.rfind("UUID of player ", 0) == 0) {
+        const size_t is = msg.find(" is ", 15);
+        if (is != std::string::npos) {
+            name  = msg.substr(15, is - 15);
+            value = lower(msg.substr(is + 4));
+            if (value.size() == 36) kind = Uuid;
+        }
+    } else if (login) {
+        // Steve[/192.168.0.5:51234] logged in with entity id 123 at (...)
+        const size_t br = msg.find('[');
+        const size_t close = msg.find("] logged in with entity id ");
+        if (br != std::string::npos && close != std::string::npos && br < close) {
+            name = msg.substr(0, br);
+            const std::string addr = msg.substr(br + 1, close - br - 1);
+            const size_t colon = addr.rfind(':');
+            if (addr.rfind("/", 0) == 0 && colon != std::string::npos) value = addr.substr(1, colon - 1);
+            kind = Login;
+        }
+    } else if (ends_with(msg, " joined the game")) {
+        name = msg.substr(0, msg.find(' '));
+        // "Steve joined the game" или "Steve (formerly known as Bob) joined the game"
+        if (msg.size() == name.size() + 16 || msg.compare(name.size(), 20, " (formerly known as ") == 0) kind = Join;
+    } else if (ends_with(msg, " left the game")) {
+        name = msg.substr(0, msg.size() - 14);
+        kind = Leave;
+    }
+    if (kind == None || !valid_name(name)) return false;
+
+    std::unique_lock lk(mx_);
+    Player& p = touch(name, now);
+    switch (kind) {
+        case Uuid:
+            if (!p.uuid.empty() && p.uuid != value) by_uuid_.erase(p.uuid);
+            p.uuid = value;
+            by_uuid_[value] = lower(name);
+            break;
+        case Login:
+            if (!value.empty()) p.ip = value;
+            break;
+        case Join:
+            if (p.online_since) end_session(p, now);   // «вышел» без строки left — например, кик при падении
+            p.online_since = now;
+            ++p.sessions;
+            p.recent.push_back({ now, 0 });
+            trim(p);
+            online_.insert(lower(name));
+            break;
+        case Leave:
+            end_session(p, now);
+            break;
+        default:
+            break;
+    }
+    dirty_ = true;
+    if (now - saved_at_ >= opt_.checkpoint_s) save_locked(now);
+    return true;
+}
+
+PlayerTracker::Player& PlayerTracker::touch(const std::string& name, int64_t now) {
+    Player& p = by_name_[lower(name)];
+    if (p.first_seen == 0) p.first_seen = now;
+    p.name      = name;   // регистр — как в последней строке
+    p.last_seen = now;
+    return p;
+}
+
+void PlayerTracker::end_session(Player& p, int64_t now) {
+    if (p.online_since) {
+        p.total_s += static_cast<uint64_t>(std::max<int64_t>(now - p.online_since, 0));
+        if (!p.recent.empty() && p.recent.back().leave == 0) p.recent.back().leave = now;
+        p.online_since = 0;
+    }
+    online_.erase(lower(p.name));
+}
+
+void PlayerTracker::trim(Player& p) const {
+    while (p.recent.size() > opt_.history) p.recent.pop_front();
+}
+
+void PlayerTracker::server_stopped(int64_t now) {
+    std::unique_lock lk(mx_);
+    if (online_.empty() && !dirty_) return;
+    for (const auto& key : std::vector<std::string>(online_.begin(), online_.end())) {   // end_session правит online_
+        auto it = by_name_.find(key);
+        if (it != by_name_.end()) end_session(it->second, now);
+    }
+    online_.clear();
+    dirty_ = true;
+    save_locked(now);
+}
+
+void PlayerTracker::checkpoint() {
+    std::unique_lock lk(mx_);
+    if (dirty_ && !file_.empty()) save_locked(static_cast<int64_t>(std::time(nullptr)));
+}
+
+/* ---------- Запросы ---------- */
+json PlayerTracker::to_json(const Player& p, int64_t now) const {
+    json recent = json::array();
+    for (const auto& s : p.recent) recent.push_back({ {"join", s.join}, {"leave", s.leave ? json(s.leave) : json()} });
+    const uint64_t current = p.online_since ? static_cast<uint64_t>(std::max<int64_t>(now - p.online_since, 0)) : 0;
+    return {
+        {"name",         p.name},
+        {"uuid",         p.uuid},
+        {"ip",           p.ip},
+        {"online",       p.online_since != 0},
+        {"online_since", p.online_since ? json(p.online_since) : json()},
+        {"first_seen",   p.first_seen},
+        {"last_seen",    p.last_seen},
+        {"sessions",     p.sessions},
+        {"total_s",      p.total_s + current},
+        {"recent",       recent}
+    };
+}
+
+json PlayerTracker::online() const {
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    std::shared_lock lk(mx_);
+    json list = json::array();
+    for (const auto& key : online_) {
+        const Player& p = by_name_.at(key);
+        list.push_back({ {"name", p.name}, {"uuid", p.uuid}, {"since", p.online_since},
+                         {"session_s", now - p.online_since} });
+    }
+    std::sort(list.begin(), list.end(), [](const json& a, const json& b) { return a["since"] < b["since"]; });
+    return { {"online", list}, {"count", online_.size()}, {"known", by_name_.size()} };
+}
+
+json PlayerTracker::find(const std::string& key) const {
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    const std::string k = lower(key);
+    std::shared_lock lk(mx_);
+    auto it = by_name_.find(k);
+    if (it == by_name_.end()) {
+        auto u = by_uuid_.find(k);
+        if (u != by_uuid_.end()) it = by_name_.find(u->second);
+    }
+    return it == by_name_.end() ? json() : to_json(it->second, now);
+}
+
+/* ---------- Контрольная точка ---------- */
+void PlayerTracker::save_locked(int64_t now) {
+    std::string out;
+    out.reserve(64 + by_name_.size() * 96);
+    out.append(kMagic, sizeof(kMagic));
+    put<int64_t>(out, now);
+    put<uint32_t>(out, static_cast<uint32_t>(by_name_.size()));
+    for (const auto& [key, p] : by_name_) {
+        put_str(out, p.name);
+        put_str(out, p.uuid);
+        put_str(out, p.ip);
+        put<int64_t>(out, p.first_seen);
+        put<int64_t>(out, p.last_seen);
+        put<int64_t>(out, p.online_since);
+        put<uint64_t>(out, p.total_s);
+        put<uint32_t>(out, p.sessions);
+        put<uint16_t>(out, static_cast<uint16_t>(p.recent.size()));
+        for (const auto& s : p.recent) {
+            put<int64_t>(out, s.join);
+            put<int64_t>(out, s.leave);
+        }
+    }
+
+    std::error_code ec;
+    fs::create_directories(file_.parent_path(), ec);
+    const fs::path tmp = fs::path(file_).concat(".tmp");
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!f) {
+            LOG_WARNING("Не записан " + tmp.string(), "PLAYERS");
+            return;
+        }
+    }
+    fs::rename(tmp, file_, ec);
+    if (ec) {
+        LOG_WARNING("Не записан " + file_.string() + ": " + ec.message(), "PLAYERS");
+        return;
+    }
+    saved_at_ = now;
+    dirty_    = false;
+}
+
+void PlayerTracker::load() {
+    by_name_.clear();
+    by_uuid_.clear();
+    online_.clear();
+
+    std::ifstream f(file_, std::ios::binary);
+    if (!f) return;
+    const std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    Cursor c{ data.data(), data.data() + data.size() };
+    int64_t  saved_at = 0;
+    uint32_t count = 0;
+    if (data.size() < sizeof(kMagic) || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0 ||
+        (c.p += sizeof(kMagic), !c.get(saved_at) || !c.get(count))) {
+        LOG_WARNING("Файл игроков не распознан, индекс начат заново: " + file_.string(), "PLAYERS");
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        Player p;
+        uint16_t n = 0;
+        if (!c.get_str(p.name) || !c.get_str(p.uuid) || !c.get_str(p.ip) || !c.get(p.first_seen) ||
+            !c.get(p.last_seen) || !c.get(p.online_since) || !c.get(p.total_s) || !c.get(p.sessions) || !c.get(n)) {
+            LOG_WARNING("Файл игроков обрезан, прочитано " + std::to_string(i) + " из " + std::to_string(count), "PLAYERS");
+            break;
+        }
+        for (uint16_t k = 0; k < n; ++k) {
+            Session s;
+            if (!c.get(s.join) || !c.get(s.leave)) break;
+            p.recent.push_back(s);
+        }
+        // Сессия, открытая на момент точки: конец неизвестен, берём время точки
+        if (p.online_since) {
+            p.total_s += static_cast<uint64_t>(std::max<int64_t>(saved_at - p.online_since, 0));
+            if (!p.recent.empty() && p.recent.back().leave == 0) p.recent.back().leave = saved_at;
+            p.online_since = 0;
+        }
+        trim(p);
+        const std::string key = lower(p.name);
+        if (!p.uuid.empty()) by_uuid_[p.uuid] = key;
+        by_name_[key] = std::move(p);
+    }
+    saved_at_ = saved_at;
+    LOG_INFO("Игроков в индексе: " + std::to_string(by_name_.size()), "PLAYERS");
+}
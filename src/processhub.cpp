@@ -0,0 +1,159 @@
+#include "./includes/processhub.h"
+#include "./includes/metrics.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+
+int ProcessHub::attach(HANDLE readPipe, HANDLE process, LineFn on_line, ExitFn on_exit,
+                       std::string pending)
+{
+    auto e = std::make_shared<Entry>();
+    e->pipe    = readPipe;
+    if (!DuplicateHandle(GetCurrentProcess(), process, GetCurrentProcess(), &e->process,
+                         SYNCHRONIZE, FALSE, 0))
+    {
+        LOG_ERR("DuplicateHandle: ошибка " + std::to_string(GetLastError()), "MC_IO");
+        return 0;
+    }
+    e->on_line = std::move(on_line);
+    e->on_exit = std::move(on_exit);
+    e->buf     = std::move(pending);
+
+    std::lock_guard lg(mx_);
+    e->id = next_id_++;
+    entries_.push_back(e);
+    stop_ = false;
+    if (!thread_.joinable()) thread_ = std::thread(&ProcessHub::loop, this);
+    cv_.notify_one();
+    return e->id;
+}
+
+std::string ProcessHub::detach(int id) {
+    // Колбэки идут под dispatch_mx_; из самого колбэка блокировка уже взята
+    std::unique_lock<std::mutex> dg(dispatch_mx_, std::defer_lock);
+    if (std::this_thread::get_id() != thread_.get_id()) dg.lock();
+
+    std::lock_guard lg(mx_);
+    auto it = std::find_if(entries_.begin(), entries_.end(),
+                           [id](const auto& e) { return e->id == id; });
+    if (it == entries_.end()) return {};
+
+    std::string tail = std::move((*it)->buf);
+    entries_.erase(it);
+    return tail;
+}
+
+void ProcessHub::shutdown() {
+    {
+        std::lock_guard lg(mx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable() && std::this_thread::get_id() != thread_.get_id()) thread_.join();
+}
+
+size_t ProcessHub::watched() const {
+    std::lock_guard lg(mx_);
+    return entries_.size();
+}
+
+/* ---------- Вычитать доступное из пайпа и раздать строки ---------- */
+bool ProcessHub::pump(Entry& e) {
+    static auto& bytes_total = Metrics::instance().counter("hub.bytes");
+    static auto& lines_total = Metrics::instance().counter("hub.lines");
+
+    char buffer[4096];
+    size_t total = 0;
+
+    // Не больше 64 КБ за проход, чтобы болтливый инстанс не душил соседей
+    while (total < 64 * 1024) {
+        DWORD avail = 0;
+        if (!PeekNamedPipe(e.pipe, nullptr, 0, nullptr, &avail, nullptr) || avail == 0) break;
+
+        DWORD n = 0;
+        if (!ReadFile(e.pipe, buffer, (std::min<DWORD>)(avail, sizeof(buffer)), &n, nullptr) || n == 0) break;
+        e.buf.append(buffer, n);
+        total += n;
+    }
+    if (total == 0) return false;
+    bytes_total += total;
+
+    size_t start = 0, pos;
+    while ((pos = e.buf.find('\n', start)) != std::string::npos) {
+        size_t end = (pos > start && e.buf[pos - 1] == '\r') ? pos - 1 : pos;
+        e.on_line(e.buf.substr(start, end - start));
+        ++lines_total;
+        start = pos + 1;
+    }
+    e.buf.erase(0, start);
+    return true;
+}
+
+bool ProcessHub::finished(Entry& e) {
+    if (WaitForSingleObject(e.process, 0) != WAIT_OBJECT_0) return false;
+
+    DWORD avail = 0;
+    if (PeekNamedPipe(e.pipe, nullptr, 0, nullptr, &avail, nullptr) && avail > 0) return false;
+
+    if (!e.buf.empty()) {             // последняя строка без '\n'
+        e.on_line(e.buf);
+        e.buf.clear();
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/*                               LOOP                                 */
+/* ------------------------------------------------------------------ */
+void ProcessHub::loop() {
+    for (;;) {
+        std::vector<std::shared_ptr<Entry>> snapshot;
+        {
+            std::unique_lock lk(mx_);
+            cv_.wait(lk, [this] { return stop_ || !entries_.empty(); });
+            if (stop_) return;
+            snapshot = entries_;
+        }
+
+        // snapshot держит записи (и их копии хендлов) живыми до конца ожидания
+        bool busy = false;
+        std::vector<HANDLE> alive;
+        {
+            std::lock_guard dg(dispatch_mx_);
+            for (auto& e : snapshot) {
+                {
+                    // Могли отписать между снимком и dispatch_mx_
+                    std::lock_guard lg(mx_);
+                    if (std::find(entries_.begin(), entries_.end(), e) == entries_.end()) continue;
+                }
+
+                try {
+                    busy |= pump(*e);
+
+                    if (finished(*e)) {
+                        {
+                            std::lock_guard lg(mx_);
+                            entries_.erase(std::remove(entries_.begin(), entries_.end(), e), entries_.end());
+                        }
+                        e->on_exit();
+                        continue;
+                    }
+                } catch (const std::exception& ex) {
+                    LOG_ERR(std::string("[hub] Exception: ") + ex.what(), "MC_IO");
+                } catch (...) {
+                    LOG_ERR("[hub] Unknown exception.", "MC_IO");
+                }
+
+                if (alive.size() < MAXIMUM_WAIT_OBJECTS) alive.push_back(e->process);
+            }
+        }
+
+        if (busy) continue;
+
+        // Тишина: ждём смерти любого процесса, но не дольше 10 мс (как раньше Sleep(10))
+        if (!alive.empty())
+            WaitForMultipleObjects(static_cast<DWORD>(alive.size()), alive.data(), FALSE, 10);
+        else
+            Sleep(10);
+    }
+}
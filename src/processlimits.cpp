@@ -0,0 +1,150 @@
+#include "./includes/processlimits.h"
+#include "./includes/logger.h"
+
+#include <stdexcept>
+
+/* ---------- Разбор блока "launch" ---------- */
+LaunchPolicy LaunchPolicy::from_json(const nlohmann::json& launch) {
+    LaunchPolicy p;
+    if (!launch.is_object()) return p;
+
+    if (launch.contains("cpu_set")) p.cpu_mask = proclimits::parse_cpu_list(launch["cpu_set"].get<std::string>());
+    p.numa_node = launch.value("numa_node", p.numa_node);
+
+    const std::string prio = launch.value("priority", "");
+    if      (prio.empty())           p.priority_class = 0;
+    else if (prio == "idle")         p.priority_class = IDLE_PRIORITY_CLASS;
+    else if (prio == "below_normal") p.priority_class = BELOW_NORMAL_PRIORITY_CLASS;
+    else if (prio == "normal")       p.priority_class = NORMAL_PRIORITY_CLASS;
+    else if (prio == "above_normal") p.priority_class = ABOVE_NORMAL_PRIORITY_CLASS;
+    else if (prio == "high")         p.priority_class = HIGH_PRIORITY_CLASS;
+    else throw std::runtime_error("launch.priority: неизвестное значение \"" + prio + "\"");
+
+    const std::string io = launch.value("io_priority", "");
+    if      (io.empty())      p.io_priority = -1;
+    else if (io == "very_low") p.io_priority = 0;
+    else if (io == "low")      p.io_priority = 1;
+    else if (io == "normal")   p.io_priority = 2;
+    else throw std::runtime_error("launch.io_priority: неизвестное значение \"" + io + "\"");
+
+    if (launch.contains("job")) {
+        const auto& job = launch["job"];
+        p.cpu_rate_percent = job.value("cpu_rate_percent", 0);
+        p.memory_limit_mb  = job.value("memory_limit_mb",  size_t(0));
+        if (p.cpu_rate_percent < 0 || p.cpu_rate_percent > 100)
+            throw std::runtime_error("launch.job.cpu_rate_percent: ожидается 0..100");
+    }
+    return p;
+}
+
+namespace proclimits {
+
+DWORD_PTR parse_cpu_list(const std::string& list) {
+    constexpr unsigned max_cpu = sizeof(DWORD_PTR) * 8;
+    DWORD_PTR mask = 0;
+    size_t pos = 0;
+
+    while (pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        std::string part = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = (comma == std::string::npos) ? list.size() : comma + 1;
+
+        part.erase(0, part.find_first_not_of(" \t"));
+        part.erase(part.find_last_not_of(" \t") + 1);
+        if (part.empty()) continue;
+
+        unsigned lo = 0, hi = 0;
+        size_t dash = part.find('-');
+        try {
+            lo = static_cast<unsigned>(std::stoul(part.substr(0, dash)));
+            hi = (dash == std::string::npos) ? lo : static_cast<unsigned>(std::stoul(part.substr(dash + 1)));
+        } catch (const std::exception&) {
+            throw std::runtime_error("cpu_set: не разобрать \"" + part + "\"");
+        }
+        if (lo > hi || hi >= max_cpu)
+            throw std::runtime_error("cpu_set: диапазон \"" + part + "\" вне 0.." + std::to_string(max_cpu - 1));
+
+        for (unsigned cpu = lo; cpu <= hi; ++cpu) mask |= DWORD_PTR(1) << cpu;
+    }
+    if (!mask) throw std::runtime_error("cpu_set: пустой список процессоров");
+    return mask;
+}
+
+/* ---------- IO-приоритет: только через ntdll (ProcessIoPriority = 33) ---------- */
+static bool set_io_priority(HANDLE process, int prio) {
+    using NtSetInfoFn = LONG (NTAPI*)(HANDLE, int, PVOID, ULONG);
+    static const NtSetInfoFn fn = [] {
+        HMODULE ntdll = GetModuleHandleA("ntdll.dll");
+        return ntdll ? reinterpret_cast<NtSetInfoFn>(GetProcAddress(ntdll, "NtSetInformationProcess")) : nullptr;
+    }();
+    ULONG value = static_cast<ULONG>(prio);
+    return fn && fn(process, 33, &value, sizeof(value)) >= 0;
+}
+
+static bool setup_job(HANDLE& job, const LaunchPolicy& policy) {
+    if (!job) job = CreateJobObjectA(nullptr, nullptr);
+    if (!job) return false;
+
+    bool ok = true;
+    if (policy.memory_limit_mb > 0) {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION ext{};
+        ext.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_JOB_MEMORY;
+        ext.JobMemoryLimit = static_cast<SIZE_T>(policy.memory_limit_mb) * 1024 * 1024;
+        ok &= SetInformationJobObject(job, JobObjectExtendedLimitInformation, &ext, sizeof(ext)) != FALSE;
+    }
+    if (policy.cpu_rate_percent > 0) {
+        JOBOBJECT_CPU_RATE_CONTROL_INFORMATION cpu{};
+        cpu.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE | JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+        cpu.CpuRate      = static_cast<DWORD>(policy.cpu_rate_percent) * 100;   // в сотых долях процента
+        ok &= SetInformationJobObject(job, JobObjectCpuRateControlInformation, &cpu, sizeof(cpu)) != FALSE;
+    }
+    return ok;
+}
+
+bool apply(HANDLE process, const LaunchPolicy& policy, HANDLE& job) {
+    bool ok = true;
+
+    DWORD_PTR own = 0, system = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &own, &system);
+
+    // Без cpu_set ребёнок получает все ядра, а не служебные ядра mshost
+    DWORD_PTR mask = policy.cpu_mask ? (policy.cpu_mask & system) : system;
+    if (policy.numa_node >= 0 && !policy.cpu_mask) {
+        GROUP_AFFINITY node{};
+        if (GetNumaNodeProcessorMaskEx(static_cast<USHORT>(policy.numa_node), &node) && node.Group == 0)
+            mask = node.Mask & system;
+    }
+    if (mask && mask != own) {
+        if (!SetProcessAffinityMask(process, mask)) {
+            LOG_WARNING("SetProcessAffinityMask: ошибка " + std::to_string(GetLastError()), "MC_LAUNCH");
+            ok = false;
+        }
+    }
+
+    if (policy.priority_class && !SetPriorityClass(process, policy.priority_class)) {
+        LOG_WARNING("SetPriorityClass: ошибка " + std::to_string(GetLastError()), "MC_LAUNCH");
+        ok = false;
+    }
+
+    if (policy.io_priority >= 0 && !set_io_priority(process, policy.io_priority)) {
+        LOG_WARNING("Не удалось выставить IO-приоритет", "MC_LAUNCH");
+        ok = false;
+    }
+
+    if (policy.needs_job()) {
+        if (!setup_job(job, policy) || !AssignProcessToJobObject(job, process)) {
+            LOG_WARNING("Job Object: ошибка " + std::to_string(GetLastError()), "MC_LAUNCH");
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool pin_current_process(DWORD_PTR mask) {
+    DWORD_PTR own = 0, system = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &own, &system);
+    if (!(mask & system)) return false;
+    return SetProcessAffinityMask(GetCurrentProcess(), mask & system) != FALSE;
+}
+
+}
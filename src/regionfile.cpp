@@ -0,0 +1,104 @@
+#include "./includes/regionfile.h"
+
+#include <cstdlib>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+
+MappedRegion::MappedRegion(const fs::path& path) {
+    file_ = CreateFileW(path.wstring().c_str(), GENERIC_READ,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("не открывается " + path.string() + ": ошибка " + std::to_string(GetLastError()));
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(file_, &size);
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0) return;   // пустой файл не отображается
+
+    map_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (map_) data_ = static_cast<const unsigned char*>(MapViewOfFile(map_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        const DWORD err = GetLastError();
+        if (map_) CloseHandle(map_);
+        CloseHandle(file_);
+        throw std::runtime_error("не отображается " + path.string() + ": ошибка " + std::to_string(err));
+    }
+}
+
+MappedRegion::~MappedRegion() {
+    if (data_) UnmapViewOfFile(data_);
+    if (map_) CloseHandle(map_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+}
+
+#else
+
+MappedRegion::MappedRegion(const fs::path& path) {
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) throw std::runtime_error("не открывается " + path.string());
+
+    struct stat st{};
+    fstat(fd_, &st);
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) return;
+
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        close(fd_);
+        throw std::runtime_error("не отображается " + path.string());
+    }
+    data_ = static_cast<const unsigned char*>(p);
+}
+
+MappedRegion::~MappedRegion() {
+    if (data_) munmap(const_cast<unsigned char*>(data_), size_);
+    if (fd_ >= 0) close(fd_);
+}
+
+#endif
+
+const unsigned char* MappedRegion::chunk(int slot, uint32_t& length) const {
+    const uint64_t off = offset(slot);
+    if (!location(slot) || off < kHeaderBytes || off + 5 > size_) return nullptr;
+    length = be32(data_ + off);
+    const uint64_t span = uint64_t(sectors(slot)) * kSector;
+    if (length == 0 || length + 4 > span || off + 4 + length > size_) return nullptr;
+    return data_ + off;
+}
+
+bool MappedRegion::coords(const fs::path& path, int& rx, int& rz) {
+    const std::string name = path.filename().string();   // r.-3.12.mca
+    if (name.size() < 8 || name.compare(0, 2, "r.") != 0) return false;
+    char* end = nullptr;
+    rx = static_cast<int>(std::strtol(name.c_str() + 2, &end, 10));
+    if (*end != '.') return false;
+    rz = static_cast<int>(std::strtol(end + 1, &end, 10));
+    return std::string(end) == ".mca";
+}
+
+void MappedRegion::classify(const fs::path& rel_dir, std::string& dimension, std::string& kind) {
+    kind = rel_dir.filename().string();
+    const std::string dim = rel_dir.parent_path().generic_string();
+
+    if (dim.empty())       dimension = "minecraft:overworld";
+    else if (dim == "DIM-1") dimension = "minecraft:the_nether";
+    else if (dim == "DIM1")  dimension = "minecraft:the_end";
+    else if (dim.rfind("dimensions/", 0) == 0) {
+        const std::string rest = dim.substr(11);   // ns/name[/sub]
+        const size_t slash = rest.find('/');
+        dimension = slash == std::string::npos ? rest : rest.substr(0, slash) + ":" + rest.substr(slash + 1);
+    } else {
+        dimension = dim;
+    }
+}
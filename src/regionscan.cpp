@@ -0,0 +1,195 @@
+#include "./includes/regionscan.h"
+#include "./includes/regionfile.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t   kAgeBuckets = 7;
+constexpr int64_t  kAgeLimits[kAgeBuckets - 1] = { 3600, 86400, 7 * 86400, 30 * 86400, 90 * 86400, 365 * 86400 };
+constexpr const char* kAgeNames[kAgeBuckets]   = { "1h", "1d", "7d", "30d", "90d", "365d", "older" };
+
+using Ages = std::array<uint64_t, kAgeBuckets>;
+
+size_t age_bucket(int64_t age_s) {
+    size_t b = 0;
+    while (b < kAgeBuckets - 1 && age_s >= kAgeLimits[b]) ++b;
+    return b;
+}
+
+json ages_json(const Ages& a) {
+    json j = json::object();
+    for (size_t i = 0; i < kAgeBuckets; ++i) j[kAgeNames[i]] = a[i];
+    return j;
+}
+
+struct BigChunk {
+    int      x = 0, z = 0;     // координаты чанка
+    uint32_t sectors = 0;
+};
+
+struct Region {
+    std::string dimension, kind, file;
+    int      rx = 0, rz = 0;
+    uint64_t bytes = 0, used = 0;
+    uint32_t chunks = 0, recent = 0;      // recent — изменены за сутки
+    uint32_t newest = 0;
+    Ages     ages{};
+    std::vector<BigChunk> big;            // top чанков этого файла
+};
+
+template <class T, class Less>
+void keep_top(std::vector<T>& v, size_t n, Less less) {
+    if (v.size() <= n) {
+        std::sort(v.begin(), v.end(), less);
+        return;
+    }
+    std::partial_sort(v.begin(), v.begin() + n, v.end(), less);
+    v.resize(n);
+}
+
+void scan_file(const fs::path& path, Region& r, int64_t now, size_t top) {
+    MappedRegion m(path);
+    r.bytes = m.size();
+    if (!m.has_header()) return;
+    r.used = MappedRegion::kHeaderBytes;
+
+    for (int slot = 0; slot < MappedRegion::kSlots; ++slot) {
+        if (!m.location(slot)) continue;
+        const uint32_t ts = m.timestamp(slot);
+        ++r.chunks;
+        r.used  += uint64_t(m.sectors(slot)) * MappedRegion::kSector;
+        r.newest = (std::max)(r.newest, ts);
+
+        const int64_t age = ts ? now - static_cast<int64_t>(ts) : INT64_MAX;
+        ++r.ages[age_bucket(std::max<int64_t>(age, 0))];
+        if (age < 86400) ++r.recent;
+
+        r.big.push_back({ r.rx * 32 + slot % 32, r.rz * 32 + slot / 32, m.sectors(slot) });
+    }
+    keep_top(r.big, top, [](const BigChunk& a, const BigChunk& b) { return a.sectors > b.sectors; });
+}
+
+json region_json(const Region& r) {
+    return {
+        {"dimension", r.dimension}, {"kind", r.kind}, {"file", r.file},
+        {"x", r.rx}, {"z", r.rz},
+        {"bytes", r.bytes}, {"slack", r.bytes > r.used ? r.bytes - r.used : 0},
+        {"chunks", r.chunks}, {"recent", r.recent}, {"newest", r.newest}
+    };
+}
+
+} // namespace
+
+json RegionScanner::scan(const fs::path& world_dir, const RegionScanOptions& opt) {
+    const auto t0 = std::chrono::steady_clock::now();
+    std::error_code ec;
+    if (!fs::is_directory(world_dir, ec)) throw std::runtime_error("нет каталога мира: " + world_dir.string());
+
+    std::vector<Region> regions;
+    std::vector<fs::path> paths;
+    for (auto it = fs::recursive_directory_iterator(world_dir, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        Region r;
+        if (!it->is_regular_file(ec) || !MappedRegion::coords(it->path(), r.rx, r.rz)) continue;
+        MappedRegion::classify(fs::relative(it->path().parent_path(), world_dir, ec), r.dimension, r.kind);
+        r.file = it->path().filename().string();
+        regions.push_back(std::move(r));
+        paths.push_back(it->path());
+    }
+
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    unsigned threads = opt.threads ? opt.threads : (std::max)(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::clamp<size_t>(threads, 1, std::max<size_t>(regions.size(), 1)));
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> errors{0};
+    auto worker = [&] {
+        for (size_t i; (i = next++) < regions.size(); ) {
+            try {
+                scan_file(paths[i], regions[i], now, opt.top);
+            } catch (const std::exception& e) {
+                ++errors;
+                LOG_DEBUG(e.what(), "WORLD");
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    /* Итоги по измерениям */
+    struct Dim { size_t files = 0; uint64_t bytes = 0, used = 0, chunks = 0, recent = 0; Ages ages{}; };
+    std::map<std::pair<std::string, std::string>, Dim> dims;
+    std::vector<std::pair<const Region*, BigChunk>> big_all;
+    uint64_t total_bytes = 0, total_chunks = 0;
+    for (const auto& r : regions) {
+        Dim& d = dims[{ r.dimension, r.kind }];
+        ++d.files;
+        d.bytes  += r.bytes;
+        d.used   += r.used;
+        d.chunks += r.chunks;
+        d.recent += r.recent;
+        for (size_t i = 0; i < kAgeBuckets; ++i) d.ages[i] += r.ages[i];
+        total_bytes  += r.bytes;
+        total_chunks += r.chunks;
+        if (r.kind == "region") for (const auto& c : r.big) big_all.push_back({ &r, c });
+    }
+
+    json dim_list = json::array();
+    for (const auto& [key, d] : dims) {
+        dim_list.push_back({
+            {"dimension", key.first}, {"kind", key.second},
+            {"files", d.files}, {"bytes", d.bytes}, {"slack", d.bytes > d.used ? d.bytes - d.used : 0},
+            {"chunks", d.chunks}, {"recent", d.recent}, {"ages", ages_json(d.ages)}
+        });
+    }
+    std::sort(dim_list.begin(), dim_list.end(),
+              [](const json& a, const json& b) { return a["bytes"] > b["bytes"]; });
+
+    std::vector<const Region*> by_size, by_churn;
+    for (const auto& r : regions) {
+        by_size.push_back(&r);
+        if (r.recent) by_churn.push_back(&r);
+    }
+    keep_top(by_size,  opt.top, [](const Region* a, const Region* b) { return a->bytes > b->bytes; });
+    keep_top(by_churn, opt.top, [](const Region* a, const Region* b) { return a->recent > b->recent; });
+    keep_top(big_all,  opt.top, [](const auto& a, const auto& b) { return a.second.sectors > b.second.sectors; });
+
+    json largest = json::array(), churned = json::array(), chunks = json::array();
+    for (const Region* r : by_size)  largest.push_back(region_json(*r));
+    for (const Region* r : by_churn) churned.push_back(region_json(*r));
+    for (const auto& [r, c] : big_all) {
+        chunks.push_back({ {"dimension", r->dimension}, {"x", c.x}, {"z", c.z},
+                           {"sectors", c.sectors}, {"bytes", uint64_t(c.sectors) * MappedRegion::kSector} });
+    }
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    return {
+        {"world",           world_dir.filename().string()},
+        {"files",           regions.size()},
+        {"errors",          errors.load()},
+        {"bytes",           total_bytes},
+        {"chunks",          total_chunks},
+        {"scanned_ms",      ms},
+        {"dimensions",      dim_list},
+        {"largest_regions", largest},
+        {"churned_regions", churned},
+        {"largest_chunks",  chunks}
+    };
+}
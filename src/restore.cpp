@@ -0,0 +1,217 @@
+#include "./includes/restore.h"
+#include "./includes/clonebackup.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr const char* kTmpSuffix = ".restore-tmp";
+
+/* "DIM-1\\region\\" → "DIM-1/region" */
+std::string normalize(std::string p) {
+    std::replace(p.begin(), p.end(), '\\', '/');
+    while (!p.empty() && p.back() == '/') p.pop_back();
+    while (!p.empty() && p.front() == '/') p.erase(0, 1);
+    return p;
+}
+
+bool selected(const std::string& rel, const std::vector<std::string>& paths) {
+    if (paths.empty()) return true;
+    for (const auto& p : paths) {
+        if (rel == p || (rel.size() > p.size() && rel.compare(0, p.size(), p) == 0 && rel[p.size()] == '/'))
+            return true;
+    }
+    return false;
+}
+
+bool valid_name(const std::string& name) {
+    return !name.empty() && std::all_of(name.begin(), name.end(), [](unsigned char c) {
+        return std::isalnum(c) || c == '-' || c == '_';
+    });
+}
+
+/* Перенос с созданием каталогов по пути */
+void move_aside(const fs::path& from, const fs::path& to) {
+    fs::create_directories(to.parent_path());
+    fs::rename(from, to);
+}
+
+} // namespace
+
+WorldRestore::WorldRestore(fs::path root, BackupOptions opt)
+    : root_(std::move(root)), opt_(std::move(opt)) {}
+
+json WorldRestore::catalog() const {
+    json list = json::array();
+    auto add = [&](const fs::path& manifest, const char* kind) {
+        try {
+            std::ifstream f(manifest);
+            const json m = json::parse(f);
+            list.push_back({
+                {"name",    m.at("name")},
+                {"kind",    kind},
+                {"created", m.value("created", 0)},
+                {"files",   m.at("files").size()},
+                {"stats",   m.value("stats", json::object())}
+            });
+        } catch (const std::exception& e) {
+            LOG_WARNING("Манифест не читается: " + manifest.string() + " (" + e.what() + ")", "BACKUP");
+        }
+    };
+
+    const WorldBackup wb(root_, opt_);
+    for (const auto& n : wb.snapshots()) add(wb.manifest_path(n), "dedup");
+    for (const auto& n : CloneBackup(root_, opt_).snapshots()) add(root_ / "clones" / (n + ".json"), "clone");
+
+    std::sort(list.begin(), list.end(), [](const json& a, const json& b) { return a["name"] < b["name"]; });
+    return list;
+}
+
+RestoreStats WorldRestore::restore(const fs::path& world_dir, const std::string& name,
+                                   const std::vector<std::string>& raw_paths) {
+    const auto t0 = std::chrono::steady_clock::now();
+    if (!valid_name(name)) throw std::invalid_argument("недопустимое имя снимка: " + name);
+
+    const WorldBackup dedup(root_, opt_);
+    const CloneBackup clone(root_, opt_);
+
+    RestoreStats total;
+    total.name = name;
+    fs::path manifest_path = dedup.manifest_path(name);
+    if (fs::exists(manifest_path)) {
+        total.kind = "dedup";
+    } else if (manifest_path = root_ / "clones" / (name + ".json"); fs::exists(manifest_path)) {
+        total.kind = "clone";
+    } else {
+        throw std::invalid_argument("нет снимка " + name);
+    }
+
+    std::vector<std::string> paths;
+    for (const auto& p : raw_paths) {
+        const std::string n = normalize(p);
+        if (n.empty() || n.find("..") != std::string::npos) throw std::invalid_argument("недопустимый путь: " + p);
+        paths.push_back(n);
+    }
+    const bool partial = !paths.empty();
+
+    std::ifstream mf(manifest_path);
+    const json manifest = json::parse(mf);
+    std::vector<const json*> entries;
+    for (const auto& e : manifest.at("files")) {
+        if (selected(e.at("path").get<std::string>(), paths)) entries.push_back(&e);
+    }
+
+    // Файлы мира под выбранными путями, которых нет в снимке
+    std::unordered_set<std::string> in_snapshot;
+    for (const json* e : entries) in_snapshot.insert(e->at("path").get<std::string>());
+    std::vector<std::string> extras;
+    if (partial) {
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(world_dir, ec);
+             !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file(ec)) continue;
+            const std::string rel = fs::relative(it->path(), world_dir, ec).generic_string();
+            if (selected(rel, paths) && !in_snapshot.count(rel) && it->path().filename() != "session.lock")
+                extras.push_back(rel);
+        }
+        if (entries.empty() && extras.empty())
+            throw std::invalid_argument("ни в снимке, ни в мире нет указанных путей");
+    }
+
+    const fs::path staging = world_dir.parent_path() / (world_dir.filename().string() + ".restore");
+    const fs::path before  = world_dir.parent_path() / (world_dir.filename().string() + ".before-restore");
+    auto target = [&](const json& e) {
+        const fs::path rel = fs::path(e.at("path").get<std::string>());
+        if (!partial) return staging / rel;
+        fs::path tmp = world_dir / rel;
+        tmp += kTmpSuffix;
+        return tmp;
+    };
+
+    std::error_code ec;
+    if (!partial) {
+        fs::remove_all(staging, ec);
+        fs::create_directories(staging);
+    }
+    std::set<fs::path> dirs;
+    for (const json* e : entries) dirs.insert(target(*e).parent_path());
+    for (const auto& d : dirs) fs::create_directories(d);
+
+    // Крупные первыми — писатели заканчивают примерно вместе
+    std::sort(entries.begin(), entries.end(), [](const json* a, const json* b) {
+        return a->at("size").get<uint64_t>() > b->at("size").get<uint64_t>();
+    });
+
+    unsigned threads = opt_.threads ? opt_.threads : (std::max)(1u, std::thread::hardware_concurrency() / 2);
+    threads = static_cast<unsigned>(std::clamp<size_t>(threads, 1, std::max<size_t>(entries.size(), 1)));
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex mx;
+    std::string error;
+
+    auto worker = [&] {
+        RestoreStats st;
+        for (size_t i; !failed && (i = next++) < entries.size(); ) {
+            const json& e = *entries[i];
+            try {
+                if (total.kind == "dedup") dedup.restore_file(e, target(e), st);
+                else                       clone.restore_file(name, e, target(e), st);
+            } catch (const std::exception& ex) {
+                std::lock_guard lg(mx);
+                if (!failed.exchange(true)) error = ex.what();
+            }
+        }
+        std::lock_guard lg(mx);
+        total.files  += st.files;
+        total.chunks += st.chunks;
+        total.bytes  += st.bytes;
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    if (failed) {
+        if (!partial) fs::remove_all(staging, ec);
+        else for (const json* e : entries) fs::remove(target(*e), ec);
+        throw std::runtime_error("восстановление прервано, мир не тронут: " + error);
+    }
+
+    /* Подмена: только переименования в пределах каталога сервера */
+    fs::remove_all(before, ec);
+    if (!partial) {
+        if (fs::exists(world_dir)) fs::rename(world_dir, before);
+        fs::rename(staging, world_dir);
+    } else {
+        for (const json* e : entries) {
+            const fs::path rel = fs::path(e->at("path").get<std::string>());
+            if (fs::exists(world_dir / rel)) move_aside(world_dir / rel, before / rel);
+            fs::rename(target(*e), world_dir / rel);
+        }
+        for (const auto& rel : extras) move_aside(world_dir / fs::path(rel), before / fs::path(rel));
+        total.removed = extras.size();
+    }
+    total.previous = before.string();
+    total.ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+
+    LOG_INFO("Восстановлено из " + name + " (" + total.kind + (partial ? ", частично" : "") + "): файлов " +
+             std::to_string(total.files) + ", объектов сверено " + std::to_string(total.chunks) +
+             ", " + std::to_string(total.bytes / (1024 * 1024)) + " МБ за " + std::to_string(total.ms) +
+             " мс; прежнее — в " + total.previous, "BACKUP");
+    return total;
+}
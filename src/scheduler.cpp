@@ -0,0 +1,587 @@
+#include "./includes/serverregistry.h"
+#include "./includes/scheduler.h"
+#include "./includes/httplib.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int64_t kGraceS    = 60;   // опоздание больше — запуск считается пропущенным
+constexpr int     kMaxSleepS = 60;   // чаще — чтобы заметить перевод часов
+
+int64_t now_s() { return static_cast<int64_t>(std::time(nullptr)); }
+
+std::tm local(int64_t t) {
+    const std::time_t tt = static_cast<std::time_t>(t);
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &tt);
+#else
+    localtime_r(&tt, &tm);
+#endif
+    return tm;
+}
+
+/* Нормализовать поля после инкремента (31 число + 1 → 1 число) */
+int64_t normalize(std::tm& tm) {
+    tm.tm_isdst = -1;
+    const int64_t t = static_cast<int64_t>(std::mktime(&tm));
+    tm = local(t);
+    return t;
+}
+
+constexpr const char* kMonths[]   = { "jan", "feb", "mar", "apr", "may", "jun",
+                                      "jul", "aug", "sep", "oct", "nov", "dec" };
+constexpr const char* kWeekdays[] = { "sun", "mon", "tue", "wed", "thu", "fri", "sat" };
+
+int field_value(std::string tok, int lo, int hi, const char* const* names, int names_base, size_t names_n) {
+    std::transform(tok.begin(), tok.end(), tok.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    for (size_t i = 0; i < names_n; ++i)
+        if (tok == names[i]) return static_cast<int>(i) + names_base;
+    if (tok.empty() || !std::all_of(tok.begin(), tok.end(), ::isdigit))
+        throw std::invalid_argument("cron: не число '" + tok + "'");
+    const int v = std::stoi(tok);
+    if (v < lo || v > hi) throw std::invalid_argument("cron: " + tok + " вне " + std::to_string(lo) + ".." + std::to_string(hi));
+    return v;
+}
+
+/* Одно поле → маска битов; any — поле ровно "*" */
+uint64_t parse_field(const std::string& field, int lo, int hi, bool& any,
+                     const char* const* names = nullptr, int names_base = 0, size_t names_n = 0) {
+    any = field == "*";
+    uint64_t mask = 0;
+    std::istringstream items(field);
+    for (std::string item; std::getline(items, item, ','); ) {
+        int step = 1;
+        const size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            step = field_value(item.substr(slash + 1), 1, hi, nullptr, 0, 0);
+            item.resize(slash);
+        }
+        int a, b;
+        if (item == "*") {
+            a = lo;
+            b = hi;
+        } else if (const size_t dash = item.find('-'); dash != std::string::npos) {
+            a = field_value(item.substr(0, dash), lo, hi, names, names_base, names_n);
+            b = field_value(item.substr(dash + 1), lo, hi, names, names_base, names_n);
+            if (a > b) throw std::invalid_argument("cron: диапазон " + item);
+        } else {
+            a = field_value(item, lo, hi, names, names_base, names_n);
+            b = slash != std::string::npos ? hi : a;   // "5/15" — с 5 до конца
+        }
+        for (int v = a; v <= b; v += step) mask |= uint64_t(1) << v;
+    }
+    if (!mask) throw std::invalid_argument("cron: пустое поле '" + field + "'");
+    return mask;
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------ */
+/*                               CRON                                 */
+/* ------------------------------------------------------------------ */
+CronExpr CronExpr::parse(const std::string& expr) {
+    static const std::pair<const char*, const char*> macros[] = {
+        { "@hourly",  "0 * * * *" }, { "@daily",   "0 0 * * *" }, { "@midnight", "0 0 * * *" },
+        { "@weekly",  "0 0 * * 0" }, { "@monthly", "0 0 1 * *" }, { "@yearly",   "0 0 1 1 *" },
+        { "@annually", "0 0 1 1 *" }
+    };
+    CronExpr c;
+    c.text_ = expr;
+    std::string body = expr;
+    if (!body.empty() && body[0] == '@') {
+        auto it = std::find_if(std::begin(macros), std::end(macros), [&](const auto& m) { return body == m.first; });
+        if (it == std::end(macros)) throw std::invalid_argument("cron: неизвестный макрос " + body);
+        body = it->second;
+    }
+
+    std::istringstream in(body);
+    std::vector<std::string> f;
+    for (std::string s; in >> s; ) f.push_back(s);
+    if (f.size() != 5) throw std::invalid_argument("cron: нужно 5 полей, а не " + std::to_string(f.size()) + ": " + expr);
+
+    bool any;
+    c.minutes_ = parse_field(f[0], 0, 59, any);
+    c.hours_   = static_cast<uint32_t>(parse_field(f[1], 0, 23, any));
+    c.days_    = static_cast<uint32_t>(parse_field(f[2], 1, 31, c.any_day_));
+    c.months_  = static_cast<uint16_t>(parse_field(f[3], 1, 12, any, kMonths, 1, 12));
+    uint64_t wd = parse_field(f[4], 0, 7, c.any_weekday_, kWeekdays, 0, 7);
+    if (wd & (1u << 7)) wd |= 1;   // 7 — тоже воскресенье
+    c.weekdays_ = static_cast<uint8_t>(wd & 0x7F);
+
+    // "30 февраля": день месяца, которого нет ни в одном выбранном месяце
+    if (c.any_weekday_) {
+        static const int max_day[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        bool possible = false;
+        for (int m = 1; m <= 12 && !possible; ++m) {
+            if (!(c.months_ >> m & 1)) continue;
+            for (int d = 1; d <= max_day[m - 1] && !possible; ++d) possible = c.days_ >> d & 1;
+        }
+        if (!possible) throw std::invalid_argument("cron: никогда не срабатывает: " + expr);
+    }
+    return c;
+}
+
+bool CronExpr::day_ok(int mday, int wday) const {
+    const bool d = days_ >> mday & 1, w = weekdays_ >> wday & 1;
+    if (!any_day_ && !any_weekday_) return d || w;
+    return d && w;
+}
+
+int64_t CronExpr::next(int64_t after) const {
+    std::tm tm = local((after / 60 + 1) * 60);
+    tm.tm_sec = 0;
+    // Крупными шагами: не тот месяц — сразу к следующему, не тот день — к следующему дню
+    for (int guard = 0; guard < 100000; ++guard) {
+        if (!(months_ >> (tm.tm_mon + 1) & 1)) {
+            ++tm.tm_mon;
+            tm.tm_mday = 1;
+            tm.tm_hour = tm.tm_min = 0;
+        } else if (!day_ok(tm.tm_mday, tm.tm_wday)) {
+            ++tm.tm_mday;
+            tm.tm_hour = tm.tm_min = 0;
+        } else if (!(hours_ >> tm.tm_hour & 1)) {
+            ++tm.tm_hour;
+            tm.tm_min = 0;
+        } else if (!(minutes_ >> tm.tm_min & 1)) {
+            ++tm.tm_min;
+        } else {
+            std::tm probe = tm;
+            const int64_t t = normalize(probe);
+            if (t > after) return t;
+            ++tm.tm_min;   // осенний перевод часов: та же минута уже была
+        }
+        normalize(tm);
+    }
+    return -1;
+}
+
+/* ------------------------------------------------------------------ */
+/*                            ПЛАНИРОВЩИК                             */
+/* ------------------------------------------------------------------ */
+Scheduler::Task Scheduler::parse_task(const json& j, bool from_api) {
+    static const char* kinds[] = { "command", "restart", "start", "stop", "backup", "webhook" };
+    Task t;
+    try {
+        t.name            = j.value("name", std::string());
+        t.action.kind     = j.at("action").get<std::string>();
+        t.action.server   = j.value("server", std::string());
+        t.action.command  = j.value("command", std::string());
+        t.action.url      = j.value("url", std::string());
+        t.action.body     = j.value("body", json::object());
+        t.action.full     = j.value("full", false);
+        t.jitter_s        = j.value("jitter_s", 0);
+        const std::string missed = j.value("missed", std::string("skip"));
+
+        if (!from_api && t.name.empty()) throw std::invalid_argument("нет name");
+        if (std::find(std::begin(kinds), std::end(kinds), t.action.kind) == std::end(kinds))
+            throw std::invalid_argument("неизвестное action '" + t.action.kind + "'");
+        if (t.action.kind == "command" && t.action.command.empty()) throw std::invalid_argument("нет command");
+        if (t.action.kind == "webhook") {
+            const bool http = t.action.url.rfind("http://", 0) == 0;
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+            const bool https = t.action.url.rfind("https://", 0) == 0;
+#else
+            const bool https = false;   // сборка без OpenSSL
+#endif
+            if (!http && !https) throw std::invalid_argument("url: ожидается http://");
+        }
+        if (missed != "skip" && missed != "run") throw std::invalid_argument("missed: skip или run");
+        t.run_missed = missed == "run";
+        if (t.jitter_s < 0) throw std::invalid_argument("jitter_s < 0");
+
+        if (j.contains("cron")) {
+            if (from_api) throw std::invalid_argument("из API — только разовые задачи (delay_s)");
+            t.cron     = CronExpr::parse(j.at("cron").get<std::string>());
+            t.has_cron = true;
+        } else if (j.contains("delay_s")) {
+            t.delay_s = j.at("delay_s").get<int64_t>();
+            if (t.delay_s < 0) throw std::invalid_argument("delay_s < 0");
+        } else {
+            throw std::invalid_argument("нужен cron или delay_s");
+        }
+    } catch (const json::exception& e) {
+        throw std::invalid_argument(e.what());
+    }
+    t.from_api = from_api;
+    return t;
+}
+
+void Scheduler::start(const json& config, ServerRegistry& servers) {
+    servers_ = &servers;
+    if (started_ || !config.value("enabled", false)) return;
+
+    started_at_ = now_s();
+    size_t count = 0;
+    {
+        std::lock_guard lk(mx_);
+        apply(config, started_at_);
+        count = tasks_.size();
+    }
+    stop_      = false;
+    exec_done_ = false;
+    started_   = true;
+    thread_  = std::thread(&Scheduler::loop, this);
+    exec_    = std::thread(&Scheduler::exec_loop, this);
+    LOG_INFO("Планировщик запущен, задач: " + std::to_string(count), "SCHED");
+}
+
+void Scheduler::reload(const json& config) {
+    if (!servers_) return;
+    if (!started_) {
+        start(config, *servers_);
+        return;
+    }
+    size_t count = 0;
+    {
+        std::lock_guard lk(mx_);
+        apply(config.value("enabled", false) ? config : json::object(), now_s());
+        count = tasks_.size();
+    }
+    cv_.notify_all();
+    LOG_INFO("Планировщик перечитан, задач: " + std::to_string(count), "SCHED");
+}
+
+/* Вызывается и из request_shutdown (Ctrl+C, закрытие консоли — там у
+   процесса ~5 с): очередь сбрасывается, текущую задачу ждём недолго. */
+void Scheduler::shutdown() {
+    if (!started_.exchange(false)) return;
+    stop_ = true;
+    size_t dropped = 0;
+    bool   idle    = false;
+    {
+        std::unique_lock q(q_mx_);
+        dropped = queue_.size();
+        queue_.clear();
+        q_cv_.notify_all();
+        idle = q_cv_.wait_for(q, kExecWait, [this] { return exec_done_; });
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    if (idle) {
+        exec_.join();
+    } else if (exec_.joinable()) {
+        LOG_WARNING("Задача планировщика не завершилась за " + std::to_string(kExecWait.count()) +
+                    " мс — завершение без неё", "SCHED");
+        exec_.detach();
+    }
+    if (dropped) LOG_INFO("Задач снято из очереди: " + std::to_string(dropped), "SCHED");
+
+    std::lock_guard lk(mx_);
+    busy_.clear();
+    save_state();
+}
+
+/* Задачи из конфига: прошлые запуски сохраняются по имени, разовые из API остаются */
+void Scheduler::apply(const json& config, int64_t now) {
+    state_file_ = config.value("state_file", state_file_);
+    if (!state_loaded_) {
+        state_loaded_ = true;
+        try {
+            std::ifstream f(state_file_);
+            if (f) {
+                const json st = json::parse(f);
+                for (const auto& [name, t] : st.items()) last_runs_[name] = t.get<int64_t>();
+            }
+        } catch (const std::exception& e) {
+            LOG_WARNING("Состояние планировщика не прочитано: " + std::string(e.what()), "SCHED");
+        }
+    }
+
+    std::unordered_map<std::string, Task> fresh;
+    for (const auto& j : config.value("tasks", json::array())) {
+        try {
+            Task t = parse_task(j, false);
+            if (fresh.count(t.name)) throw std::invalid_argument("имя уже занято");
+            if (auto old = tasks_.find(t.name); old != tasks_.end()) t.runs = old->second.runs;
+            if (auto lr = last_runs_.find(t.name); lr != last_runs_.end()) t.last_run = lr->second;
+            fresh.emplace(t.name, std::move(t));
+        } catch (const std::exception& e) {
+            LOG_WARNING("Задача " + j.value("name", std::string("?")) + " пропущена: " + e.what(), "SCHED");
+        }
+    }
+    for (auto& [name, t] : tasks_)
+        if (t.from_api && !fresh.count(name)) fresh.emplace(name, std::move(t));
+    tasks_ = std::move(fresh);
+    rearm_all(now, true);
+}
+
+void Scheduler::rearm_all(int64_t now, bool catch_up) {
+    wheel_.reset(now);
+    armed_.clear();
+    for (auto& [name, t] : tasks_) {
+        if (t.has_cron) {
+            // Пропущенный, пока MSHost не работал: выполнить сразу, если так настроено
+            const int64_t missed = t.last_run ? t.cron.next(t.last_run) : -1;
+            if (catch_up && t.run_missed && missed > 0 && missed < now - kGraceS) {
+                LOG_INFO("Задача " + name + " пропущена в " + std::to_string(missed) + ", выполняется сейчас", "SCHED");
+                t.base = missed;
+                t.due  = now;
+                t.uid  = ++next_uid_;
+                armed_[t.uid] = name;
+                wheel_.add(now, t.uid);
+                continue;
+            }
+            const int64_t next = t.cron.next(now);
+            if (next > 0) arm(t, next);
+            else          t.due = 0;
+        } else if (t.from_api) {
+            arm(t, t.base);
+        } else if (!done_once_.count(name)) {
+            arm(t, started_at_ + t.delay_s);
+        } else {
+            t.due = 0;
+        }
+    }
+}
+
+void Scheduler::arm(Task& t, int64_t base) {
+    static thread_local std::mt19937 rng{ std::random_device{}() };
+    t.base = base;
+    t.due  = base + (t.jitter_s ? std::uniform_int_distribution<int>(0, t.jitter_s)(rng) : 0);
+    t.uid  = ++next_uid_;
+    armed_[t.uid] = t.name;
+    wheel_.add(t.due, t.uid);
+}
+
+bool Scheduler::fire(Task& t, int64_t now, std::vector<Job>& now_jobs) {
+    const int64_t late = now - t.due;
+    if (late > kGraceS && !t.run_missed) {
+        LOG_WARNING("Задача " + t.name + " пропущена: опоздание " + std::to_string(late) + " с", "SCHED");
+    } else if (busy_.count(t.name)) {
+        LOG_WARNING("Задача " + t.name + " ещё выполняется, запуск пропущен", "SCHED");
+    } else {
+        t.last_run = now;
+        ++t.runs;
+        last_runs_[t.name] = now;
+        if (t.action.kind == "command") {
+            now_jobs.push_back({ t.name, t.action });
+        } else {
+            busy_.insert(t.name);
+            {
+                std::lock_guard q(q_mx_);
+                queue_.push_back({ t.name, t.action });
+            }
+            q_cv_.notify_one();
+        }
+    }
+
+    if (t.has_cron) {
+        const int64_t next = t.cron.next((std::max)(now, t.base));
+        if (next > 0) arm(t, next);
+        else          t.due = 0;
+        return true;
+    }
+    t.due = 0;
+    done_once_.insert(t.name);
+    return !t.from_api;
+}
+
+void Scheduler::loop() {
+    std::vector<TimerWheel::Entry> expired;
+    std::vector<Job> now_jobs;
+    std::unique_lock lk(mx_);
+    while (!stop_) {
+        const int64_t now = now_s();
+        if (now < wheel_.now() - 2) {
+            LOG_WARNING("Часы переведены назад, сроки задач пересчитаны", "SCHED");
+            rearm_all(now, false);
+        }
+
+        expired.clear();
+        wheel_.advance(now, expired);
+        bool ran = false;
+        for (const auto& e : expired) {
+            auto a = armed_.find(e.id);
+            if (a == armed_.end()) continue;
+            const std::string name = a->second;
+            armed_.erase(a);
+            auto it = tasks_.find(name);
+            if (it == tasks_.end() || it->second.uid != e.id) continue;   // снята или перевзведена
+            if (!fire(it->second, now, now_jobs)) tasks_.erase(it);
+            ran = true;
+        }
+        if (ran) save_state();
+
+        if (!now_jobs.empty()) {
+            std::vector<Job> jobs;
+            jobs.swap(now_jobs);
+            lk.unlock();
+            for (const auto& j : jobs) run(j);
+            lk.lock();
+            continue;   // пока выполняли, могли наступить новые сроки
+        }
+
+        // Спим до ближайшего срока колеса, а не опрашиваем задачи
+        auto wake = std::chrono::system_clock::now() + std::chrono::seconds(kMaxSleepS);
+        const int64_t due = wheel_.next_due();
+        if (due != INT64_MAX) wake = (std::min)(wake, std::chrono::system_clock::from_time_t(static_cast<std::time_t>(due)));
+        cv_.wait_for(lk, (std::max)(wake - std::chrono::system_clock::now(), std::chrono::system_clock::duration::zero()));
+    }
+}
+
+void Scheduler::exec_loop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock q(q_mx_);
+            q_cv_.wait(q, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) {
+                exec_done_ = true;
+                q_cv_.notify_all();
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        run(job);
+        std::lock_guard lk(mx_);
+        busy_.erase(job.name);
+    }
+}
+
+void Scheduler::run(const Job& job) {
+    const Action& a = job.action;
+    MinecraftServerManager* mc = a.server.empty() ? &servers_->primary() : servers_->find(a.server);
+    if (!mc) {
+        LOG_WARNING("Задача " + job.name + ": нет инстанса " + a.server, "SCHED");
+        return;
+    }
+    if (stop_ && (a.kind == "restart" || a.kind == "start")) {
+        LOG_INFO("Задача " + job.name + ": идёт завершение MSHost, " + a.kind + " пропущен", "SCHED");
+        return;
+    }
+    LOG_INFO("Задача " + job.name + ": " + a.kind + (a.kind == "command" ? " " + a.command : ""), "SCHED");
+
+    try {
+        if (a.kind == "command") {
+            if (!mc->is_running()) {
+                LOG_INFO("Задача " + job.name + ": сервер " + mc->id() + " не запущен, пропуск", "SCHED");
+                return;
+            }
+            mc->send_command(a.command);
+        } else if (a.kind == "restart") {
+            mc->restart();
+        } else if (a.kind == "start") {
+            mc->start();
+        } else if (a.kind == "stop") {
+            mc->stop();
+        } else if (a.kind == "backup") {
+            mc->backup(a.full);
+        } else if (a.kind == "webhook") {
+            const size_t host_at = a.url.find("://") + 3;
+            const size_t path_at = a.url.find('/', host_at);
+            httplib::Client cli(a.url.substr(0, path_at));
+            cli.set_connection_timeout(5);
+            cli.set_read_timeout(10);
+
+            json payload = a.body.is_object() ? a.body : json::object();
+            payload.emplace("task", job.name);
+            payload.emplace("server", mc->id());
+            payload.emplace("time", now_s());
+            auto res = cli.Post(path_at == std::string::npos ? "/" : a.url.substr(path_at), payload.dump(), "application/json");
+            if (!res) {
+                LOG_WARNING("Задача " + job.name + ": webhook не доставлен: " + httplib::to_string(res.error()), "SCHED");
+            } else if (res->status >= 300) {
+                LOG_WARNING("Задача " + job.name + ": webhook ответил " + std::to_string(res->status), "SCHED");
+            }
+        }
+    } catch (const std::exception& e) {
+        LOG_ERR("Задача " + job.name + " не выполнена: " + e.what(), "SCHED");
+    }
+}
+
+void Scheduler::save_state() {
+    json st = json::object();
+    for (const auto& [name, t] : last_runs_) st[name] = t;
+    const fs::path file(state_file_);
+    const fs::path tmp = fs::path(file).concat(".tmp");
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        f << st.dump();
+        if (!f) {
+            LOG_WARNING("Состояние планировщика не записано: " + tmp.string(), "SCHED");
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec) LOG_WARNING("Состояние планировщика не записано: " + ec.message(), "SCHED");
+}
+
+/* ---------- API ---------- */
+json Scheduler::task_json(const Task& t) const {
+    json j = {
+        {"name",     t.name},
+        {"action",   t.action.kind},
+        {"server",   t.action.server.empty() ? servers_->primary().id() : t.action.server},
+        {"next",     t.due ? json(t.due) : json()},
+        {"last_run", t.last_run ? json(t.last_run) : json()},
+        {"runs",     t.runs},
+        {"jitter_s", t.jitter_s},
+        {"missed",   t.run_missed ? "run" : "skip"},
+        {"running",  busy_.count(t.name) > 0}
+    };
+    if (t.has_cron) j["cron"] = t.cron.text();
+    else            j["delay_s"] = t.delay_s;
+    if (t.action.kind == "command") j["command"] = t.action.command;
+    return j;
+}
+
+json Scheduler::to_json() const {
+    json list = json::array();
+    if (started_) {
+        std::lock_guard lk(mx_);
+        for (const auto& [name, t] : tasks_) list.push_back(task_json(t));
+    }
+    std::sort(list.begin(), list.end(), [](const json& a, const json& b) {
+        const int64_t x = a["next"].is_null() ? INT64_MAX : a["next"].get<int64_t>();
+        const int64_t y = b["next"].is_null() ? INT64_MAX : b["next"].get<int64_t>();
+        return x < y;
+    });
+    return { {"enabled", started_.load()}, {"tasks", list} };
+}
+
+json Scheduler::add_once(const json& task) {
+    if (!started_) throw std::invalid_argument("планировщик выключен (scheduler.enabled)");
+    Task t = parse_task(task, true);
+    json out;
+    {
+        std::lock_guard lk(mx_);
+        if (t.name.empty()) t.name = "once-" + std::to_string(++once_seq_);
+        if (tasks_.count(t.name)) throw std::invalid_argument("задача " + t.name + " уже есть");
+        if (!t.action.server.empty() && !servers_->find(t.action.server))
+            throw std::invalid_argument("нет инстанса " + t.action.server);
+        Task& placed = tasks_.emplace(t.name, std::move(t)).first->second;
+        arm(placed, now_s() + placed.delay_s);
+        out = task_json(placed);
+    }
+    cv_.notify_all();
+    LOG_INFO("Разовая задача " + out["name"].get<std::string>() + ": " + out["action"].get<std::string>() +
+             " через " + std::to_string(out["delay_s"].get<int64_t>()) + " с", "SCHED");
+    return out;
+}
+
+bool Scheduler::cancel(const std::string& name) {
+    std::lock_guard lk(mx_);
+    auto it = tasks_.find(name);
+    if (it == tasks_.end()) return false;
+    armed_.erase(it->second.uid);   // запись в колесе истечёт вхолостую
+    tasks_.erase(it);
+    LOG_INFO("Задача " + name + " снята", "SCHED");
+    return true;
+}
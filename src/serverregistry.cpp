@@ -0,0 +1,68 @@
+#include "./includes/serverregistry.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+#include <thread>
+#include <unordered_set>
+
+ServerRegistry::ServerRegistry(const json& config) {
+    for (auto& [id, inst] : instance_configs(config)) {
+        servers_.push_back(std::make_unique<MinecraftServerManager>(inst, id));
+        if (config.contains("servers")) LOG_INFO("Инстанс зарегистрирован: " + id, "MAIN");
+    }
+}
+
+std::vector<std::pair<std::string, json>> ServerRegistry::instance_configs(const json& config) {
+    if (!config.contains("servers")) return { { "main", config } };
+
+    const auto& list = config["servers"];
+    if (!list.is_array() || list.empty()) {
+        throw std::runtime_error("config.json: \"servers\" должен быть непустым массивом");
+    }
+
+    std::vector<std::pair<std::string, json>> out;
+    std::unordered_set<std::string> ids;
+    for (const auto& inst : list) {
+        std::string id = inst.value("id", "");
+        if (id.empty())              throw std::runtime_error("config.json: у инстанса нет \"id\"");
+        if (!ids.insert(id).second)  throw std::runtime_error("config.json: повтор id \"" + id + "\"");
+
+        // Менеджер ждёт {"java": ..., "server": ...}
+        json java = config.value("java", json::object());
+        if (inst.contains("java")) java.merge_patch(inst["java"]);
+
+        json server = inst;
+        server.erase("java");
+
+        out.emplace_back(id, json{ {"java", java}, {"server", server} });
+    }
+    return out;
+}
+
+void ServerRegistry::reload(const json& config) {
+    auto configs = instance_configs(config);
+
+    for (auto& [id, inst] : configs) {
+        if (auto* s = find(id)) s->reload_config(inst);
+        else LOG_WARNING("Новый инстанс " + id + " появится после перезапуска mshost", "MAIN");
+    }
+    for (const auto& s : servers_) {
+        bool kept = std::any_of(configs.begin(), configs.end(),
+                                [&](const auto& c) { return c.first == s->id(); });
+        if (!kept) LOG_WARNING("Инстанс " + s->id() + " убран из конфига, но работает до перезапуска mshost", "MAIN");
+    }
+}
+
+MinecraftServerManager* ServerRegistry::find(const std::string& id) const {
+    for (const auto& s : servers_) {
+        if (s->id() == id) return s.get();
+    }
+    return nullptr;
+}
+
+/* Останавливаем параллельно: у каждого свой отсчёт и save-all */
+void ServerRegistry::stop_all() {
+    std::vector<std::thread> stoppers;
+    for (const auto& s : servers_) stoppers.emplace_back(&MinecraftServerManager::stop, s.get());
+    for (auto& t : stoppers) t.join();
+}
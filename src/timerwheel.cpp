@@ -0,0 +1,118 @@
+#include "./includes/timerwheel.h"
+
+#include <climits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+inline int ctz64(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return static_cast<int>(i);
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+inline int64_t span(int level) { return int64_t(1) << (TimerWheel::kBits * level); }   // секунд в слоте
+
+} // namespace
+
+void TimerWheel::reset(int64_t now) {
+    for (auto& level : slots_)
+        for (auto& slot : level) slot.clear();
+    occupied_.fill(0);
+    overdue_.clear();
+    size_ = 0;
+    now_  = now;
+}
+
+void TimerWheel::add(int64_t due, uint64_t id) {
+    ++size_;
+    place({ due, id });
+}
+
+void TimerWheel::place(const Entry& e) {
+    if (e.due <= now_) {
+        overdue_.push_back(e);
+        return;
+    }
+    const uint64_t diff = uint64_t(e.due) ^ uint64_t(now_);
+    int level = 0;
+    while (level < kLevels - 1 && (diff >> (kBits * (level + 1)))) ++level;
+
+    int slot = static_cast<int>((e.due >> (kBits * level)) & (kSlots - 1));
+    if ((diff >> (kBits * kLevels)) && e.due - now_ >= span(kLevels)) {
+        // Дальше диапазона: слот, до которого колесо дойдёт последним.
+        // Ближе — срок в следующем блоке верхнего уровня, слот «позади» текущего
+        slot = static_cast<int>(((now_ >> (kBits * level)) - 1) & (kSlots - 1));
+    }
+    slots_[level][slot].push_back(e);
+    occupied_[level] |= uint64_t(1) << slot;
+}
+
+int64_t TimerWheel::next_due() const {
+    if (!overdue_.empty()) return now_;
+    int64_t best = INT64_MAX;
+    for (int level = 0; level < kLevels; ++level) {
+        if (!occupied_[level]) continue;
+        const int     shift = kBits * level;
+        const int     cur   = static_cast<int>((now_ >> shift) & (kSlots - 1));
+        const int64_t block = now_ & ~(span(level + 1) - 1);   // начало блока уровня выше
+        const uint64_t ahead = cur == kSlots - 1 ? 0 : occupied_[level] & (~uint64_t(0) << (cur + 1));
+        int64_t t;
+        if (ahead)                     t = block + (int64_t(ctz64(ahead)) << shift);
+        else if (level == kLevels - 1) t = block + span(kLevels) + (int64_t(ctz64(occupied_[level])) << shift);
+        else                           continue;   // не бывает: слоты уровня всегда впереди текущего
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+void TimerWheel::tick(int64_t t, std::vector<Entry>& expired) {
+    now_ = t;
+    // Сначала верхние уровни: разложенное может попасть в слот, который разбирается следом
+    for (int level = kLevels - 1; level >= 1; --level) {
+        if (t & (span(level) - 1)) continue;
+        const int slot = static_cast<int>((t >> (kBits * level)) & (kSlots - 1));
+        if (!(occupied_[level] >> slot & 1)) continue;
+        std::vector<Entry> moved;
+        moved.swap(slots_[level][slot]);
+        occupied_[level] &= ~(uint64_t(1) << slot);
+        for (const auto& e : moved) place(e);
+    }
+
+    const int slot = static_cast<int>(t & (kSlots - 1));
+    if (occupied_[0] >> slot & 1) {
+        for (const auto& e : slots_[0][slot]) expired.push_back(e);
+        size_ -= slots_[0][slot].size();
+        slots_[0][slot].clear();
+        occupied_[0] &= ~(uint64_t(1) << slot);
+    }
+    if (!overdue_.empty()) {
+        expired.insert(expired.end(), overdue_.begin(), overdue_.end());
+        size_ -= overdue_.size();
+        overdue_.clear();
+    }
+}
+
+void TimerWheel::advance(int64_t to, std::vector<Entry>& expired) {
+    if (!overdue_.empty()) {
+        expired.insert(expired.end(), overdue_.begin(), overdue_.end());
+        size_ -= overdue_.size();
+        overdue_.clear();
+    }
+    // Прыжками от события к событию: пустые секунды не перебираются
+    while (now_ < to) {
+        const int64_t t = next_due();
+        if (t > to) {
+            now_ = to;
+            break;
+        }
+        tick(t <= now_ ? now_ + 1 : t, expired);
+    }
+}
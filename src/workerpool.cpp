@@ -0,0 +1,146 @@
+#include "./includes/workerpool.h"
+#include "./includes/logger.h"
+
+#include <algorithm>
+
+namespace {
+    // Держит ли текущий поток bulk-слот (один запрос за раз на поток)
+    thread_local bool t_holds_bulk = false;
+}
+
+WorkerPool::Options WorkerPool::Options::from_json(const nlohmann::json& pool) {
+    Options o;
+    if (!pool.is_object()) return o;
+    o.threads      = pool.value("threads",      o.threads);
+    o.bulk_threads = pool.value("bulk_threads", o.bulk_threads);
+    o.bulk_wait_ms = pool.value("bulk_wait_ms", o.bulk_wait_ms);
+    o.max_queue    = pool.value("max_queue",    o.max_queue);
+    o.shed_queue   = pool.value("shed_queue",   o.shed_queue);
+
+    if (o.threads < 2) o.threads = 2;
+    // Хотя бы один поток всегда свободен для control
+    o.bulk_threads = std::clamp<size_t>(o.bulk_threads, 1, o.threads - 1);
+    return o;
+}
+
+WorkerPool::WorkerPool(Options opt)
+    : opt_(opt),
+      queue_wait_(Metrics::instance().histogram("web.queue_wait_us")),
+      depth_gauge_(Metrics::instance().gauge("web.queue_depth")),
+      bulk_gauge_(Metrics::instance().gauge("web.bulk_active")),
+      bulk_waiting_gauge_(Metrics::instance().gauge("web.bulk_waiting")),
+      shed_total_(Metrics::instance().counter("web.shed")),
+      rejected_total_(Metrics::instance().counter("web.rejected"))
+{
+    for (size_t i = 0; i < opt_.threads; ++i) threads_.emplace_back(&WorkerPool::worker, this);
+    LOG_INFO("Пул HTTP: потоков " + std::to_string(opt_.threads) +
+             ", bulk до " + std::to_string(opt_.bulk_threads), "WEB");
+}
+
+bool WorkerPool::enqueue(std::function<void()> fn) {
+    {
+        std::lock_guard lg(mx_);
+        if (stop_) return false;
+        if (opt_.max_queue && jobs_.size() >= opt_.max_queue) {
+            ++rejected_total_;
+            return false;   // httplib закроет сокет
+        }
+        jobs_.push_back({ std::move(fn), std::chrono::steady_clock::now() });
+        depth_gauge_ = static_cast<int64_t>(++depth_);
+    }
+    cv_.notify_one();
+    if (depth() > opt_.shed_queue) {
+        std::lock_guard lg(bulk_mx_);   // ждущие bulk уступают потоки очереди
+        bulk_cv_.notify_all();
+    }
+    return true;
+}
+
+void WorkerPool::shutdown() {
+    {
+        std::lock_guard lg(mx_);
+        stop_ = true;
+    }
+    {
+        std::lock_guard lg(bulk_mx_);
+        closing_ = true;
+    }
+    bulk_cv_.notify_all();
+    cv_.notify_all();
+    for (auto& t : threads_) t.join();
+    threads_.clear();
+}
+
+void WorkerPool::worker() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock lk(mx_);
+            cv_.wait(lk, [this] { return stop_ || !jobs_.empty(); });
+            if (stop_ && jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+            depth_gauge_ = static_cast<int64_t>(--depth_);
+        }
+
+        queue_wait_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - job.queued).count());
+
+        try {
+            job.fn();
+        } catch (const std::exception& ex) {
+            LOG_ERR(std::string("[pool] Exception: ") + ex.what(), "WEB");
+        } catch (...) {
+            LOG_ERR("[pool] Unknown exception.", "WEB");
+        }
+        release();   // соединение оборвалось до logger — слот не должен потеряться
+    }
+}
+
+WorkerPool::Lane WorkerPool::lane_of(const std::string& path) {
+    if (path.rfind("/api/", 0) != 0)            return Lane::Control;   // статика сайта: мелкая, грузится пачкой
+    if (path == "/api/download-modpack")         return Lane::Bulk;
+    if (path.rfind("/api/logs", 0) == 0)         return Lane::Bulk;   // и /api/logs/query
+    if (path.size() > 5 && path.compare(path.size() - 5, 5, "/logs") == 0) return Lane::Bulk;
+    if (path.size() > 6 && path.compare(path.size() - 6, 6, "/world") == 0) return Lane::Bulk;   // обход регионов
+    if (path.size() > 12 && path.compare(path.size() - 12, 12, "/world/prune") == 0) return Lane::Bulk;
+    return Lane::Control;
+}
+
+bool WorkerPool::admit(Lane lane) {
+    if (lane == Lane::Control) return true;
+
+    release();   // следующий запрос того же keep-alive соединения
+    auto shed = [this] {
+        ++shed_total_;
+        return false;
+    };
+    if (depth() > opt_.shed_queue) return shed();
+
+    std::unique_lock lk(bulk_mx_);
+    if (bulk_active_ >= opt_.bulk_threads) {
+        // Последний свободный поток пула не отдаём под ожидание
+        if (bulk_active_ + bulk_waiting_ + 1 >= opt_.threads) return shed();
+
+        bulk_waiting_gauge_ = static_cast<int64_t>(++bulk_waiting_);
+        const bool got = bulk_cv_.wait_for(lk, std::chrono::milliseconds(opt_.bulk_wait_ms), [this] {
+            return bulk_active_ < opt_.bulk_threads || closing_ || depth() > opt_.shed_queue;
+        });
+        bulk_waiting_gauge_ = static_cast<int64_t>(--bulk_waiting_);
+        if (!got || bulk_active_ >= opt_.bulk_threads) return shed();
+    }
+
+    t_holds_bulk = true;
+    bulk_gauge_  = static_cast<int64_t>(++bulk_active_);
+    return true;
+}
+
+void WorkerPool::release() {
+    if (!t_holds_bulk) return;
+    t_holds_bulk = false;
+    {
+        std::lock_guard lg(bulk_mx_);
+        bulk_gauge_ = static_cast<int64_t>(--bulk_active_);
+    }
+    bulk_cv_.notify_one();
+}
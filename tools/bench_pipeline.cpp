@@ -0,0 +1,228 @@
+// Приём консоли инстанса: пайп → ProcessHub → Logger → LineRing.
+//
+//   cmake -DMSHOST_BUILD_TOOLS=ON     (нужен Google Benchmark в CMAKE_PREFIX_PATH)
+//   mshost_bench
+//   mshost_bench --benchmark_filter=Pipeline --benchmark_format=json
+//
+// Pipeline/<вид> — настоящий анонимный пайп, как у дочернего процесса:
+// основной поток пишет строки пачками, поток ProcessHub вычитывает их и
+// делает то же, что MinecraftServerManager::handle_line. Пайп с буфером
+// по умолчанию: пока конвейер не успевает, WriteFile стоит — так же, как
+// стоял бы System.out у JVM.
+//
+// Счётчики:
+//   lines/s, bytes_per_second  — пропускная способность
+//   allocs/line                — operator new в потоке ProcessHub на строку
+//   p99_us                     — от WriteFile строки до LineRing
+// Logger/<вид> и LineRing — отдельные стадии для сравнения.
+
+#include <benchmark/benchmark.h>
+
+#include "processhub.h"
+#include "logger.h"
+#include "linering.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+/* ---------- Подсчёт выделений памяти (только в отмеченных потоках) ---------- */
+namespace {
+    std::atomic<uint64_t> g_allocs{0};
+    thread_local bool     t_count_allocs = false;
+}
+
+void* operator new(std::size_t n) {
+    if (t_count_allocs) g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept              { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Kind { Short, StackTrace, InvalidUtf8, Cyrillic };
+
+const char* kind_name(int k) {
+    static const char* names[] = { "short", "stacktrace_4k", "invalid_utf8", "cyrillic" };
+    return names[k];
+}
+
+std::string payload(int k) {
+    switch (k) {
+    case StackTrace: {
+        std::string s = "[Server thread/ERROR] [minecraft/MinecraftServer]: Encountered an unexpected exception "
+                        "java.lang.IllegalStateException: tick";
+        while (s.size() < 4096) s += " at net.minecraftforge.eventbus.EventBus.post(EventBus.java:315)";
+        s.resize(4096);
+        return s;
+    }
+    case InvalidUtf8: {
+        std::string s = "[Server thread/WARN] [mod/Broken]: ";
+        for (int i = 0; i < 30; ++i) s += "\xC3\x28\xFF\xA0\xA1";   // обрывки и запрещённые байты
+        return s;
+    }
+    case Cyrillic:
+        return "[Server thread/INFO] [minecraft/MinecraftServer]: <Игрок> Всем привет, сервер сегодня "
+               "работает отлично, ждём вечернего ивента!";
+    default:
+        return "[Server thread/INFO] [minecraft/MinecraftServer]: Steve joined the game";
+    }
+}
+
+double p99(std::vector<uint32_t>& v) {
+    if (v.empty()) return 0;
+    const size_t idx = static_cast<size_t>(0.99 * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + idx, v.end());
+    return v[idx];
+}
+
+/* ------------------------------------------------------------------ */
+/*                 Пайп → ProcessHub → Logger → LineRing              */
+/* ------------------------------------------------------------------ */
+void BM_Pipeline(benchmark::State& state) {
+    constexpr size_t kBatch = 20000;    // строк за итерацию
+    constexpr size_t kChunk = 16 * 1024;
+    const std::string body = payload(static_cast<int>(state.range(0)));
+
+    // Пачка заранее: "<seq> <текст>\n" — поток записи не выделяет память
+    std::string batch;
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < kBatch; ++i) {
+        starts.push_back(batch.size());
+        batch += std::to_string(i) + ' ' + body + '\n';
+    }
+
+    HANDLE rd = nullptr, wr = nullptr;
+    if (!CreatePipe(&rd, &wr, nullptr, 0)) {
+        state.SkipWithError("CreatePipe");
+        return;
+    }
+    HANDLE alive = CreateEventA(nullptr, TRUE, FALSE, nullptr);   // «процесс», который не завершается
+
+    LineRing ring(500);
+    std::vector<Clock::time_point> sent(kBatch);
+    std::vector<uint32_t> lat(kBatch), all_lat;
+    std::mutex mx;
+    std::condition_variable cv;
+    size_t received = 0;
+    bool   failed   = false;   // запись в пайп сломалась — строк не дождаться
+
+    const int id = ProcessHub::instance().attach(rd, alive, [&](const std::string& line) {
+        t_count_allocs = true;   // поток ProcessHub
+        const size_t seq = std::strtoull(line.c_str(), nullptr, 10) % kBatch;
+        lat[seq] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - sent[seq]).count());
+
+        ring.push(line);
+        LOG_INFO(line, "MC_OUT:bench");
+
+        std::lock_guard lg(mx);
+        if (++received == kBatch) cv.notify_one();
+    }, [] {});
+
+    uint64_t lines = 0;
+    const uint64_t allocs0 = g_allocs.load();
+
+    for (auto _ : state) {
+        {
+            std::lock_guard lg(mx);
+            received = 0;
+        }
+
+        size_t line = 0;
+        for (size_t off = 0; off < batch.size() && !failed; off += kChunk) {
+            const size_t n = (std::min)(kChunk, batch.size() - off);
+            const auto now = Clock::now();
+            while (line < kBatch && starts[line] < off + n) sent[line++] = now;
+
+            DWORD written = 0;
+            for (size_t done = 0; done < n; done += written) {
+                if (!WriteFile(wr, batch.data() + off + done, static_cast<DWORD>(n - done), &written, nullptr)) {
+                    state.SkipWithError("WriteFile");
+                    {
+                        std::lock_guard lg(mx);
+                        failed = true;
+                    }
+                    cv.notify_one();
+                    break;
+                }
+            }
+        }
+
+        std::unique_lock lk(mx);
+        cv.wait(lk, [&] { return received == kBatch || failed; });
+        if (failed) break;
+        lk.unlock();
+        lines += kBatch;
+
+        state.PauseTiming();
+        all_lat.insert(all_lat.end(), lat.begin(), lat.end());
+        state.ResumeTiming();
+    }
+
+    ProcessHub::instance().detach(id);
+    CloseHandle(wr);
+    CloseHandle(rd);
+    CloseHandle(alive);
+
+    state.SetLabel(kind_name(static_cast<int>(state.range(0))));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * batch.size()));
+    state.counters["lines/s"]     = benchmark::Counter(static_cast<double>(lines), benchmark::Counter::kIsRate);
+    state.counters["allocs/line"] = static_cast<double>(g_allocs.load() - allocs0) / std::max<uint64_t>(lines, 1);
+    state.counters["p99_us"]      = p99(all_lat);
+}
+BENCHMARK(BM_Pipeline)->DenseRange(Short, Cyrillic)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/* ---------- Отдельные стадии ---------- */
+void BM_Logger(benchmark::State& state) {
+    const std::string line = payload(static_cast<int>(state.range(0)));
+    t_count_allocs = true;
+    const uint64_t allocs0 = g_allocs.load();
+
+    for (auto _ : state) LOG_INFO(line, "MC_OUT:bench");
+
+    t_count_allocs = false;
+    state.SetLabel(kind_name(static_cast<int>(state.range(0))));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * line.size()));
+    state.counters["allocs/line"] = static_cast<double>(g_allocs.load() - allocs0) / state.iterations();
+}
+BENCHMARK(BM_Logger)->DenseRange(Short, Cyrillic);
+
+void BM_LineRing(benchmark::State& state) {
+    const std::string line = payload(Short);
+    LineRing ring(500);
+    for (auto _ : state) ring.push(line);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LineRing);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Логи прогона — во временный каталог, не в рабочий
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "mshost_bench" / "run";
+    fs::create_directories(dir);
+    fs::current_path(dir);
+    Logger::instance().init(false, "server.log", "web.log");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    ProcessHub::instance().shutdown();
+    Logger::instance().finalize();
+    return 0;
+}
@@ -0,0 +1,361 @@
+// Подставной Minecraft-сервер: консольный протокол без JVM и 16 ГБ Forge.
+//
+//   "java_path": "bin/mshost_fake_mc"   — в config.json инстанса
+//   "jvm_args": ["--fake-speed=10", "--fake-burst=2000"]
+//
+// Свои ключи — только вида --fake-xxx=значение, всё остальное (аргументы
+// JVM, -jar, nogui) пропускается. Те же ключи можно положить в переменную
+// окружения FAKE_MC_ARGS через пробел.
+//
+//   --fake-boot-log=FILE   проиграть записанный лог загрузки (паузы — по
+//                          меткам [HH:MM:SS]); без него — встроенная загрузка
+//   --fake-boot-ms=3000    длительность встроенной загрузки
+//   --fake-speed=1         ускорение пауз (0 — без пауз)
+//   --fake-stop-ms=500     сохранение мира при stop
+//   --fake-burst=N         после загрузки N строк/с ...
+//   --fake-burst-s=S       ... S секунд (0 — до остановки)
+//   --fake-line-bytes=120  длина строки всплеска
+//   --fake-crash-after=S   упасть через S секунд после старта
+//   --fake-hang-after=S    зависнуть через S секунд после старта
+//   --fake-exit-code=1     код выхода при падении
+//   --fake-level=world     мир, чей session.lock берётся перед
+//                          "Starting minecraft server version", как в Main
+//                          Forge; занят — выход с "already locked"
+//
+// Команды stdin: stop, save-all [flush], say, list, а также служебные
+//   fake:burst <строк/с> <секунд>, fake:crash [код], fake:hang [секунд].
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Args {
+    std::string boot_log;
+    int    boot_ms     = 3000;
+    double speed       = 1.0;
+    int    stop_ms     = 500;
+    int    burst       = 0;
+    int    burst_s     = 0;
+    int    line_bytes  = 120;
+    int    crash_after = -1;
+    int    hang_after  = -1;
+    int    exit_code   = 1;
+    std::string level  = "world";
+};
+
+void apply_arg(const std::string& arg, Args& a) {
+    if (arg.rfind("--fake-", 0) != 0) return;   // аргументы JVM и прочее
+    const auto eq = arg.find('=');
+    const std::string key = arg.substr(7, eq == std::string::npos ? std::string::npos : eq - 7);
+    const std::string val = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    if      (key == "boot-log")    a.boot_log    = val;
+    else if (key == "boot-ms")     a.boot_ms     = std::atoi(val.c_str());
+    else if (key == "speed")       a.speed       = std::atof(val.c_str());
+    else if (key == "stop-ms")     a.stop_ms     = std::atoi(val.c_str());
+    else if (key == "burst")       a.burst       = std::atoi(val.c_str());
+    else if (key == "burst-s")     a.burst_s     = std::atoi(val.c_str());
+    else if (key == "line-bytes")  a.line_bytes  = std::atoi(val.c_str());
+    else if (key == "crash-after") a.crash_after = std::atoi(val.c_str());
+    else if (key == "hang-after")  a.hang_after  = std::atoi(val.c_str());
+    else if (key == "exit-code")   a.exit_code   = std::atoi(val.c_str());
+    else if (key == "level")       a.level       = val;
+    else std::fprintf(stderr, "fake_mc: неизвестный ключ %s\n", arg.c_str());
+}
+
+/* ---------- Вывод: строка целиком и сразу, как у java-консоли ---------- */
+std::mutex g_out_mx;
+const Clock::time_point g_started = Clock::now();
+
+std::string stamp() {
+    const std::time_t now = std::time(nullptr);
+    char buf[16];
+    std::strftime(buf, sizeof(buf), "[%H:%M:%S]", std::localtime(&now));
+    return buf;
+}
+
+void emit(const std::string& body) {
+    const std::string line = stamp() + " " + body + "\n";
+    std::lock_guard lg(g_out_mx);
+    std::fwrite(line.data(), 1, line.size(), stdout);
+    std::fflush(stdout);
+}
+
+void server(const std::string& msg) { emit("[Server thread/INFO] [minecraft/DedicatedServer]: " + msg); }
+
+void pause_ms(double ms, double speed) {
+    if (speed <= 0 || ms <= 0) return;
+    std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(ms * 1000 / speed)));
+}
+
+double seconds_since_start() {
+    return std::chrono::duration<double>(Clock::now() - g_started).count();
+}
+
+/* ---------- Падение и зависание ---------- */
+[[noreturn]] void crash(int code) {
+    {
+        std::lock_guard lg(g_out_mx);
+        std::fputs("---- Minecraft Crash Report ----\n"
+                   "// Fake server crashed on purpose.\n"
+                   "Description: Exception in server tick loop\n"
+                   "java.lang.NullPointerException: Cannot invoke \"Object.hashCode()\" because \"key\" is null\n"
+                   "\tat net.minecraft.server.MinecraftServer.tickServer(MinecraftServer.java:812)\n"
+                   "\tat net.minecraft.server.MinecraftServer.runServer(MinecraftServer.java:659)\n", stdout);
+        std::fflush(stdout);
+    }
+    std::_Exit(code);
+}
+
+/* Держит мьютекс вывода: ни строк, ни ответов на команды, stop тоже не
+   проходит — как у сервера, застрявшего в тике. seconds <= 0 — навсегда. */
+void hang(int seconds) {
+    std::lock_guard lg(g_out_mx);
+    if (seconds <= 0) for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+}
+
+/* ---------- session.lock ----------
+   Как FileChannel.tryLock у JVM: исключительная блокировка всего файла,
+   держится до выхода процесса. Второй экземпляр на том же мире падает. */
+void lock_world(const Args& a) {
+    const std::string dir = a.level, path = dir + "/session.lock";
+    bool locked = false;
+#ifdef _WIN32
+    CreateDirectoryA(dir.c_str(), nullptr);
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h != INVALID_HANDLE_VALUE) {
+        OVERLAPPED ov{};
+        locked = LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY,
+                            0, MAXDWORD, MAXDWORD, &ov) != FALSE;
+        if (!locked) CloseHandle(h);   // иначе хендл живёт до выхода
+    }
+#else
+    mkdir(dir.c_str(), 0755);
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0) {
+        struct flock fl{};
+        fl.l_type   = F_WRLCK;
+        fl.l_whence = SEEK_SET;
+        locked = fcntl(fd, F_SETLK, &fl) == 0;
+        if (!locked) close(fd);
+    }
+#endif
+    if (locked) return;
+    emit("[main/ERROR] [minecraft/Main]: Failed to start the minecraft server");
+    {
+        std::lock_guard lg(g_out_mx);
+        std::fputs(("net.minecraft.world.level.storage.LevelStorageSource$LevelStorageAccess: " + path +
+                    ": already locked (possibly by other Minecraft instance?)\n").c_str(), stdout);
+        std::fflush(stdout);
+    }
+    std::_Exit(1);
+}
+
+/* ---------- Загрузка ---------- */
+int parse_hms(const std::string& line) {
+    if (line.size() < 10 || line[0] != '[' || line[3] != ':' || line[6] != ':' || line[9] != ']') return -1;
+    for (int i : { 1, 2, 4, 5, 7, 8 }) if (line[i] < '0' || line[i] > '9') return -1;
+    return ((line[1] - '0') * 10 + (line[2] - '0')) * 3600 +
+           ((line[4] - '0') * 10 + (line[5] - '0')) * 60 +
+           ((line[7] - '0') * 10 + (line[8] - '0'));
+}
+
+void replay_boot(const Args& a) {
+    std::ifstream in(a.boot_log);
+    if (!in) {
+        std::fprintf(stderr, "fake_mc: не открыть %s\n", a.boot_log.c_str());
+        std::exit(2);
+    }
+
+    bool took = false, locked = false;
+    int prev = -1;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        const int t = parse_hms(line);
+        if (t >= 0) {
+            if (prev >= 0) pause_ms(((t - prev + 86400) % 86400) * 1000.0, a.speed);
+            prev = t;
+            line.erase(0, line.size() > 10 && line[10] == ' ' ? 11 : 10);   // метку ставим свою
+        }
+        took |= line.find("Dedicated server took") != std::string::npos;
+        if (!locked && line.find("Starting minecraft server version") != std::string::npos) {
+            lock_world(a);
+            locked = true;
+        }
+        emit(line);
+    }
+    if (!locked) lock_world(a);
+    if (!took) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.3f", seconds_since_start());
+        server(std::string("Dedicated server took ") + buf + " seconds to load");
+    }
+}
+
+void builtin_boot(const Args& a) {
+    const std::vector<std::string> steps = {
+        "[main/INFO] [cpw.mods.modlauncher.Launcher/MODLAUNCHER]: ModLauncher running: args [--launchTarget, forgeserver]",
+        "[main/INFO] [net.minecraftforge.fml.loading.moddiscovery.ModDiscoverer/SCAN]: Found 0 mod jars (fake)",
+        "[main/INFO] [cpw.mods.modlauncher.LaunchServiceHandler/MODLAUNCHER]: Launching target 'forgeserver' with arguments [nogui]",
+        "",   // Main: загрузка модов, захват session.lock
+        "[Server thread/INFO] [minecraft/DedicatedServer]: Starting minecraft server version 1.20.1",
+        "[Server thread/INFO] [minecraft/DedicatedServer]: Loading properties",
+        "[Server thread/INFO] [minecraft/DedicatedServer]: Default game type: SURVIVAL",
+        "[Server thread/INFO] [minecraft/DedicatedServer]: Starting Minecraft server on *:25565",
+        "[Server thread/INFO] [minecraft/MinecraftServer]: Preparing level \"world\"",
+        "[Worker-Main-1/INFO] [minecraft/LoggingChunkProgressListener]: Preparing spawn area: 0%",
+        "[Worker-Main-1/INFO] [minecraft/LoggingChunkProgressListener]: Preparing spawn area: 51%",
+        "[Server thread/INFO] [minecraft/LoggingChunkProgressListener]: Time elapsed: 1234 ms",
+    };
+    for (const auto& s : steps) {
+        pause_ms(static_cast<double>(a.boot_ms) / steps.size(), a.speed);
+        if (s.empty()) lock_world(a);
+        else           emit(s);
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.3f", seconds_since_start());
+    server(std::string("Done (") + buf + "s)! For help, type \"help\"");
+    server(std::string("Dedicated server took ") + buf + " seconds to load");
+}
+
+/* ---------- Поток строк N/с ---------- */
+void burst(int rate, int seconds, int line_bytes) {
+    if (rate <= 0) return;
+    const std::string pad(static_cast<size_t>((std::max)(line_bytes - 60, 0)), 'x');
+    const auto step = std::chrono::nanoseconds(1000000000LL / rate);
+    const auto until = seconds > 0 ? Clock::now() + std::chrono::seconds(seconds) : Clock::time_point::max();
+
+    auto next = Clock::now();
+    for (uint64_t n = 0; Clock::now() < until; ++n) {
+        emit("[Server thread/INFO] [fake/Burst]: line " + std::to_string(n) + " " + pad);
+        next += step;
+        std::this_thread::sleep_until(next);   // отстали — догоняем без пауз
+    }
+}
+
+/* ---------- Команды ---------- */
+void stop_server(const Args& a) {
+    server("Stopping server");
+    emit("[Server thread/INFO] [minecraft/MinecraftServer]: Saving players");
+    emit("[Server thread/INFO] [minecraft/MinecraftServer]: Saving worlds");
+    pause_ms(a.stop_ms, 1.0);
+    emit("[Server thread/INFO] [minecraft/MinecraftServer]: Saving chunks for level 'ServerLevel[world]'/minecraft:overworld");
+    emit("[Server thread/INFO] [minecraft/ChunkMap]: ThreadedAnvilChunkStorage (world): All chunks are saved");
+    emit("[Server thread/INFO] [minecraft/ChunkMap]: ThreadedAnvilChunkStorage: All dimensions are saved");
+    std::fflush(stdout);
+    std::_Exit(0);
+}
+
+void handle(const std::string& cmd, const Args& a) {
+    std::istringstream in(cmd);
+    std::string verb;
+    in >> verb;
+
+    if (verb == "stop") {
+        stop_server(a);
+    } else if (verb == "save-all") {
+        emit("[Server thread/INFO] [minecraft/MinecraftServer]: Saving the game (this may take a moment!)");
+        pause_ms(a.stop_ms, 1.0);
+        emit("[Server thread/INFO] [minecraft/MinecraftServer]: Saved the game");
+    } else if (verb == "say") {
+        emit("[Server thread/INFO] [minecraft/MinecraftServer]: [Server]" + cmd.substr(3));
+    } else if (verb == "list") {
+        emit("[Server thread/INFO] [minecraft/MinecraftServer]: There are 0 of a max of 20 players online: ");
+    } else if (verb == "fake:burst") {
+        int rate = 1000, seconds = 5;
+        in >> rate >> seconds;
+        std::thread(burst, rate, seconds, a.line_bytes).detach();
+    } else if (verb == "fake:crash") {
+        int code = a.exit_code;
+        in >> code;
+        crash(code);
+    } else if (verb == "fake:hang") {
+        int seconds = 0;
+        in >> seconds;
+        hang(seconds);
+    } else if (!verb.empty()) {
+        emit("[Server thread/INFO] [minecraft/MinecraftServer]: Unknown or incomplete command, see below for error");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args a;
+    if (const char* env = std::getenv("FAKE_MC_ARGS")) {
+        std::istringstream in(env);
+        for (std::string arg; in >> arg; ) apply_arg(arg, a);
+    }
+    for (int i = 1; i < argc; ++i) apply_arg(argv[i], a);
+
+    // stdin читается сразу, команды выполняются после загрузки — как у сервера
+    std::mutex q_mx;
+    std::condition_variable q_cv;
+    std::deque<std::string> commands;
+    std::thread([&] {
+        for (std::string line; std::getline(std::cin, line); ) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            std::lock_guard lg(q_mx);
+            commands.push_back(line);
+            q_cv.notify_one();
+        }
+    }).detach();
+
+    if (a.crash_after >= 0) {
+        std::thread([&a] {
+            std::this_thread::sleep_for(std::chrono::seconds(a.crash_after));
+            crash(a.exit_code);
+        }).detach();
+    }
+    if (a.hang_after >= 0) {
+        std::thread([&a] {
+            std::this_thread::sleep_for(std::chrono::seconds(a.hang_after));
+            hang(0);
+        }).detach();
+    }
+
+    if (a.boot_log.empty()) builtin_boot(a);
+    else                    replay_boot(a);
+
+    if (a.burst > 0) std::thread(burst, a.burst, a.burst_s, a.line_bytes).detach();
+
+    for (;;) {
+        std::string cmd;
+        {
+            std::unique_lock lk(q_mx);
+            q_cv.wait(lk, [&] { return !commands.empty(); });
+            cmd = std::move(commands.front());
+            commands.pop_front();
+        }
+        handle(cmd, a);
+    }
+}
@@ -0,0 +1,641 @@
+// Нагрузочный тест веб-API mshost: запросы/с и перцентили задержки.
+//
+//   mshost_loadtest --port 8080 --path /api/status --token <токен>
+//                   --threads 16 --duration 10 [--no-keepalive]
+//
+// Сравнение настроек web.http: прогон до и после правки config.json
+// (или с --no-keepalive — цена нового TCP-соединения на каждый запрос).
+//
+// Сценарии (--scenario) — повторяемая смесь нагрузки, как в жизни:
+//   panel     --tabs N вкладок панели опрашивают статус и логи инстанса
+//   download  --downloaders N качают сборку по кругу
+//   commands  поток команд say с частотой --command-rate в секунду
+//   authfail  --bad-clients N долбят API неверным токеном (ждём 401)
+//   all       всё сразу — тут видно, душит ли download/logs пул control
+// Задержки — по маршрутам, гистограмма HDR (точность ~1%), итог — JSON
+// (--json FILE, "-" — stdout). Паузы между запросами от --seed.
+//
+// --spawn bin/mshost --fake bin/mshost_fake_mc — поднять свой mshost во
+// временном каталоге (инстанс main на fake-сервере, свой токен и сборка
+// --modpack-mb), дождаться «Запущен», прогнать сценарий и погасить его
+// командой exit. --config FILE — взять оттуда web/logging (что меряем),
+// --keep — не удалять каталог (там mshost.out и логи).
+
+#include "httplib.h"
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Args {
+    std::string host      = "127.0.0.1";
+    int         port      = 8080;
+    std::string path      = "/api/status";
+    std::string token;
+    std::string session;
+    int         threads   = 8;
+    int         duration  = 10;   // секунд
+    bool        keepalive = true;
+
+    std::string scenario;          // пусто — старый режим: один --path
+    std::string server    = "main";
+    int         tabs         = 20;
+    int         poll_ms      = 1000;
+    int         downloaders  = 4;
+    int         command_rate = 20;
+    int         bad_clients  = 4;
+    int         warmup       = 0;  // секунд не учитывать
+    unsigned    seed         = 1;
+    std::string json_out;
+
+    std::string spawn;             // путь к mshost — поднять свой
+    std::string fake;              // путь к mshost_fake_mc
+    std::string config;            // шаблон config.json для --spawn
+    int         modpack_mb   = 16;
+    bool        keep         = false;
+};
+
+void usage() {
+    std::puts("mshost_loadtest [--host H] [--port P] [--path /api/status]\n"
+              "                [--token T | --session S] [--threads N] [--duration SEC]\n"
+              "                [--no-keepalive]\n"
+              "                [--scenario panel|download|commands|authfail|all] [--server ID]\n"
+              "                [--tabs N] [--poll-ms MS] [--downloaders N] [--command-rate N]\n"
+              "                [--bad-clients N] [--warmup SEC] [--seed N] [--json FILE|-]\n"
+              "                [--spawn MSHOST --fake FAKE_MC [--config FILE] [--modpack-mb N] [--keep]]");
+}
+
+bool parse(int argc, char** argv, Args& a) {
+    for (int i = 1; i < argc; ++i) {
+        auto is = [&](const char* name) { return std::strcmp(argv[i], name) == 0; };
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : ""; };
+
+        if      (is("--host"))         a.host      = next();
+        else if (is("--port"))         a.port      = std::atoi(next());
+        else if (is("--path"))         a.path      = next();
+        else if (is("--token"))        a.token     = next();
+        else if (is("--session"))      a.session   = next();
+        else if (is("--threads"))      a.threads   = std::atoi(next());
+        else if (is("--duration"))     a.duration  = std::atoi(next());
+        else if (is("--no-keepalive")) a.keepalive = false;
+        else if (is("--scenario"))     a.scenario  = next();
+        else if (is("--server"))       a.server    = next();
+        else if (is("--tabs"))         a.tabs         = std::atoi(next());
+        else if (is("--poll-ms"))      a.poll_ms      = std::atoi(next());
+        else if (is("--downloaders"))  a.downloaders  = std::atoi(next());
+        else if (is("--command-rate")) a.command_rate = std::atoi(next());
+        else if (is("--bad-clients"))  a.bad_clients  = std::atoi(next());
+        else if (is("--warmup"))       a.warmup       = std::atoi(next());
+        else if (is("--seed"))         a.seed         = static_cast<unsigned>(std::strtoul(next(), nullptr, 10));
+        else if (is("--json"))         a.json_out     = next();
+        else if (is("--spawn"))        a.spawn        = next();
+        else if (is("--fake"))         a.fake         = next();
+        else if (is("--config"))       a.config       = next();
+        else if (is("--modpack-mb"))   a.modpack_mb   = std::atoi(next());
+        else if (is("--keep"))         a.keep         = true;
+        else { usage(); return false; }
+    }
+    static const char* known[] = { "", "panel", "download", "commands", "authfail", "all" };
+    if (std::find_if(std::begin(known), std::end(known),
+                     [&](const char* s) { return a.scenario == s; }) == std::end(known)) {
+        usage();
+        return false;
+    }
+    if (!a.spawn.empty() && a.fake.empty()) {
+        std::fputs("--spawn требует --fake\n", stderr);
+        return false;
+    }
+    return a.threads > 0 && a.duration > 0 && a.poll_ms > 0;
+}
+
+/* ---------- Гистограмма в духе HDR: 64 корзины на октаву, мкс ---------- */
+class Hdr {
+public:
+    static constexpr int kSubBits = 7;
+    static constexpr uint64_t kSub = 1u << kSubBits;   // до 128 мкс — точно
+    static constexpr uint64_t kHalf = kSub / 2;
+
+    void record(uint64_t v) {
+        const size_t idx = index(v);
+        if (idx >= counts_.size()) counts_.resize(idx + 1, 0);
+        ++counts_[idx];
+        ++total_;
+        sum_ += v;
+        max_ = std::max(max_, v);
+    }
+
+    void merge(const Hdr& o) {
+        if (o.counts_.size() > counts_.size()) counts_.resize(o.counts_.size(), 0);
+        for (size_t i = 0; i < o.counts_.size(); ++i) counts_[i] += o.counts_[i];
+        total_ += o.total_;
+        sum_   += o.sum_;
+        max_    = std::max(max_, o.max_);
+    }
+
+    uint64_t percentile(double p) const {
+        if (!total_) return 0;
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * total_ + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(highest(i), max_);
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return total_; }
+
+    nlohmann::json to_json() const {
+        return {
+            {"p50",  percentile(0.50)},
+            {"p90",  percentile(0.90)},
+            {"p99",  percentile(0.99)},
+            {"p999", percentile(0.999)},
+            {"max",  max_},
+            {"mean", total_ ? sum_ / total_ : 0}
+        };
+    }
+
+private:
+    static size_t index(uint64_t v) {
+        if (v < kSub) return static_cast<size_t>(v);
+        int msb = kSubBits;
+        while ((v >> (msb + 1)) != 0) ++msb;
+        const int shift = msb - (kSubBits - 1);           // оставить старшие 7 бит
+        return static_cast<size_t>(kSub + (msb - kSubBits) * kHalf + ((v >> shift) - kHalf));
+    }
+
+    static uint64_t highest(size_t idx) {                 // верх корзины
+        if (idx < kSub) return idx;
+        const int msb   = kSubBits + static_cast<int>((idx - kSub) / kHalf);
+        const int shift = msb - (kSubBits - 1);
+        const uint64_t sub = (idx - kSub) % kHalf + kHalf;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0, sum_ = 0, max_ = 0;
+};
+
+/* ---------- Статистика маршрута (своя у каждого потока, потом слияние) ---------- */
+struct Route {
+    Hdr      latency;
+    uint64_t requests = 0, expected = 0, unexpected = 0, errors = 0, bytes = 0;
+    std::map<int, uint64_t> status;
+
+    void merge(const Route& o) {
+        latency.merge(o.latency);
+        requests   += o.requests;
+        expected   += o.expected;
+        unexpected += o.unexpected;
+        errors     += o.errors;
+        bytes      += o.bytes;
+        for (const auto& [code, n] : o.status) status[code] += n;
+    }
+};
+
+using Stats = std::map<std::string, Route>;
+
+/* Один клиент = один поток и одно соединение (как вкладка браузера) */
+class Actor {
+public:
+    Actor(const Args& a, Clock::time_point record_from, unsigned seed)
+        : cli_(a.host, a.port), record_from_(record_from), rng_(seed)
+    {
+        cli_.set_keep_alive(a.keepalive);
+        cli_.set_tcp_nodelay(true);
+        cli_.set_connection_timeout(5);
+        cli_.set_read_timeout(30);
+        if (!a.token.empty())   auth_.emplace("X-API-Token", a.token);
+        if (!a.session.empty()) auth_.emplace("Authorization", "Bearer " + a.session);
+    }
+
+    /* expect — какой статус считать нормой (для authfail это 401) */
+    void get(const std::string& route, const std::string& path, int expect = 200,
+             const httplib::Headers* headers = nullptr, bool stream = false)
+    {
+        uint64_t bytes = 0;
+        const auto t0 = Clock::now();
+        auto res = stream
+            ? cli_.Get(path, headers ? *headers : auth_,
+                       [&](const char*, size_t n) { bytes += n; return true; })
+            : cli_.Get(path, headers ? *headers : auth_);
+        if (res && !stream) bytes = res->body.size();
+        account(route, t0, res ? res->status : 0, expect, bytes);
+    }
+
+    void post(const std::string& route, const std::string& path, const std::string& body, int expect = 200) {
+        const auto t0 = Clock::now();
+        auto res = cli_.Post(path, auth_, body, "application/json");
+        account(route, t0, res ? res->status : 0, expect, res ? res->body.size() : 0);
+    }
+
+    /* Пауза interval ± 10% — вкладки не стучатся синхронно */
+    void pace(Clock::time_point& next, int interval_ms) {
+        std::uniform_int_distribution<int> jitter(-interval_ms / 10, interval_ms / 10);
+        next += std::chrono::milliseconds(interval_ms + jitter(rng_));
+        std::this_thread::sleep_until(next);
+    }
+
+    Stats stats;
+
+private:
+    void account(const std::string& route, Clock::time_point t0, int status, int expect, uint64_t bytes) {
+        const auto now = Clock::now();
+        if (now < record_from_) return;   // прогрев
+
+        auto& r = stats[route];
+        ++r.requests;
+        r.bytes += bytes;
+        r.latency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - t0).count()));
+        if (!status) { ++r.errors; return; }
+        ++r.status[status];
+        (status == expect ? r.expected : r.unexpected)++;
+    }
+
+    httplib::Client  cli_;
+    httplib::Headers auth_;
+    Clock::time_point record_from_;
+    std::mt19937     rng_;
+};
+
+/* ---------- Свой mshost на fake-сервере (--spawn) ---------- */
+/*
+ * Всё во временном каталоге: root/run — рабочий каталог mshost (config.json,
+ * tokens, site), root/logs — его "../logs", root/srv — каталог инстанса.
+ * Остановка — "exit" в stdin, как из консоли; не вышел за 30 с — kill.
+ */
+class LocalHost {
+public:
+    ~LocalHost() { stop(); }
+
+    bool start(const Args& a, std::string& token) {
+        std::random_device rd;
+        root_ = fs::temp_directory_path() / ("mshost-loadtest-" + std::to_string(rd() % 1000000));
+        const fs::path run = root_ / "run", srv = root_ / "srv";
+        std::error_code ec;
+        fs::create_directories(run / "site", ec);
+        fs::create_directories(root_ / "logs", ec);
+        fs::create_directories(srv, ec);
+        if (ec) return fail("не создать " + root_.string() + ": " + ec.message());
+
+        static const char hex[] = "0123456789abcdef";
+        token.clear();
+        for (int i = 0; i < 32; ++i) token += hex[rd() % 16];
+        std::ofstream(run / "tokens") << token << " control\n";
+        std::ofstream(run / "site" / "index.html") << "<html></html>\n";
+        std::ofstream(srv / "server.properties") << "level-name=world\n";
+        {
+            std::ofstream pack(srv / "modpack.zip", std::ios::binary);
+            std::vector<char> block(1 << 20);
+            std::mt19937 rng(a.seed);
+            for (auto& c : block) c = static_cast<char>(rng());
+            for (int i = 0; i < a.modpack_mb; ++i) pack.write(block.data(), block.size());
+        }
+
+        nlohmann::json cfg = nlohmann::json::object();
+        if (!a.config.empty()) {
+            std::ifstream in(a.config);
+            cfg = nlohmann::json::parse(in, nullptr, false);
+            if (!cfg.is_object()) return fail("не разобрать " + a.config);
+        }
+        // От шаблона остаются web/logging; инстанс и расписание — наши
+        cfg.erase("servers");
+        cfg.erase("scheduler");
+        cfg["java"] = {
+            {"path",     fs::absolute(a.fake).string()},
+            {"jvm_args", {"--fake-boot-ms=500"}}
+        };
+        cfg["server"] = {
+            {"directory",        srv.string()},
+            {"stop_countdown_s", 0},
+            {"rcon",             {{"enabled", false}}}
+        };
+        if (!cfg["web"].is_object()) cfg["web"] = nlohmann::json::object();
+        cfg["web"].merge_patch({
+            {"port",            a.port},
+            {"tokens_file",     "tokens"},
+            {"logs_path",       (root_ / "logs" / "server.log").string()},
+            {"modpack_path",    (srv / "modpack.zip").string()},
+            {"web_root",        "./site"},
+            {"upload_limit",    cfg["web"].value("upload_limit", 7)},
+            {"allow_raw_token", true},
+            {"unix_socket",     {{"enabled", false}}}
+        });
+        std::ofstream(run / "config.json") << cfg.dump(2) << '\n';
+
+        if (!launch(fs::absolute(a.spawn), run)) return false;
+        return wait_running(a, token);
+    }
+
+    void stop() {
+#ifdef _WIN32
+        if (process_) {
+            DWORD written = 0;
+            WriteFile(stdin_, "exit\n", 5, &written, nullptr);
+            CloseHandle(stdin_);
+            if (WaitForSingleObject(process_, 30000) == WAIT_TIMEOUT) {
+                std::fputs("mshost не вышел за 30 с — kill\n", stderr);
+                TerminateProcess(process_, 1);
+                WaitForSingleObject(process_, INFINITE);
+            }
+            CloseHandle(process_);
+            process_ = nullptr;
+        }
+#else
+        if (pid_ > 0) {
+            (void)!write(stdin_, "exit\n", 5);
+            close(stdin_);
+            bool exited = false;
+            for (int i = 0; i < 300 && !exited; ++i) {
+                exited = waitpid(pid_, nullptr, WNOHANG) == pid_;
+                if (!exited) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            if (!exited) {
+                std::fputs("mshost не вышел за 30 с — kill\n", stderr);
+                kill(pid_, SIGKILL);
+                waitpid(pid_, nullptr, 0);
+            }
+            pid_ = -1;
+        }
+#endif
+        if (root_.empty()) return;
+        if (keep_) {
+            std::fprintf(stderr, "каталог прогона: %s\n", root_.string().c_str());
+        } else {
+            std::error_code ec;
+            fs::remove_all(root_, ec);
+        }
+        root_.clear();
+    }
+
+    void keep(bool k) { keep_ = k; }
+
+private:
+    bool fail(const std::string& what) {
+        std::fprintf(stderr, "--spawn: %s\n", what.c_str());
+        keep_ = true;   // оставить mshost.out для разбора
+        return false;
+    }
+
+    bool launch(const fs::path& exe, const fs::path& cwd) {
+        const std::string out = (cwd / "mshost.out").string();
+#ifdef _WIN32
+        SECURITY_ATTRIBUTES sa{ sizeof(sa), nullptr, TRUE };
+        HANDLE rd = nullptr;
+        if (!CreatePipe(&rd, &stdin_, &sa, 0)) return fail("CreatePipe");
+        SetHandleInformation(stdin_, HANDLE_FLAG_INHERIT, 0);
+        HANDLE log = CreateFileA(out.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &sa,
+                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        STARTUPINFOA si{};
+        si.cb = sizeof(si);
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = rd;
+        si.hStdOutput = si.hStdError = log;
+        PROCESS_INFORMATION pi{};
+        std::string cmd = "\"" + exe.string() + "\" --all";
+        const BOOL ok = CreateProcessA(nullptr, cmd.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW,
+                                       nullptr, cwd.string().c_str(), &si, &pi);
+        CloseHandle(rd);
+        if (log != INVALID_HANDLE_VALUE) CloseHandle(log);
+        if (!ok) {
+            CloseHandle(stdin_);
+            return fail("не запустить " + exe.string());
+        }
+        CloseHandle(pi.hThread);
+        process_ = pi.hProcess;
+#else
+        std::signal(SIGPIPE, SIG_IGN);   // exit в stdin уже упавшему mshost
+        int fds[2];
+        if (pipe(fds) != 0) return fail("pipe");
+        pid_ = fork();
+        if (pid_ == 0) {
+            const int log = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            dup2(fds[0], 0);
+            if (log >= 0) { dup2(log, 1); dup2(log, 2); }
+            close(fds[0]);
+            close(fds[1]);
+            if (chdir(cwd.c_str()) == 0) execl(exe.c_str(), exe.c_str(), "--all", static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        close(fds[0]);
+        stdin_ = fds[1];
+        if (pid_ < 0) {
+            close(stdin_);
+            return fail("fork");
+        }
+#endif
+        return true;
+    }
+
+    bool alive() {
+#ifdef _WIN32
+        return WaitForSingleObject(process_, 0) == WAIT_TIMEOUT;
+#else
+        if (waitpid(pid_, nullptr, WNOHANG) != pid_) return true;
+        pid_ = -1;
+        close(stdin_);
+        return false;
+#endif
+    }
+
+    bool wait_running(const Args& a, const std::string& token) {
+        httplib::Client cli("127.0.0.1", a.port);
+        cli.set_connection_timeout(1);
+        const httplib::Headers auth = { {"X-API-Token", token} };
+        const auto deadline = Clock::now() + std::chrono::seconds(60);
+        while (Clock::now() < deadline) {
+            if (!alive()) return fail("mshost завершился до старта, см. " + (root_ / "run" / "mshost.out").string());
+            if (auto res = cli.Get("/api/servers/" + a.server + "/status", auth); res && res->status == 200) {
+                const auto body = nlohmann::json::parse(res->body, nullptr, false);
+                if (body.is_object() && body.value("status", "") == "Запущен") return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        return fail("инстанс " + a.server + " не запустился за 60 с");
+    }
+
+    fs::path root_;
+    bool     keep_ = false;
+#ifdef _WIN32
+    HANDLE process_ = nullptr;
+    HANDLE stdin_   = nullptr;
+#else
+    pid_t  pid_   = -1;
+    int    stdin_ = -1;
+#endif
+};
+
+/* ------------------------------------------------------------------ */
+/*                              Сценарии                              */
+/* ------------------------------------------------------------------ */
+Stats run(const Args& a) {
+    const auto start       = Clock::now();
+    const auto record_from = start + std::chrono::seconds(a.warmup);
+    const auto deadline    = record_from + std::chrono::seconds(a.duration);
+    auto live = [&] { return Clock::now() < deadline; };
+
+    const bool all = a.scenario == "all";
+    const std::string srv = "/api/servers/" + a.server;
+
+    std::vector<std::unique_ptr<Actor>> actors;
+    std::vector<std::thread> threads;
+    auto spawn = [&](auto body) {
+        actors.push_back(std::make_unique<Actor>(a, record_from, a.seed * 7919u + static_cast<unsigned>(actors.size())));
+        threads.emplace_back([&, body, actor = actors.back().get()] { body(*actor); });
+    };
+
+    if (a.scenario.empty()) {
+        for (int t = 0; t < a.threads; ++t) {
+            spawn([&](Actor& c) { while (live()) c.get("GET " + a.path, a.path); });
+        }
+    }
+    if (all || a.scenario == "panel") {
+        for (int t = 0; t < a.tabs; ++t) {
+            spawn([&](Actor& c) {
+                auto next = Clock::now();
+                for (uint64_t tick = 0; live(); ++tick) {
+                    c.get("GET /api/status", "/api/status");
+                    c.get("GET /api/servers/:id/status", srv + "/status");
+                    if (tick % 2 == 0) c.get("GET /api/servers/:id/logs", srv + "/logs?lines=200");
+                    c.pace(next, a.poll_ms);
+                }
+            });
+        }
+    }
+    if (all || a.scenario == "download") {
+        for (int t = 0; t < a.downloaders; ++t) {
+            spawn([&](Actor& c) {
+                while (live()) c.get("GET /api/download-modpack", "/api/download-modpack", 200, nullptr, true);
+            });
+        }
+    }
+    if ((all || a.scenario == "commands") && a.command_rate > 0) {
+        spawn([&](Actor& c) {
+            auto next = Clock::now();
+            for (uint64_t n = 0; live(); ++n) {
+                c.post("POST /api/servers/:id/command", srv + "/command",
+                       nlohmann::json{{"command", "say loadtest " + std::to_string(n)}}.dump());
+                c.pace(next, 1000 / a.command_rate);
+            }
+        });
+    }
+    if (all || a.scenario == "authfail") {
+        for (int t = 0; t < a.bad_clients; ++t) {
+            spawn([&, t](Actor& c) {
+                const httplib::Headers bad = { {"X-API-Token", "wrong-" + std::to_string(t)} };
+                while (live()) c.get("GET /api/status (bad token)", "/api/status", 401, &bad);
+            });
+        }
+    }
+
+    for (auto& th : threads) th.join();
+
+    Stats total;
+    for (const auto& actor : actors) {
+        for (const auto& [route, r] : actor->stats) total[route].merge(r);
+    }
+    return total;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args a;
+    if (!parse(argc, argv, a)) return 2;
+
+    LocalHost host;
+    if (!a.spawn.empty()) {
+        host.keep(a.keep);
+        a.host = "127.0.0.1";
+        a.session.clear();
+        if (!host.start(a, a.token)) return 2;
+    }
+    const Stats stats = run(a);
+    host.stop();
+
+    nlohmann::json routes = nlohmann::json::object();
+    uint64_t errors = 0;
+    for (const auto& [name, r] : stats) {
+        nlohmann::json status = nlohmann::json::object();
+        for (const auto& [code, n] : r.status) status[std::to_string(code)] = n;
+        routes[name] = {
+            {"requests",   r.requests},
+            {"rps",        r.requests / static_cast<double>(a.duration)},
+            {"expected",   r.expected},
+            {"unexpected", r.unexpected},
+            {"errors",     r.errors},
+            {"bytes",      r.bytes},
+            {"status",     status},
+            {"latency_us", r.latency.to_json()}
+        };
+        errors += r.errors;
+    }
+
+    std::printf("%s:%d, сценарий %s, %d с (+%d прогрев), keep-alive %s\n",
+                a.host.c_str(), a.port, a.scenario.empty() ? a.path.c_str() : a.scenario.c_str(),
+                a.duration, a.warmup, a.keepalive ? "вкл" : "выкл");
+    // printf считает байты, а не символы — заголовок выравниваем сами
+    auto col = [](const char* s, size_t width, bool left) {
+        size_t chars = 0;
+        for (const char* p = s; *p; ++p) chars += (static_cast<unsigned char>(*p) & 0xC0) != 0x80;
+        const std::string pad(width > chars ? width - chars : 0, ' ');
+        return left ? s + pad : pad + s;
+    };
+    std::string header = col("маршрут", 34, true);
+    for (const char* h : { "запросов", "в сек", "не то", "ошибок", "p50 мс", "p99 мс", "max мс" }) {
+        header += ' ' + col(h, 9, false);
+    }
+    std::puts(header.c_str());
+    for (const auto& [name, r] : stats) {
+        std::printf("%-34s %9llu %9.1f %9llu %9llu %9.2f %9.2f %9.2f\n", name.c_str(),
+                    static_cast<unsigned long long>(r.requests), r.requests / static_cast<double>(a.duration),
+                    static_cast<unsigned long long>(r.unexpected), static_cast<unsigned long long>(r.errors),
+                    r.latency.percentile(0.50) / 1000.0, r.latency.percentile(0.99) / 1000.0,
+                    r.latency.percentile(1.0) / 1000.0);
+    }
+
+    if (!a.json_out.empty()) {
+        const nlohmann::json out = {
+            {"scenario",   a.scenario.empty() ? "path" : a.scenario},
+            {"duration_s", a.duration},
+            {"warmup_s",   a.warmup},
+            {"keepalive",  a.keepalive},
+            {"seed",       a.seed},
+            {"routes",     routes}
+        };
+        if (a.json_out == "-") {
+            std::puts(out.dump(2).c_str());
+        } else {
+            std::ofstream(a.json_out) << out.dump(2) << '\n';
+        }
+    }
+    return errors ? 1 : 0;
+}